@@ -0,0 +1,137 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Constants.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(linux) || defined(__linux__)
+extern "C" {
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+}
+#include <climits>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+namespace firestarter {
+
+// Broadcast commands from the master thread to all load worker threads.
+//
+// The master publishes a command by incrementing the epoch and waking all
+// workers at once. Every worker acknowledges a command by decrementing the
+// pending counter, the last one wakes the master. This results in a constant
+// number of wakeups per command regardless of the number of threads.
+class ControlPlane {
+public:
+  ControlPlane() = default;
+  ControlPlane(ControlPlane const &) = delete;
+  ControlPlane &operator=(ControlPlane const &) = delete;
+
+  // set the number of workers that have to acknowledge each command
+  void setNumWorkers(unsigned numWorkers) { _numWorkers = numWorkers; }
+
+  // publish a command to all workers without waiting for their
+  // acknowledgement.
+  void post(int comm) {
+    _pending.store(_numWorkers, std::memory_order_relaxed);
+    _comm.store(comm, std::memory_order_relaxed);
+    // release the command and the pending count with the new epoch
+    _epoch.fetch_add(1, std::memory_order_release);
+    wake(_epoch, INT_MAX);
+  }
+
+  // block until every worker acknowledged the last posted command
+  void waitForAcks() {
+    uint32_t pending;
+    while ((pending = _pending.load(std::memory_order_acquire)) != 0) {
+      wait(_pending, pending);
+    }
+  }
+
+  // post a command and wait until all workers acknowledged it
+  void signal(int comm) {
+    post(comm);
+    waitForAcks();
+  }
+
+  // called by a worker. blocks until a command newer than epoch is posted,
+  // acknowledges it and returns it. epoch is updated to the observed value.
+  int receive(std::atomic<uint32_t> &epoch) {
+    uint32_t seen = epoch.load(std::memory_order_relaxed);
+    uint32_t current;
+
+    while ((current = _epoch.load(std::memory_order_acquire)) == seen) {
+      wait(_epoch, seen);
+    }
+
+    int comm = _comm.load(std::memory_order_relaxed);
+
+    epoch.store(current, std::memory_order_relaxed);
+
+    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      wake(_pending, 1);
+    }
+
+    return comm;
+  }
+
+private:
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex word must be 32 bits wide");
+
+  static void wait(std::atomic<uint32_t> &word, uint32_t value) {
+#if defined(linux) || defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+            value, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)value;
+    std::this_thread::sleep_for(std::chrono::microseconds(1));
+#endif
+  }
+
+  static void wake(std::atomic<uint32_t> &word, int count) {
+#if defined(linux) || defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE,
+            count, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)count;
+#endif
+  }
+
+  // written by the master, read by all workers
+  alignas(64) std::atomic<uint32_t> _epoch{0};
+  std::atomic<int> _comm{THREAD_WAIT};
+  uint32_t _numWorkers = 0;
+
+  // decremented by the workers, read by the master
+  alignas(64) std::atomic<uint32_t> _pending{0};
+};
+
+} // namespace firestarter
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <list>
 #include <ostream>
 #include <sstream>
@@ -63,6 +64,17 @@ public:
 
   int getPkgIdFromPU(unsigned pu) const;
   int getCoreIdFromPU(unsigned pu) const;
+  int getNumaNodeIdFromPU(unsigned pu) const;
+  // the id of the NUMA node used by the operating system, e.g. in sysfs
+  int getNumaNodeOsIdFromPU(unsigned pu) const;
+
+  // bind an area of memory to the NUMA node of a PU. returns EXIT_SUCCESS on
+  // success.
+  int bindMemoryToPU(void *addr, std::size_t size, unsigned pu) const;
+  // allocate memory on the NUMA node of a PU or without binding if pu is -1.
+  // returns nullptr on failure.
+  void *allocateMemoryOnPU(std::size_t size, int pu) const;
+  void freeMemory(void *addr, std::size_t size) const;
 
 protected:
   std::string scalingGovernor() const;
@@ -71,6 +83,8 @@ protected:
 private:
   static std::stringstream getFileAsStream(std::string const &filePath);
 
+  hwloc_obj_t getNumaNodeFromPU(unsigned pu) const;
+
   unsigned _numThreadsPerCore;
   unsigned _numCoresPerPackage;
   unsigned _numPackages;
@@ -26,6 +26,8 @@
 #include <firestarter/Environment/Platform/RuntimeConfig.hpp>
 
 #include <cassert>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace firestarter::environment {
@@ -40,14 +42,32 @@ public:
     }
   }
 
+  // payload settings for the threads running on a list of CPUs
+  struct ThreadGroup {
+    std::string cpuList;
+    std::vector<unsigned> cpus;
+    std::vector<std::pair<std::string, unsigned>> payloadSettings;
+  };
+
+  // parse a list of CPUs in the format of -b/--bind
+  static int parseCpuList(std::string const &cpuList,
+                          std::vector<unsigned> &cpus);
+
   int evaluateCpuAffinity(unsigned requestedNumThreads, std::string cpuBind);
   int setCpuAffinity(unsigned thread);
+  // get the os index of the CPU a thread is bound to. returns -1 if the
+  // threads are not bound.
+  int getCpuIdOfThread(unsigned thread) const;
+  // get the index of the thread group of a thread. returns -1 if the thread
+  // uses the selected config.
+  int getThreadGroupOfThread(unsigned thread) const;
   void printThreadSummary();
 
   virtual void evaluateFunctions() = 0;
   virtual int selectFunction(unsigned functionId,
                              bool allowUnavailablePayload) = 0;
   virtual int selectInstructionGroups(std::string groups) = 0;
+  virtual int selectThreadInstructionGroups(std::string groups) = 0;
   virtual void printAvailableInstructionGroups() = 0;
   virtual void setLineCount(unsigned lineCount) = 0;
   virtual void printSelectedCodePathSummary() = 0;
@@ -77,9 +97,14 @@ public:
     return *_topology;
   }
 
+  std::vector<ThreadGroup> const &threadGroups() const {
+    return _threadGroups;
+  }
+
 protected:
   platform::RuntimeConfig *_selectedConfig = nullptr;
   CPUTopology *_topology = nullptr;
+  std::vector<ThreadGroup> _threadGroups;
 
 private:
   unsigned long long _requestedNumThreads;
@@ -44,8 +44,6 @@ protected:
   // number of used simd registers
   unsigned _registerCount;
 
-  std::vector<std::string> generateSequence(
-      const std::vector<std::pair<std::string, unsigned>> &proportion);
   unsigned getL2SequenceCount(const std::vector<std::string> &sequence) {
     return getSequenceStartCount(sequence, "L2");
   };
@@ -81,6 +79,10 @@ public:
         _registerCount(registerCount) {}
   virtual ~Payload() {}
 
+  // the sequence of instruction groups that is repeated in the high load loop
+  static std::vector<std::string> generateSequence(
+      const std::vector<std::pair<std::string, unsigned>> &proportion);
+
   const std::string &name() const { return _name; }
   unsigned flops() const { return _flops; }
   unsigned bytes() const { return _bytes; }
@@ -101,6 +103,10 @@ public:
   virtual std::list<std::string> getAvailableInstructions() const = 0;
   virtual void init(unsigned long long *memoryAddr,
                     unsigned long long bufferSize) = 0;
+  // only reset the part of the buffer used to seed the registers. the rest of
+  // the buffer has to be initialized by a payload with the same name before.
+  virtual void reinit(unsigned long long *memoryAddr,
+                      unsigned long long bufferSize) = 0;
   virtual unsigned long long
   highLoadFunction(unsigned long long *addrMem,
                    volatile unsigned long long *addrHigh,
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Environment/Payload/Payload.hpp>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace firestarter::environment::payload {
+
+// Process-wide cache of compiled payloads. All requests for a payload with
+// identical settings share one compiled function, which is only created once.
+// Payloads that are not in use anymore are kept until the capacity of the
+// cache is exceeded, starting with the least recently used one.
+class PayloadCache {
+public:
+  // get a compiled copy of payload. returns nullptr if the compilation failed.
+  // requests with a different replica id get a separate copy of the code,
+  // which is placed on the NUMA node of the thread compiling it.
+  static std::shared_ptr<Payload>
+  get(Payload const &payload,
+      std::vector<std::pair<std::string, unsigned>> const &proportion,
+      unsigned instructionCacheSize,
+      std::list<unsigned> const &dataCacheBufferSize, unsigned ramBufferSize,
+      unsigned thread, unsigned numberOfLines, bool dumpRegisters, int replica);
+
+  // set the number of payloads that are kept in the cache
+  static void setCapacity(std::size_t capacity);
+
+private:
+  using Key =
+      std::tuple<std::string, std::vector<std::pair<std::string, unsigned>>,
+                 unsigned, std::list<unsigned>, unsigned, unsigned, unsigned,
+                 bool, int>;
+
+  struct Entry {
+    // held during compilation. other threads requesting the same payload
+    // wait for it to finish.
+    std::mutex mutex;
+    std::shared_ptr<Payload> payload;
+    unsigned long long lastUse = 0;
+  };
+
+  // remove the least recently used entries which are not in use until the
+  // capacity is met. _mutex must be held.
+  static void evict();
+
+  inline static std::mutex _mutex;
+  inline static std::map<Key, std::shared_ptr<Entry>> _entries;
+  inline static unsigned long long _useCount = 0;
+  inline static std::size_t _capacity = 64;
+};
+
+} // namespace firestarter::environment::payload
@@ -21,16 +21,19 @@
 
 #pragma once
 
+#include <firestarter/Environment/Payload/PayloadCache.hpp>
 #include <firestarter/Environment/Platform/PlatformConfig.hpp>
 
 #include <cassert>
+#include <cstdlib>
+#include <memory>
 
 namespace firestarter::environment::platform {
 
 class RuntimeConfig {
 private:
   PlatformConfig const &_platformConfig;
-  std::unique_ptr<payload::Payload> _payload;
+  std::shared_ptr<payload::Payload> _payload;
   unsigned _thread;
   std::vector<std::pair<std::string, unsigned>> _payloadSettings;
   unsigned _instructionCacheSize;
@@ -105,6 +108,29 @@ public:
 
   void setLineCount(unsigned lineCount) { this->_lines = lineCount; }
 
+  // get the payload compiled for the current settings. it is shared with all
+  // other threads using the same settings and replica id.
+  std::shared_ptr<payload::Payload> compiledPayload(bool dumpRegisters,
+                                                    int replica) const {
+    return payload::PayloadCache::get(
+        platformConfig().payload(), payloadSettings(), instructionCacheSize(),
+        dataCacheBufferSize(), ramBufferSize(), thread(), lines(),
+        dumpRegisters, replica);
+  }
+
+  // replace the payload with the compiled one for the current settings.
+  int compilePayload(bool dumpRegisters, int replica) {
+    auto payload = compiledPayload(dumpRegisters, replica);
+
+    if (payload == nullptr) {
+      return EXIT_FAILURE;
+    }
+
+    this->_payload = payload;
+
+    return EXIT_SUCCESS;
+  }
+
   void printCodePathSummary() const {
     log::info() << "\n"
                 << "  Taking " << platformConfig().payload().name()
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <asmjit/x86.h>
+
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace firestarter::environment::x86::payload {
+
+// The pointers into the L1, L2, L3 and RAM part of the load buffer. The L1
+// pointer wraps around after half of the L1 buffer was accessed, the other
+// pointers are reset by their counters at the end of the loop.
+struct AddressStreams {
+  asmjit::x86::Gp pointer;
+  asmjit::x86::Gp offset;
+  asmjit::x86::Gp l1;
+  asmjit::x86::Gp l2;
+  asmjit::x86::Gp l3;
+  asmjit::x86::Gp ram;
+  unsigned l1Size;
+  unsigned l1Offset = 0;
+
+  void l1Increment(asmjit::x86::Builder &cb, unsigned times = 1) {
+    l1Offset += times * 64;
+    if (l1Offset < l1Size * 0.5) {
+      cb.add(l1, offset);
+    } else {
+      l1Offset = 0;
+      cb.mov(l1, pointer);
+    }
+  }
+
+  void l2Increment(asmjit::x86::Builder &cb, unsigned times = 1) {
+    if (times == 1) {
+      cb.add(l2, offset);
+    } else {
+      cb.add(l2, asmjit::Imm(times * 64));
+    }
+  }
+
+  void l3Increment(asmjit::x86::Builder &cb) { cb.add(l3, offset); }
+
+  void ramIncrement(asmjit::x86::Builder &cb) { cb.add(ram, offset); }
+};
+
+// A register id cycling through the registers [first, last]. After last it
+// continues with restart, which allows to exclude registers at the beginning
+// of the range from the rotation.
+class RegisterRing {
+public:
+  RegisterRing(unsigned first, unsigned last)
+      : RegisterRing(first, last, first, first) {}
+  RegisterRing(unsigned first, unsigned last, unsigned start, unsigned restart)
+      : _first(first), _last(last), _restart(restart), _current(start) {}
+
+  unsigned current() const { return _current; }
+
+  // the register n positions away from the current one inside [first, last]
+  unsigned neighbour(int n) const {
+    int count = _last - _first + 1;
+    int offset = static_cast<int>(_current - _first) + count + n;
+    return _first + offset % count;
+  }
+
+  void next() {
+    if (++_current > _last) {
+      _current = _restart;
+    }
+  }
+
+private:
+  unsigned _first;
+  unsigned _last;
+  unsigned _restart;
+  unsigned _current;
+};
+
+// Cycles through a number of shift registers. The shift direction changes
+// after every full round.
+class ShiftRotation {
+public:
+  explicit ShiftRotation(unsigned count) : _count(count) {}
+
+  unsigned count() const { return _count; }
+  unsigned current() const { return _pos; }
+  // the register n positions away from the current one
+  unsigned neighbour(int n) const {
+    int count = _count;
+    return (static_cast<int>(_pos) + count + n) % count;
+  }
+  bool left() const { return _left; }
+
+  void next() {
+    if (++_pos == _count) {
+      _pos = 0;
+      _left = !_left;
+    }
+  }
+
+private:
+  unsigned _count;
+  unsigned _pos = 0;
+  bool _left = false;
+};
+
+// Maps the names of the instruction groups of a payload to the functions
+// emitting them. Context holds the state of the code generation, i.e. the
+// builder, the address streams and the register rotation. Context::next() is
+// called after every emitted group to advance the register rotation.
+template <class Context> class InstructionGroups {
+public:
+  typedef void (*Emitter)(Context &);
+
+  InstructionGroups(
+      std::initializer_list<std::pair<const std::string, Emitter>> groups)
+      : _groups(groups) {}
+
+  // resolve the sequence to its emitters once, so that the repetitions are
+  // emitted without any lookup. On failure the unknown group is returned in
+  // unknown.
+  bool resolve(std::vector<std::string> const &sequence,
+               std::vector<Emitter> &emitters, std::string &unknown) const {
+    emitters.clear();
+    emitters.reserve(sequence.size());
+
+    for (auto const &item : sequence) {
+      auto it = _groups.find(item);
+
+      if (it == _groups.end()) {
+        unknown = item;
+        return false;
+      }
+
+      emitters.push_back(it->second);
+    }
+
+    return true;
+  }
+
+  static void emit(std::vector<Emitter> const &emitters, unsigned repetitions,
+                   Context &context) {
+    for (unsigned count = 0; count < repetitions; count++) {
+      for (auto const &emitter : emitters) {
+        emitter(context);
+        context.next();
+      }
+    }
+  }
+
+private:
+  std::unordered_map<std::string, Emitter> _groups;
+};
+
+} // namespace firestarter::environment::x86::payload
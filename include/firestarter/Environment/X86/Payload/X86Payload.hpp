@@ -83,6 +83,9 @@ public:
 #if defined(__clang__)
 #pragma clang diagnostic pop
 #endif
+  // the registers are seeded from the first INIT_BLOCKSIZE elements
+  void reinit(unsigned long long *memoryAddr,
+              unsigned long long bufferSize) override;
   // use cpuid and usleep as low load
   void lowLoadFunction(volatile unsigned long long *addrHigh,
                        unsigned long long period) override;
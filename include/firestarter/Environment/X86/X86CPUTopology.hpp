@@ -52,9 +52,10 @@ public:
   unsigned modelId() const { return this->cpuInfo.modelId(); }
   unsigned stepping() const { return this->cpuInfo.stepping(); }
 
-private:
   bool hasRdtsc() const { return this->_hasRdtsc; }
   bool hasInvariantRdtsc() const { return this->_hasInvariantRdtsc; }
+
+private:
   void cpuid(unsigned long long *a, unsigned long long *b,
              unsigned long long *c, unsigned long long *d) const;
 
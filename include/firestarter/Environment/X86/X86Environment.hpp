@@ -71,12 +71,17 @@ public:
   int selectFunction(unsigned functionId,
                      bool allowUnavailablePayload) override;
   int selectInstructionGroups(std::string groups) override;
+  int selectThreadInstructionGroups(std::string groups) override;
   void printAvailableInstructionGroups() override;
   void setLineCount(unsigned lineCount) override;
   void printSelectedCodePathSummary() override;
   void printFunctionSummary() override;
 
 private:
+  int parseInstructionGroups(
+      std::string groups,
+      std::vector<std::pair<std::string, unsigned>> &payloadSettings);
+
   // The available function IDs are generated by iterating through this list of
   // PlatformConfig. Add new PlatformConfig at the bottom to maintain stable
   // IDs.
@@ -26,6 +26,7 @@
 #endif
 
 #include <firestarter/Constants.hpp>
+#include <firestarter/ControlPlane.hpp>
 
 #ifndef FIRESTARTER_BUILD_CUDA_ONLY
 #if defined(linux) || defined(__linux__)
@@ -36,6 +37,7 @@
 #endif
 
 #include <firestarter/DumpRegisterWorkerData.hpp>
+#include <firestarter/LoadProfile.hpp>
 #include <firestarter/LoadWorkerData.hpp>
 
 #if defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) ||            \
@@ -44,6 +46,7 @@
 #endif
 #endif
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <list>
@@ -51,6 +54,7 @@
 #include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #if defined(linux) || defined(__linux__)
 extern "C" {
@@ -64,27 +68,46 @@ class Firestarter {
 public:
   Firestarter(const int argc, const char **argv,
               std::chrono::seconds const &timeout, unsigned loadPercent,
-              std::chrono::microseconds const &period,
+              std::chrono::microseconds const &period, bool precisePeriod,
+              std::chrono::microseconds const &spinTime, bool realtimeWatchdog,
+              std::string const &loadProfile, std::string const &stagger,
               unsigned requestedNumThreads, std::string const &cpuBind,
-              bool printFunctionSummary, unsigned functionId,
-              bool listInstructionGroups, std::string const &instructionGroups,
-              unsigned lineCount, bool allowUnavailablePayload,
-              bool dumpRegisters,
+              std::string const &loadVariable, bool payloadPerPackage,
+              std::string const &hugePages, bool printFunctionSummary,
+              unsigned functionId, bool listInstructionGroups,
+              std::string const &instructionGroups,
+              std::string const &cpuInstructionGroups, unsigned lineCount,
+              bool allowUnavailablePayload, bool dumpRegisters,
               std::chrono::seconds const &dumpRegistersTimeDelta,
-              std::string const &dumpRegistersOutpath, int gpus,
-              unsigned gpuMatrixSize, bool gpuUseFloat, bool gpuUseDouble,
+              std::string const &dumpRegistersOutpath, bool measureLoadSkew,
+              int gpus, unsigned gpuMatrixSize, bool gpuUseFloat,
+              bool gpuUseDouble,
               bool listMetrics, bool measurement,
               std::chrono::milliseconds const &startDelta,
               std::chrono::milliseconds const &stopDelta,
               std::chrono::milliseconds const &measurementInterval,
               std::vector<std::string> const &metricPaths,
-              std::vector<std::string> const &stdinMetrics, bool optimize,
+              std::vector<std::string> const &stdinMetrics,
+              unsigned long long measurementBufferSize,
+              std::string const &measurementSpillPath,
+              std::string const &perfEvents, unsigned msrRaplInterval,
+              std::string const &streamDestination,
+              std::string const &streamFormat,
+              std::string const &exporterAddress,
+              std::string const &controlMetric, double controlTarget,
+              std::chrono::milliseconds const &controlInterval,
+              double controlKp, double controlKi, double controlKd,
+              double controlMaxRate, bool optimize,
               std::chrono::seconds const &preheat,
               std::string const &optimizationAlgorithm,
               std::vector<std::string> const &optimizationMetrics,
               std::chrono::seconds const &evaluationDuration,
               unsigned individuals, std::string const &optimizeOutfile,
-              unsigned generations, double nsga2_cr, double nsga2_m);
+              std::string const &optimizeTrace,
+              std::string const &optimizeCheckpoint, bool resume,
+              std::vector<std::string> const &optimizeWarmStart,
+              unsigned generations, double nsga2_cr, double nsga2_m,
+              unsigned surrogateEvaluations);
 
   ~Firestarter();
 
@@ -97,9 +120,30 @@ private:
   const unsigned _loadPercent;
   std::chrono::microseconds _load;
   std::chrono::microseconds _period;
+  const bool _precisePeriod;
+  // time before each load change that is spent busy-waiting on the tsc
+  const std::chrono::microseconds _spinTime;
+  const bool _realtimeWatchdog;
+  // how the phases of the load variables are spread over the period. empty if
+  // all of them change at once.
+  const std::string _stagger;
+#ifndef FIRESTARTER_BUILD_CUDA_ONLY
+  // changes the load level in every period if set
+  std::unique_ptr<LoadProfile> _loadProfile;
+  // the load profile if the load level is set by the controller
+  VariableLoadProfile *_controlledLoadProfile = nullptr;
+  // the current payload settings of the load threads. replaced with
+  // std::atomic_store when the optimization switches the payload.
+  std::shared_ptr<const std::vector<std::pair<std::string, unsigned>>>
+      _payloadSettings;
+#endif
   const bool _dumpRegisters;
   const std::chrono::seconds _dumpRegistersTimeDelta;
   const std::string _dumpRegistersOutpath;
+  const std::string _loadVariable;
+  const bool _payloadPerPackage;
+  const std::string _hugePages;
+  const bool _measureLoadSkew;
   const int _gpus;
   const unsigned _gpuMatrixSize;
   const bool _gpuUseFloat;
@@ -107,6 +151,19 @@ private:
   const std::chrono::milliseconds _startDelta;
   const std::chrono::milliseconds _stopDelta;
   const bool _measurement;
+  // the load level is controlled to keep this metric at the target value if
+  // it is not empty
+  // serve the metrics in the OpenMetrics format on this address if it is not
+  // empty
+  const std::string _exporterAddress;
+  const std::string _controlMetric;
+  const double _controlTarget;
+  const std::chrono::milliseconds _controlInterval;
+  const double _controlKp;
+  const double _controlKi;
+  const double _controlKd;
+  // in load level per second
+  const double _controlMaxRate;
   const bool _optimize;
   const std::chrono::seconds _preheat;
   const std::string _optimizationAlgorithm;
@@ -114,9 +171,17 @@ private:
   const std::chrono::seconds _evaluationDuration;
   const unsigned _individuals;
   const std::string _optimizeOutfile;
+  const std::string _optimizeTrace;
+  // save a checkpoint of the optimization to this file if it is not empty
+  const std::string _optimizeCheckpoint;
+  // resume the optimization from the checkpoint
+  const bool _resume;
+  // output files of previous optimizations whose evaluations are reused
+  const std::vector<std::string> _optimizeWarmStart;
   const unsigned _generations;
   const double _nsga2_cr;
   const double _nsga2_m;
+  const unsigned _surrogateEvaluations;
 
 #ifndef FIRESTARTER_BUILD_CUDA_ONLY
 #if defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) ||            \
@@ -141,20 +206,70 @@ private:
   std::shared_ptr<measurement::MeasurementWorker> _measurementWorker;
   std::unique_ptr<firestarter::optimizer::Algorithm> _algorithm;
   firestarter::optimizer::Population _population;
+  std::shared_ptr<firestarter::optimizer::Checkpoint> _checkpoint;
+  // the payload items of the optimization. the threads of each thread group
+  // are optimized with separate items, which are appended with @CPULIST.
+  std::vector<std::string> _optimizationItems;
+  // the offset of the items of each thread group in the optimization items.
+  // index 0 belongs to the threads without a thread group.
+  std::vector<std::size_t> _optimizationItemOffsets;
+
+  // LoadControllerWorker.cpp
+  void initLoadControllerWorker();
+  void joinLoadControllerWorker();
+  void loadControllerWorker();
+  std::thread loadControllerThread;
+
+  // ExporterWorker.cpp
+  int initExporterWorker();
+  void joinExporterWorker();
+  void exporterWorker(std::string payloadName);
+  std::string exporterMetrics(std::string const &payloadName,
+                              std::vector<unsigned long long> const &iterations,
+                              std::vector<double> const &iterationRates);
+  std::thread exporterThread;
+  int _exporterFd = -1;
 #endif
 
   // LoadThreadWorker.cpp
   int initLoadWorkers(bool lowLoad, unsigned long long period,
                       bool dumpRegisters);
+  int compileLoadWorkerPayloads();
   void joinLoadWorkers();
   void printPerformanceReport();
+  void printMemorySummary();
+  void printLoadSkewReport();
 
   void signalWork() { signalLoadWorkers(THREAD_WORK); };
 
+  // add an event to the stream of the measurement, if one is written
+  void insertEvent(std::string const &name, std::string const &value);
+  bool eventsActive() const;
+
   // WatchdogWorker.cpp
   int watchdogWorker(std::chrono::microseconds period,
                      std::chrono::microseconds load,
                      std::chrono::seconds timeout);
+  int preciseWatchdogWorker(std::chrono::microseconds period,
+                            std::chrono::microseconds load,
+                            std::chrono::seconds timeout);
+  int staggeredWatchdogWorker(std::chrono::microseconds period,
+                              std::chrono::microseconds load,
+                              std::chrono::seconds timeout);
+  void initPreciseWaiting();
+  void finiPreciseWaiting();
+  bool waitForTimestamp(unsigned long long deadline,
+                        unsigned long long clockrate);
+  static bool watchdogTerminated();
+
+#if defined(linux) || defined(__linux__)
+  // timer used by the precise watchdog to sleep until an absolute deadline.
+  // the values of CLOCK_MONOTONIC in nsec and the tsc at the same time convert
+  // deadlines in tsc ticks to deadlines of the timer.
+  int _watchdogTimerFd = -1;
+  unsigned long long _watchdogMonotonicBase;
+  unsigned long long _watchdogTimestampBase;
+#endif
 
 #ifdef FIRESTARTER_DEBUG_FEATURES
   // DumpRegisterWorker.cpp
@@ -166,6 +281,7 @@ private:
   // LoadThreadWorker.cpp
   void signalLoadWorkers(int comm);
   static void loadThreadWorker(std::shared_ptr<LoadWorkerData> td);
+  static void recordLoadChange(LoadWorkerData &td);
 #endif
 
   // CudaWorker.cpp
@@ -179,6 +295,8 @@ private:
 #endif
 
   static void setLoad(unsigned long long value);
+  // set a single load variable, used to stagger the load changes
+  static void setLoadVariable(std::size_t index, unsigned long long value);
 
   static void sigalrmHandler(int signum);
   static void sigtermHandler(int signum);
@@ -191,10 +309,32 @@ private:
   // variable to control the load of the threads
   inline static volatile unsigned long long loadVar = LOAD_LOW;
 
+  // copy of the load variable in its own cache line
+  struct alignas(64) LoadVariable {
+    volatile unsigned long long value = LOAD_LOW;
+    // start of the high load in the period as a fraction of it. only used
+    // with --stagger.
+    double phase = 0;
+  };
+
+  // load variables used instead of loadVar if every thread or numa node gets
+  // its own copy. they are set together with loadVar in setLoad.
+  inline static std::vector<LoadVariable> _loadVariables;
+
+  // number of load changes, used to match the timestamps recorded by the
+  // threads when measuring the skew of load changes.
+  inline static std::atomic<unsigned long long> _loadChangeCount{0};
+
 #ifndef FIRESTARTER_BUILD_CUDA_ONLY
+  // used to send commands to the load threads
+  ControlPlane controlPlane;
+
   std::vector<std::pair<std::thread, std::shared_ptr<LoadWorkerData>>>
       loadThreads;
 
+  // payloads compiled by the master thread for the load threads
+  std::vector<std::shared_ptr<environment::payload::Payload>> compiledPayloads;
+
 #ifdef FIRESTARTER_DEBUG_FEATURES
   std::thread dumpRegisterWorkerThread;
 #endif
@@ -29,7 +29,13 @@ template <> struct adl_serializer<firestarter::measurement::Summary> {
     return {j["num_timepoints"].get<size_t>(),
             std::chrono::milliseconds(
                 j["duration"].get<std::chrono::milliseconds::rep>()),
-            j["average"].get<double>(), j["stddev"].get<double>()};
+            j["average"].get<double>(),
+            j["stddev"].get<double>(),
+            j.value("min", 0.0),
+            j.value("max", 0.0),
+            j.value("p50", 0.0),
+            j.value("p95", 0.0),
+            j.value("p99", 0.0)};
   }
 
   static void to_json(json &j, firestarter::measurement::Summary s) {
@@ -39,6 +45,11 @@ template <> struct adl_serializer<firestarter::measurement::Summary> {
     j["duration"] = s.duration.count();
     j["average"] = s.average;
     j["stddev"] = s.stddev;
+    j["min"] = s.min;
+    j["max"] = s.max;
+    j["p50"] = s.p50;
+    j["p95"] = s.p95;
+    j["p99"] = s.p99;
   }
 };
 } // namespace nlohmann
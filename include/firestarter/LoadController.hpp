@@ -0,0 +1,80 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+
+namespace firestarter {
+
+// pid controller for the load level in [0,1]. the integral stops growing once
+// the output saturates in the direction of the error (anti-windup) and the
+// output changes by at most maxRate per second.
+class LoadController {
+public:
+  LoadController(double kp, double ki, double kd, double maxRate,
+                 double initialLevel)
+      : _kp(kp), _ki(ki), _kd(kd), _maxRate(maxRate),
+        _integral(initialLevel), _output(initialLevel) {}
+
+  // update the controller with the error of the controlled value dt seconds
+  // after the last update. returns the new load level.
+  double update(double error, double dt) {
+    double derivative = _first ? 0.0 : (error - _lastError) / dt;
+    _first = false;
+    _lastError = error;
+
+    double integral = std::clamp(_integral + _ki * error * dt, 0.0, 1.0);
+    double output = _kp * error + integral + _kd * derivative;
+
+    // do not integrate beyond the point where the output saturates
+    if (output > 1.0 && error > 0) {
+      integral = std::max(_integral, integral - (output - 1.0));
+    } else if (output < 0.0 && error < 0) {
+      integral = std::min(_integral, integral - output);
+    }
+    _integral = integral;
+
+    output = std::clamp(_kp * error + _integral + _kd * derivative, 0.0, 1.0);
+
+    // limit the rate of change
+    double maxStep = _maxRate * dt;
+    output = std::clamp(output, _output - maxStep, _output + maxStep);
+
+    _output = output;
+    return _output;
+  }
+
+  double output() const { return _output; }
+
+private:
+  double _kp;
+  double _ki;
+  double _kd;
+  double _maxRate;
+
+  double _integral;
+  double _output;
+  double _lastError = 0;
+  bool _first = true;
+};
+
+} // namespace firestarter
@@ -0,0 +1,119 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace firestarter {
+
+// describes the load level of the cpu threads over time. the watchdog takes
+// the level at the start of each period as the share of high load in it.
+class LoadProfile {
+public:
+  virtual ~LoadProfile() {}
+
+  // the load level in [0,1] at the given time since the start
+  virtual double level(std::chrono::nanoseconds time) const = 0;
+
+  // create a profile from a description of the format TYPE:ARGS. throws
+  // std::invalid_argument if the description is invalid.
+  static std::unique_ptr<LoadProfile> fromString(std::string const &profile);
+};
+
+// linear change from one level to another, then constant
+class RampLoadProfile : public LoadProfile {
+public:
+  RampLoadProfile(double from, double to, std::chrono::nanoseconds duration)
+      : _from(from), _to(to), _duration(duration) {}
+
+  double level(std::chrono::nanoseconds time) const override;
+
+private:
+  double _from;
+  double _to;
+  std::chrono::nanoseconds _duration;
+};
+
+// sinusoidal modulation around a mean level
+class SineLoadProfile : public LoadProfile {
+public:
+  SineLoadProfile(double mean, double amplitude, double frequency)
+      : _mean(mean), _amplitude(amplitude), _frequency(frequency) {}
+
+  double level(std::chrono::nanoseconds time) const override;
+
+private:
+  double _mean;
+  double _amplitude;
+  // in Hz
+  double _frequency;
+};
+
+// staircase of levels held for a given duration each, repeated at the end
+class StepLoadProfile : public LoadProfile {
+public:
+  StepLoadProfile(
+      std::vector<std::pair<double, std::chrono::nanoseconds>> const &steps);
+
+  double level(std::chrono::nanoseconds time) const override;
+
+private:
+  std::vector<std::pair<double, std::chrono::nanoseconds>> _steps;
+  std::chrono::nanoseconds _cycle;
+};
+
+// level set from the outside, e.g. by a controller
+class VariableLoadProfile : public LoadProfile {
+public:
+  VariableLoadProfile(double level) : _level(level) {}
+
+  double level(std::chrono::nanoseconds) const override { return _level; }
+
+  void setLevel(double level) { _level = level; }
+
+private:
+  std::atomic<double> _level;
+};
+
+// replay of recorded levels. each level is held until the time of the next
+// one, the last one until the end.
+class TraceLoadProfile : public LoadProfile {
+public:
+  TraceLoadProfile(
+      std::vector<std::pair<std::chrono::nanoseconds, double>> const &samples)
+      : _samples(samples) {}
+
+  // read a csv file with lines of the format SECONDS,LOAD
+  static std::unique_ptr<TraceLoadProfile> fromFile(std::string const &path);
+
+  double level(std::chrono::nanoseconds time) const override;
+
+private:
+  std::vector<std::pair<std::chrono::nanoseconds, double>> _samples;
+};
+
+} // namespace firestarter
@@ -22,20 +22,27 @@
 #pragma once
 
 #include <firestarter/Constants.hpp>
+#include <firestarter/ControlPlane.hpp>
 #include <firestarter/Environment/Environment.hpp>
+#include <firestarter/LoadWorkerMemory.hpp>
 
 #include <atomic>
-#include <mutex>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace firestarter {
 
 class LoadWorkerData {
 public:
   LoadWorkerData(int id, environment::Environment &environment,
+                 ControlPlane &controlPlane,
                  volatile unsigned long long *loadVar,
                  unsigned long long period, bool dumpRegisters)
       : addrHigh(loadVar), period(period), dumpRegisters(dumpRegisters),
-        _id(id), _environment(environment),
+        _id(id), _environment(environment), _controlPlane(controlPlane),
         _config(new environment::platform::RuntimeConfig(
             environment.selectedConfig())) {}
 
@@ -44,16 +51,24 @@ public:
   int id() const { return _id; }
   environment::Environment &environment() const { return _environment; }
   environment::platform::RuntimeConfig &config() const { return *_config; }
+  ControlPlane &controlPlane() const { return _controlPlane; }
 
-  int comm = THREAD_WAIT;
-  bool ack = false;
-  std::mutex mutex;
+  // the last epoch of the control plane acknowledged by this thread
+  alignas(64) std::atomic<uint32_t> epoch{0};
+  // the buffer of the thread. addrMem points into it.
+  std::unique_ptr<LoadWorkerMemory> memory;
+  LoadWorkerMemory::HugePages hugePages = LoadWorkerMemory::HugePages::Auto;
   unsigned long long *addrMem;
   volatile unsigned long long *addrHigh;
   unsigned long long buffersizeMem;
+  // name of the payload which initialized the buffer
+  std::string bufferPayload;
   unsigned long long iterations = 0;
   // save the last iteration count when switching payloads
   std::atomic<unsigned long long> lastIterations;
+  // the iterations of all payloads. updated whenever the thread leaves the
+  // high load function, so it can be read by other threads.
+  std::atomic<unsigned long long> totalIterations{0};
   unsigned long long flops;
   unsigned long long startTsc;
   unsigned long long stopTsc;
@@ -63,10 +78,17 @@ public:
   // used in low load routine to sleep 1/100th of this time
   unsigned long long period;
   bool dumpRegisters;
+  // threads with the same replica id share the compiled payload. -1 if the
+  // payload is compiled once by the master thread.
+  int payloadReplica = -1;
+  // pairs of load change count and timestamp recorded whenever the thread
+  // observes a load change. only used if the capacity is non-zero.
+  std::vector<std::pair<unsigned long long, unsigned long long>> loadChanges;
 
 private:
   int _id;
   environment::Environment &_environment;
+  ControlPlane &_controlPlane;
   environment::platform::RuntimeConfig *_config;
 };
 
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Environment/CPUTopology.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace firestarter {
+
+// The buffer of a load thread. It is bound to the NUMA node of the thread and
+// backed by the largest pages available.
+class LoadWorkerMemory {
+public:
+  enum class PageType { Normal, TransparentHuge, Huge2M, Huge1G };
+
+  // which pages should be tried for the allocation
+  enum class HugePages {
+    // explicit hugepages, then transparent hugepages, then normal pages
+    Auto,
+    // transparent hugepages, then normal pages
+    Transparent,
+    // normal pages only
+    Off
+  };
+
+  LoadWorkerMemory(LoadWorkerMemory const &) = delete;
+  LoadWorkerMemory &operator=(LoadWorkerMemory const &) = delete;
+  ~LoadWorkerMemory();
+
+  // allocate at least size bytes aligned to a page. the memory is bound to
+  // the NUMA node of cpu unless it is -1. returns nullptr on failure.
+  static std::unique_ptr<LoadWorkerMemory>
+  allocate(std::size_t size, HugePages hugePages,
+           environment::CPUTopology const &topology, int cpu);
+
+  void *data() const { return _data; }
+  std::size_t size() const { return _size; }
+  PageType pageType() const { return _pageType; }
+  bool bound() const { return _bound; }
+
+  static std::string pageTypeName(PageType pageType);
+
+private:
+  LoadWorkerMemory(void *data, std::size_t size, PageType pageType,
+                   bool bound, bool mapped,
+                   environment::CPUTopology const &topology)
+      : _data(data), _size(size), _pageType(pageType), _bound(bound),
+        _mapped(mapped), _topology(topology) {}
+
+  void *_data;
+  std::size_t _size;
+  PageType _pageType;
+  bool _bound;
+  // memory is allocated with mmap instead of hwloc
+  bool _mapped;
+  environment::CPUTopology const &_topology;
+};
+
+} // namespace firestarter
@@ -22,17 +22,28 @@
 #pragma once
 
 #include <firestarter/Logging/Log.hpp>
+#include <firestarter/Measurement/MetricStream.hpp>
 #include <firestarter/Measurement/Summary.hpp>
 #include <firestarter/Measurement/TimeValue.hpp>
+#include <firestarter/Measurement/TimeValueBuffer.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 extern "C" {
 #include <firestarter/Measurement/Metric/IPCEstimate.h>
+#include <firestarter/Measurement/Metric/LoadLevel.h>
+#include <firestarter/Measurement/Metric/MSR.h>
 #include <firestarter/Measurement/Metric/Perf.h>
 #include <firestarter/Measurement/Metric/RAPL.h>
+#include <firestarter/Measurement/Metric/Thermal.h>
 #include <firestarter/Measurement/MetricInterface.h>
 
 #include <pthread.h>
@@ -44,29 +55,97 @@ void insertCallback(void *cls, const char *metricName, int64_t timeSinceEpoch,
 namespace firestarter::measurement {
 
 class MeasurementWorker {
+public:
+  // the latest value of a metric or submetric
+  struct MetricSnapshot {
+    std::string name;
+    std::string unit;
+    // the value of absolute metrics and the rate per second of accumulative
+    // metrics, divided by the thread count if required
+    double value;
+    std::chrono::high_resolution_clock::time_point time;
+  };
+
 private:
   pthread_t workerThread;
   pthread_t stdinThread;
 
   std::vector<metric_interface_t *> metrics = {
-      &rapl_metric, &perf_ipc_metric, &perf_freq_metric, &ipc_estimate_metric};
-
-  std::mutex values_mutex;
-  std::map<std::string, std::vector<TimeValue>> values = {};
+      &rapl_metric,       &msr_rapl_metric,    &perf_ipc_metric,
+      &perf_freq_metric,  &perf_events_metric, &ipc_estimate_metric,
+      &load_level_metric, &thermal_metric};
+
+  // the values of an initialized metric or submetric. a submetric is named
+  // METRIC/SUBMETRIC.
+  struct MetricValues {
+    std::string name;
+    // the interface of the metric, of the parent for submetrics and nullptr
+    // for metrics from stdin
+    const metric_interface_t *metric;
+    // the ids of the submetrics
+    std::vector<std::size_t> submetrics;
+    std::unique_ptr<TimeValueBuffer> buffer;
+    bool lostWarning;
+    // the summary of the current measurement and the time of the next value
+    // to add to it
+    StreamingSummary summary;
+    std::chrono::high_resolution_clock::time_point nextSummaryTime;
+    // the latest value at the previous snapshot. the rate of accumulative
+    // metrics is calculated since then.
+    TimeValue snapshotValue;
+    bool hasSnapshotValue;
+    double snapshotRate;
+    bool hasSnapshotRate;
+  };
+
+  // the id of a metric is its index in this vector. entries are only added
+  // by initMetrics while holding metricValuesMutex.
+  std::mutex metricValuesMutex;
+  std::vector<std::unique_ptr<MetricValues>> metricValues = {};
+
+  // resolve names of the insert callback to ids. it does not change after
+  // initMetrics, so values can be inserted without locking.
+  std::unordered_map<std::string_view, std::size_t> metricIds = {};
+  std::atomic<bool> initialized = {false};
+
+  MetricValues &addMetricValues(std::string const &name,
+                                const metric_interface_t *metric);
+
+  // add the values of the current measurement that are older than the stop
+  // delta to the summary of a metric
+  void updateSummary(MetricValues &metricValues,
+                     std::chrono::high_resolution_clock::time_point now);
 
   static int *dataAcquisitionWorker(void *measurementWorker);
 
   static int *stdinDataAcquisitionWorker(void *measurementWorker);
 
+  // write the values of all metrics and the events to the stream. the values
+  // are read from the buffers, so the other threads never wait for it.
+  void streamWorker();
+
+  // add the values since the last call and the pending events to the stream
+  void collectStreamRecords();
+
+  // publish the latest value of every metric
+  void publishSnapshot();
+
   const metric_interface_t *findMetricByName(std::string metricName);
 
   std::chrono::milliseconds updateInterval;
 
   std::chrono::high_resolution_clock::time_point startTime;
+  std::chrono::milliseconds startDelta;
+  std::chrono::milliseconds stopDelta;
+  bool measurementStarted = false;
 
   // some metric values have to be devided by this
   const unsigned long long numThreads;
 
+  // the number of values per metric and the directory for spill files
+  const std::size_t bufferSize;
+  const std::string spillPath;
+
   std::string availableMetricsString;
 
 #ifndef FIRESTARTER_LINK_STATIC
@@ -75,12 +154,38 @@ private:
 
   std::vector<std::string> _stdinMetrics = {};
 
+  struct Event {
+    int64_t time;
+    std::string name;
+    std::string value;
+  };
+
+  std::unique_ptr<MetricStream> _stream;
+  std::thread _streamThread;
+  std::atomic<bool> _streamActive = {false};
+  bool _streamStop = false;
+  std::mutex _streamMutex;
+  std::condition_variable _streamStopAlert;
+  // the time of the next value of each metric to write to the stream
+  std::vector<std::chrono::high_resolution_clock::time_point> _streamTimes;
+
+  // events inserted since the last write to the stream
+  std::mutex _eventsMutex;
+  std::vector<Event> _events;
+
+  // replaced by the data acquisition thread after every measurement interval
+  // if enabled. readers take a reference with std::atomic_load.
+  std::atomic<bool> _publishSnapshots = {false};
+  std::shared_ptr<const std::vector<MetricSnapshot>> _snapshot;
+
 public:
   // creates the worker thread
   MeasurementWorker(std::chrono::milliseconds updateInterval,
                     unsigned long long numThreads,
                     std::vector<std::string> const &metricDylibs,
-                    std::vector<std::string> const &stdinMetrics);
+                    std::vector<std::string> const &stdinMetrics,
+                    std::size_t bufferSize = 1048576,
+                    std::string const &spillPath = "");
 
   // stops the worker threads
   ~MeasurementWorker();
@@ -94,8 +199,9 @@ public:
   // returns a list of metrics
   std::vector<std::string> metricNames();
 
-  // setup the selected metrics
-  // returns a vector with the names of inialized metrics
+  // setup the selected metrics. metrics which are not initialized yet are only
+  // added by the first call.
+  // returns a vector with the names of inialized metrics and their submetrics
   std::vector<std::string>
   initMetrics(std::vector<std::string> const &metricNames);
 
@@ -103,13 +209,45 @@ public:
   void insertCallback(const char *metricName, int64_t timeSinceEpoch,
                       double value);
 
-  // start the measurement
-  void startMeasurement();
-
-  // get the measurement values begining from measurement start until now.
-  std::map<std::string, Summary> getValues(
+  // start the measurement. the values of the first startDelta and the last
+  // stopDelta are not part of the summary.
+  void startMeasurement(
       std::chrono::milliseconds startDelta = std::chrono::milliseconds::zero(),
       std::chrono::milliseconds stopDelta = std::chrono::milliseconds::zero());
+
+  // get the summary of the measurement values begining from measurement start
+  // until now.
+  std::map<std::string, Summary> getValues();
+
+  // get the values of the measurement without the start and stop delta
+  std::map<std::string, std::vector<TimeValue>> getRawValues();
+
+  // write all values and events to destination until the worker is
+  // destroyed. returns EXIT_FAILURE if it cannot be opened.
+  int startStream(std::string const &destination, MetricStream::Format format);
+
+  // add an event, e.g. a load change, to the stream. does nothing if no
+  // stream is started.
+  void insertEvent(std::string const &name, std::string const &value);
+
+  // check if a stream is started, e.g. before formatting an event
+  bool streamActive() const {
+    return _streamActive.load(std::memory_order_relaxed);
+  }
+
+  // publish the latest values of all metrics after every measurement interval
+  void enableSnapshots() { _publishSnapshots = true; }
+
+  // the latest values of all metrics. returns nullptr if snapshots are not
+  // enabled or none was published yet. never waits for the data acquisition.
+  std::shared_ptr<const std::vector<MetricSnapshot>> snapshot() const {
+    return std::atomic_load(&_snapshot);
+  }
+
+  // get the summary of the values of one metric in the last window of time.
+  // returns EXIT_FAILURE if the metric is not initialized.
+  int getRecentValue(std::string const &metricName,
+                     std::chrono::milliseconds window, Summary &summary);
 };
 
 } // namespace firestarter::measurement
@@ -0,0 +1,33 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Measurement/MetricInterface.h>
+
+extern metric_interface_t msr_rapl_metric;
+
+// set the interval in microseconds in which the energy counters are sampled.
+void msr_rapl_metric_set_interval(uint32_t usec);
+
+// select the cpus of the load threads. the sampling thread of a package runs
+// on another cpu of the package if there is one.
+void msr_rapl_metric_set_load_cpus(const int *cpus, uint32_t count);
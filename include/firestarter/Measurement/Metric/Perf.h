@@ -26,3 +26,15 @@
 extern metric_interface_t perf_ipc_metric;
 
 extern metric_interface_t perf_freq_metric;
+
+extern metric_interface_t perf_events_metric;
+
+// select the cpus of the load threads on which perf_ipc_metric and
+// perf_freq_metric are measured. all cpus the process may run on are used if
+// this is not called.
+void perf_metric_set_cpus(const int *cpus, uint32_t count);
+
+// select the events of perf_events_metric as a comma separated list of generic
+// event names or NAME=rCODE with a raw event code in hex.
+// returns EXIT_SUCCESS if all events are valid.
+int32_t perf_events_metric_set_events(const char *eventList);
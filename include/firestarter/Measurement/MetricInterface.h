@@ -36,7 +36,10 @@ typedef struct {
            insert_callback : 1,
 					 // ignore the start and stop delta set by the user
 					 ignore_start_stop_delta : 1,
-           __reserved : 27;
+           // Set to report the values of submetrics with
+           // get_submetric_readings in addition to the value of the metric.
+           submetrics : 1,
+           __reserved : 26;
 } metric_type_t;
 // clang-format on
 
@@ -82,4 +85,14 @@ typedef struct {
                                                double),
                                       void *);
 
+  // If submetrics is set in the type, this function returns a NULL terminated
+  // list with the names of the submetrics. The list is valid after init.
+  const char **(*get_submetric_names)(void);
+
+  // If submetrics is set in the type, this function is called after every
+  // successful call of get_reading and copies the values of the submetrics
+  // which belong to this reading to values.
+  // Return EXIT_SUCCESS on success.
+  int32_t (*get_submetric_readings)(double *values);
+
 } metric_interface_t;
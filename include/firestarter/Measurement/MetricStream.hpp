@@ -0,0 +1,103 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Measurement/TimeValue.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace firestarter::measurement {
+
+// Write metric values and events to a file, a named pipe or a Unix socket.
+//
+// Records are collected in memory and written at once by flush(). In the
+// formats csv and jsonl every record is a line. The binary format starts with
+// the magic FSSTREAM and a uint32_t version followed by packed records in host
+// byte order, each starting with a uint8_t type:
+//   0 metric: uint32_t id, uint16_t length, name
+//   1 value:  uint32_t id, int64_t time, double value
+//   2 event:  int64_t time, uint16_t length, name, uint16_t length, value
+// Times are in nanoseconds since the epoch. Records are ordered by time for
+// each metric, but not across metrics and events.
+class MetricStream {
+public:
+  enum class Format { CSV, JSONL, Binary };
+
+  // parse the name of a format. returns EXIT_FAILURE if it is unknown.
+  static int parseFormat(std::string const &name, Format &format);
+
+  // a Unix socket is given as unix:PATH
+  MetricStream(std::string const &destination, Format format);
+  ~MetricStream();
+
+  MetricStream(MetricStream const &) = delete;
+  MetricStream &operator=(MetricStream const &) = delete;
+
+  // open the destination. returns EXIT_FAILURE and sets the error on failure.
+  // a named pipe fails with errno ENXIO until it is opened for reading.
+  int open();
+
+  bool isOpen() const { return _fd >= 0; }
+
+  // true if the destination is a named pipe
+  bool isPipe() const;
+
+  std::string const &destination() const { return _destination; }
+  std::string const &error() const { return _error; }
+
+  // the name of the metric with this id. must be added before its values.
+  void addMetric(std::size_t id, std::string const &name);
+
+  void addValue(std::size_t id, TimeValue const &value);
+
+  void addEvent(int64_t time, std::string const &name,
+                std::string const &value);
+
+  // the number of bytes collected since the last flush
+  std::size_t size() const { return _buffer.size(); }
+
+  // write the collected records. returns EXIT_FAILURE and sets the error if
+  // the destination cannot be written anymore.
+  int flush();
+
+private:
+  template <class T> void append(T const &value) {
+    _buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+  void appendString(std::string const &value);
+  void appendJsonString(std::string const &value);
+
+  const std::string _destination;
+  const Format _format;
+  int _fd = -1;
+  std::string _error;
+
+  // the names of the metrics by id
+  std::vector<std::string> _names;
+
+  std::string _buffer;
+};
+
+} // namespace firestarter::measurement
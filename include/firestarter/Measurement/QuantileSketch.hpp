@@ -0,0 +1,110 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+
+namespace firestarter::measurement {
+
+// A streaming quantile sketch with a relative accuracy (DDSketch). Values are
+// counted in buckets of logarithmically growing width, so the memory depends
+// only on the range of the values and not on their number.
+class QuantileSketch {
+public:
+  explicit QuantileSketch(double relativeAccuracy = 0.01)
+      : _gamma((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)),
+        _logGamma(std::log(_gamma)) {}
+
+  // add a value. NaN and infinite values have no bucket and are skipped.
+  void add(double value) {
+    if (!std::isfinite(value)) {
+      return;
+    }
+
+    if (std::fabs(value) < MinValue) {
+      _zeros++;
+    } else if (value > 0.0) {
+      _positive[index(value)]++;
+    } else {
+      _negative[index(-value)]++;
+    }
+    _count++;
+  }
+
+  uint64_t count() const { return _count; }
+
+  // get the q-quantile with q in [0,1]. returns 0 if there are no values.
+  double quantile(double q) const {
+    if (_count == 0) {
+      return 0.0;
+    }
+
+    auto rank = (uint64_t)(q * (double)(_count - 1));
+    uint64_t seen = 0;
+
+    // negative values with a higher index are smaller
+    for (auto it = _negative.rbegin(); it != _negative.rend(); ++it) {
+      seen += it->second;
+      if (seen > rank) {
+        return -value(it->first);
+      }
+    }
+
+    seen += _zeros;
+    if (seen > rank) {
+      return 0.0;
+    }
+
+    for (auto const &[i, count] : _positive) {
+      seen += count;
+      if (seen > rank) {
+        return value(i);
+      }
+    }
+
+    return value(_positive.rbegin()->first);
+  }
+
+private:
+  static constexpr double MinValue = 1e-9;
+
+  int index(double value) const {
+    return (int)std::ceil(std::log(value) / _logGamma);
+  }
+
+  // the value in the middle of the bucket
+  double value(int index) const {
+    return 2.0 * std::pow(_gamma, index) / (_gamma + 1.0);
+  }
+
+  double _gamma;
+  double _logGamma;
+
+  std::map<int, uint64_t> _positive = {};
+  std::map<int, uint64_t> _negative = {};
+  uint64_t _zeros = 0;
+  uint64_t _count = 0;
+};
+
+} // namespace firestarter::measurement
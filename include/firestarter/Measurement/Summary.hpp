@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <firestarter/Measurement/QuantileSketch.hpp>
 #include <firestarter/Measurement/TimeValue.hpp>
 
 #include <chrono>
@@ -41,10 +42,52 @@ struct Summary {
   double average;
   double stddev;
 
+  double min;
+  double max;
+
+  // the percentiles are estimated with a relative accuracy of 1%
+  double p50;
+  double p95;
+  double p99;
+
   static Summary calculate(std::vector<TimeValue>::iterator begin,
                            std::vector<TimeValue>::iterator end,
                            metric_type_t metricType,
                            unsigned long long numThreads);
 };
 
+// Summarize the values of a metric while they are added. Mean and variance
+// are updated with Welford's algorithm, so no values have to be stored.
+class StreamingSummary {
+public:
+  StreamingSummary() = default;
+  StreamingSummary(metric_type_t metricType, unsigned long long numThreads)
+      : _metricType(metricType), _numThreads(numThreads) {}
+
+  // add a raw value of the metric. values of accumulative metrics are
+  // converted to the rate since the previous value.
+  void push(TimeValue const &tv);
+
+  Summary summary() const;
+
+private:
+  void add(std::chrono::high_resolution_clock::time_point time, double value);
+
+  metric_type_t _metricType = {};
+  unsigned long long _numThreads = 1;
+
+  // the previous raw value of accumulative metrics
+  bool _hasPrevious = false;
+  TimeValue _previous;
+
+  size_t _count = 0;
+  std::chrono::high_resolution_clock::time_point _first;
+  std::chrono::high_resolution_clock::time_point _last;
+  double _mean = 0.0;
+  double _m2 = 0.0;
+  double _min = 0.0;
+  double _max = 0.0;
+  QuantileSketch _sketch;
+};
+
 } // namespace firestarter::measurement
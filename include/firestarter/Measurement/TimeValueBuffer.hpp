@@ -0,0 +1,154 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Measurement/TimeValue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace firestarter::measurement {
+
+// Bounded storage for the values of one metric.
+//
+// Values are appended by a single producer which neither locks nor allocates.
+// Any thread may read the values concurrently. If the buffer is full, the
+// oldest values are overwritten. If a spill file is given, spill() moves old
+// values to this file instead and new values are dropped while the buffer is
+// full.
+class TimeValueBuffer {
+public:
+  TimeValueBuffer(std::size_t capacity, std::string const &spillPath = "");
+  ~TimeValueBuffer();
+
+  TimeValueBuffer(TimeValueBuffer const &) = delete;
+  TimeValueBuffer &operator=(TimeValueBuffer const &) = delete;
+
+  // append a value. must not be called by more than one thread at a time.
+  void push(std::chrono::high_resolution_clock::time_point time,
+            double value) {
+    auto head = _head.load(std::memory_order_relaxed);
+
+    if (_spillFd >= 0 &&
+        head - _spilled.load(std::memory_order_acquire) >= _capacity) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    auto &entry = _entries[head % _capacity];
+    entry.time.store(time.time_since_epoch().count(),
+                     std::memory_order_relaxed);
+    entry.value.store(value, std::memory_order_relaxed);
+
+    // publish the entry to the readers
+    _head.store(head + 1, std::memory_order_release);
+  }
+
+  // ignore all values pushed before
+  void clear() {
+    _begin.store(_head.load(std::memory_order_acquire),
+                 std::memory_order_release);
+  }
+
+  // get a copy of the values with since <= time <= until in the order of
+  // insertion. the values are found with a binary search, which expects the
+  // values to be inserted in the order of their time.
+  std::vector<TimeValue>
+  values(std::chrono::high_resolution_clock::time_point since =
+             std::chrono::high_resolution_clock::time_point::min(),
+         std::chrono::high_resolution_clock::time_point until =
+             std::chrono::high_resolution_clock::time_point::max()) const;
+
+  // copy up to count of the newest values to values in the order of
+  // insertion. returns the number of copied values.
+  std::size_t latest(TimeValue *values, std::size_t count) const;
+
+  // move the values to the spill file once half of the buffer is used. must
+  // not be called by more than one thread at a time.
+  void spill();
+
+  // the number of values that were overwritten or dropped
+  uint64_t lost() const;
+
+private:
+  struct Entry {
+    std::atomic<int64_t> time;
+    std::atomic<double> value;
+  };
+
+  // the format of a value in the spill file
+  struct SpilledEntry {
+    int64_t time;
+    double value;
+  };
+
+  // the time of the entry with this index. it must be in the buffer.
+  int64_t time(uint64_t index) const {
+    return _entries[index % _capacity].time.load(std::memory_order_relaxed);
+  }
+
+  // the time of the entry with this index in the spill file
+  int64_t spilledTime(uint64_t index) const;
+
+  // find the first index in [begin, end) with a time not less than time, or
+  // greater than time if upper is set
+  template <class TimeFn>
+  static uint64_t search(uint64_t begin, uint64_t end, int64_t time,
+                         bool upper, TimeFn timeOf) {
+    while (begin < end) {
+      auto mid = begin + (end - begin) / 2;
+      auto t = timeOf(mid);
+      if (t < time || (upper && t == time)) {
+        begin = mid + 1;
+      } else {
+        end = mid;
+      }
+    }
+    return begin;
+  }
+
+  // copy the values with index in [begin, end) from the spill file
+  void readSpilled(uint64_t begin, uint64_t end,
+                   std::vector<TimeValue> &values) const;
+
+  const uint64_t _capacity;
+  std::unique_ptr<Entry[]> _entries;
+  std::string _spillPath;
+  int _spillFd = -1;
+  bool _spillFailed = false;
+
+  // the number of values pushed so far. written by the producer.
+  alignas(64) std::atomic<uint64_t> _head{0};
+  std::atomic<uint64_t> _dropped{0};
+
+  // the number of values in the spill file. written by spill().
+  alignas(64) std::atomic<uint64_t> _spilled{0};
+
+  // the index of the first value after the last clear
+  std::atomic<uint64_t> _begin{0};
+};
+
+} // namespace firestarter::measurement
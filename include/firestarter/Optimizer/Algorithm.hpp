@@ -21,8 +21,11 @@
 
 #pragma once
 
+#include <firestarter/Optimizer/Checkpoint.hpp>
 #include <firestarter/Optimizer/Population.hpp>
 
+#include <memory>
+
 namespace firestarter::optimizer {
 
 class Algorithm {
@@ -34,6 +37,15 @@ public:
                                std::size_t populationSize) = 0;
 
   virtual Population evolve(Population &pop) = 0;
+
+  // save the state of the algorithm to this checkpoint and resume from the
+  // state restored in it
+  void setCheckpoint(std::shared_ptr<Checkpoint> const &checkpoint) {
+    _checkpoint = checkpoint;
+  }
+
+protected:
+  std::shared_ptr<Checkpoint> _checkpoint;
 };
 
 } // namespace firestarter::optimizer
@@ -23,6 +23,9 @@
 
 #include <firestarter/Optimizer/Algorithm.hpp>
 
+#include <functional>
+#include <vector>
+
 namespace firestarter::optimizer::algorithm {
 
 class NSGA2 : public Algorithm {
@@ -36,6 +39,14 @@ public:
   firestarter::optimizer::Population
   evolve(firestarter::optimizer::Population &pop) override;
 
+protected:
+  // add the offspring of a generation to popnew. every call of
+  // createOffspring returns new offspring of the current population, as many
+  // as it has individuals.
+  virtual void addOffspring(
+      firestarter::optimizer::Population &popnew,
+      std::function<std::vector<Individual>()> const &createOffspring);
+
 private:
   unsigned _gen;
   double _cr;
@@ -0,0 +1,53 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <firestarter/Optimizer/Algorithm/NSGA2.hpp>
+
+namespace firestarter::optimizer::algorithm {
+
+// NSGA2 with pre-screening of the offspring by a surrogate model.
+//
+// Every generation creates several times the offspring of NSGA2. Offspring
+// that were already evaluated are added to the population for free. A
+// gaussian process per objective, fitted to all evaluations in the history,
+// predicts the fitness of the others. Only the given number of evaluations
+// with the best optimistic prediction (mean plus standard deviation) is
+// measured.
+class SurrogateNSGA2 : public NSGA2 {
+public:
+  SurrogateNSGA2(unsigned gen, double cr, double m, unsigned evaluations);
+  ~SurrogateNSGA2() {}
+
+protected:
+  void addOffspring(
+      firestarter::optimizer::Population &popnew,
+      std::function<std::vector<Individual>()> const &createOffspring)
+      override;
+
+private:
+  // number of individuals measured per generation
+  unsigned _evaluations;
+};
+
+} // namespace firestarter::optimizer::algorithm
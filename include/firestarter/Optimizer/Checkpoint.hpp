@@ -0,0 +1,69 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <vector>
+
+namespace firestarter::optimizer {
+
+// The state of an optimization that is saved to a file after every
+// evaluation, so that an interrupted optimization can be resumed.
+//
+// The file contains the individuals and metrics of the history in the same
+// format as the output of the optimization, the seed of the initial
+// population and the state of the algorithm after the last completed
+// generation.
+class Checkpoint {
+public:
+  Checkpoint(std::string const &path, std::string const &algorithm,
+             std::vector<std::string> const &payloadItems);
+  ~Checkpoint() {}
+
+  // restore the history, the seed and the state of the algorithm from the
+  // file. returns EXIT_FAILURE if it cannot be read or belongs to another
+  // optimization. a missing file is not an error.
+  int load();
+
+  // the seed of the random individuals of the initial population
+  unsigned seed() const { return _seed; }
+
+  // the state saved by the algorithm, null if there is none
+  nlohmann::json const &state() const { return _state; }
+
+  // save the history and the state of the algorithm
+  void save(nlohmann::json const &state);
+
+  // save the history with the last state of the algorithm
+  void save();
+
+private:
+  std::string _path;
+  std::string _algorithm;
+  std::vector<std::string> _payloadItems;
+  unsigned _seed;
+  nlohmann::json _state;
+};
+
+} // namespace firestarter::optimizer
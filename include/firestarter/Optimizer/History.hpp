@@ -25,17 +25,22 @@
 #include <firestarter/Logging/Log.hpp>
 #include <firestarter/Measurement/Summary.hpp>
 #include <firestarter/Optimizer/Individual.hpp>
+#include <firestarter/Optimizer/Trace.hpp>
 
 #include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <nlohmann/json.hpp>
+#include <numeric>
 #include <optional>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
@@ -68,31 +73,346 @@ private:
   inline static int MAX_ELEMENT_PRINT_COUNT = 20;
   inline static std::size_t MIN_COLUMN_WIDTH = 10;
 
+  using SummaryMap = std::map<std::string, firestarter::measurement::Summary>;
+
+  // maps individuals that run the same payload to the same key
+  inline static std::function<Individual(Individual const &)> _canonical;
+
+  // individuals with the same proportions of the payload items, e.g. 2:4 and
+  // 1:2, run the same mix of instructions and share their evaluation, unless
+  // a canonicalization is set.
+  inline static Individual key(Individual const &individual) {
+    if (_canonical) {
+      return _canonical(individual);
+    }
+
+    unsigned divisor = 0;
+    for (auto const &value : individual) {
+      divisor = std::gcd(divisor, value);
+    }
+
+    if (divisor <= 1) {
+      return individual;
+    }
+
+    Individual k;
+    k.reserve(individual.size());
+    for (auto const &value : individual) {
+      k.push_back(value / divisor);
+    }
+
+    return k;
+  }
+
+  struct KeyHash {
+    std::size_t operator()(Individual const &key) const {
+      std::size_t seed = key.size();
+      for (auto const &value : key) {
+        seed ^= std::hash<unsigned>()(value) + 0x9e3779b9 + (seed << 6) +
+                (seed >> 2);
+      }
+      return seed;
+    }
+  };
+
   inline static std::vector<Individual> _x = {};
-  inline static std::vector<
-      std::map<std::string, firestarter::measurement::Summary>>
-      _f = {};
+  inline static std::vector<SummaryMap> _f = {};
+
+  // the index in _x and _f of the first evaluation of every key
+  inline static std::unordered_map<Individual, std::size_t, KeyHash> _index =
+      {};
+
+  // evaluations of previous optimizations, loaded with loadPrevious
+  inline static std::unordered_map<Individual, SummaryMap, KeyHash> _previous =
+      {};
+
+  // the evaluations are also written to this trace if it is open
+  inline static std::unique_ptr<TraceWriter> _trace;
+
+  inline static std::string getHostname() {
+    char cHostname[256];
+    if (0 != gethostname(cHostname, sizeof(cHostname))) {
+      return "unknown";
+    }
+    return cHostname;
+  }
+
+  // the description of the optimization run
+  inline static nlohmann::json
+  info(std::string const &startTime,
+       std::vector<std::string> const &payloadItems, const int argc,
+       const char **argv) {
+    using json = nlohmann::json;
+
+    json j = json::object();
+
+    j["hostname"] = getHostname();
+    j["startTime"] = startTime;
+
+    // save the payload items
+    j["payloadItems"] = json::array();
+    for (auto const &item : payloadItems) {
+      j["payloadItems"].push_back(item);
+    }
+
+    // save the arguments
+    j["args"] = json::array();
+    for (int i = 0; i < argc; ++i) {
+      j["args"].push_back(argv[i]);
+    }
+
+    return j;
+  }
+
+  // write j to path without creating a string of the whole output
+  inline static int writeJson(std::string const &path,
+                              nlohmann::json const &j) {
+    firestarter::log::info() << "\nDumping output json in " << path;
+
+    std::ofstream fp(path);
+
+    if (!fp.is_open()) {
+      firestarter::log::error() << "Could not open " << path;
+      return EXIT_FAILURE;
+    }
+
+    fp << j;
+
+    fp.close();
+
+    return EXIT_SUCCESS;
+  }
 
 public:
+  // set the function that maps an individual to the smallest individual with
+  // the same high load loop. it has to be set before any evaluation is added.
+  inline static void
+  setCanonical(std::function<Individual(Individual const &)> canonical) {
+    _canonical = std::move(canonical);
+  }
+
+  inline static std::vector<Individual> const &x() { return _x; }
+  inline static std::vector<
+      std::map<std::string, firestarter::measurement::Summary>> const &
+  f() {
+    return _f;
+  }
+
   inline static void append(
       std::vector<unsigned> const &ind,
       std::map<std::string, firestarter::measurement::Summary> const &metric) {
     _x.push_back(ind);
     _f.push_back(metric);
+
+    _index.emplace(key(ind), _x.size() - 1);
+
+    if (_trace) {
+      _trace->writeIndividual(_x.size() - 1, ind, metric);
+    }
+  }
+
+  // write the evaluations to a binary trace while the optimization runs. a
+  // resumed optimization continues its existing trace, otherwise the
+  // individuals that are already known are written to a new one. returns
+  // EXIT_FAILURE if it cannot be created.
+  inline static int openTrace(std::string const &path,
+                              std::string const &startTime,
+                              std::vector<std::string> const &payloadItems,
+                              const int argc, const char **argv, bool resume) {
+    auto trace = std::make_unique<TraceWriter>();
+
+    if (resume && !_x.empty() && std::ifstream(path).good()) {
+      if (EXIT_SUCCESS != trace->resume(path, _x.size())) {
+        return EXIT_FAILURE;
+      }
+    } else {
+      if (EXIT_SUCCESS != trace->open(path)) {
+        return EXIT_FAILURE;
+      }
+
+      trace->writeInfo(info(startTime, payloadItems, argc, argv).dump());
+
+      for (std::size_t i = 0; i < _x.size(); i++) {
+        trace->writeIndividual(i, _x[i], _f[i]);
+      }
+    }
+
+    _trace = std::move(trace);
+
+    return EXIT_SUCCESS;
+  }
+
+  inline static bool tracing() { return _trace != nullptr; }
+
+  // add the measured values of the evaluation of the individual that is
+  // appended next to the trace
+  inline static void appendSeries(
+      std::map<std::string,
+               std::vector<firestarter::measurement::TimeValue>> const
+          &series) {
+    if (!_trace) {
+      return;
+    }
+
+    for (auto const &[metric, values] : series) {
+      _trace->writeSeries(_x.size(), metric, values);
+    }
+  }
+
+  // flush the trace to the disk. a checkpoint must not be ahead of the trace,
+  // otherwise the trace cannot be resumed.
+  inline static void syncTrace() {
+    if (_trace) {
+      _trace->sync();
+    }
+  }
+
+  inline static void closeTrace() {
+    if (!_trace) {
+      return;
+    }
+
+    _trace->writeInfo(nlohmann::json{{"endTime", getTime()}}.dump());
+    _trace.reset();
+  }
+
+  // convert a binary trace to the json output of save. the output is written
+  // to outpath or the path of the trace with the suffix .json if it is empty.
+  inline static int convertTrace(std::string const &path,
+                                 std::string const &outpath) {
+    using json = nlohmann::json;
+
+    json j = json::object();
+    j["individuals"] = json::array();
+    j["metrics"] = json::array();
+
+    TraceReader reader;
+    auto returnCode = reader.read(
+        path, [&j](std::string const &info) { j.update(json::parse(info)); },
+        [&j](uint64_t, std::vector<unsigned> const &individual,
+             std::map<std::string, firestarter::measurement::Summary> const
+                 &metrics) {
+          j["individuals"].push_back(individual);
+          j["metrics"].push_back(metrics);
+        },
+        nullptr);
+
+    if (EXIT_SUCCESS != returnCode) {
+      firestarter::log::error() << reader.error();
+      return EXIT_FAILURE;
+    }
+
+    return writeJson(outpath.empty() ? path + ".json" : outpath, j);
   }
 
   inline static std::optional<
       std::map<std::string, firestarter::measurement::Summary>>
   find(std::vector<unsigned> const &individual) {
-    auto findEqual = [individual](auto const &ind) {
-      return ind == individual;
-    };
-    auto ind = std::find_if(_x.begin(), _x.end(), findEqual);
-    if (ind == _x.end()) {
+    auto it = _index.find(key(individual));
+    if (it == _index.end()) {
+      return {};
+    }
+    return _f[it->second];
+  }
+
+  // find the evaluation of an individual in the previous optimizations
+  inline static std::optional<
+      std::map<std::string, firestarter::measurement::Summary>>
+  findPrevious(std::vector<unsigned> const &individual) {
+    auto it = _previous.find(key(individual));
+    if (it == _previous.end()) {
       return {};
     }
-    auto dist = std::distance(_x.begin(), ind);
-    return _f[dist];
+    return it->second;
+  }
+
+  // the evaluations of the previous optimizations by their canonical
+  // individual
+  inline static auto const &previous() { return _previous; }
+
+  // load the evaluations of a previous optimization from its output file, so
+  // they do not have to be measured again. payload items are matched by
+  // name. evaluations that use unknown items or lack one of the metrics are
+  // skipped. returns EXIT_FAILURE if the file cannot be read.
+  inline static int loadPrevious(std::string const &path,
+                                 std::vector<std::string> const &payloadItems,
+                                 std::vector<std::string> const &metrics) {
+    using json = nlohmann::json;
+
+    std::ifstream fp(path);
+
+    if (!fp.is_open()) {
+      firestarter::log::error() << "Could not open " << path;
+      return EXIT_FAILURE;
+    }
+
+    std::size_t loaded = 0;
+
+    try {
+      json j;
+      fp >> j;
+
+      auto items = j["payloadItems"].get<std::vector<std::string>>();
+      auto const &individuals = j["individuals"];
+      auto const &summaries = j["metrics"];
+
+      if (individuals.size() != summaries.size()) {
+        throw std::invalid_argument("number of individuals and metrics differ");
+      }
+
+      // the position of the items of the file in payloadItems
+      std::vector<std::optional<std::size_t>> position;
+      for (auto const &item : items) {
+        auto it = std::find(payloadItems.begin(), payloadItems.end(), item);
+        if (it == payloadItems.end()) {
+          position.push_back({});
+        } else {
+          position.push_back(std::distance(payloadItems.begin(), it));
+        }
+      }
+
+      for (std::size_t i = 0; i < individuals.size(); ++i) {
+        auto ind = individuals[i].get<Individual>();
+        if (ind.size() != items.size()) {
+          throw std::invalid_argument("individual does not match payloadItems");
+        }
+
+        auto summary = summaries[i].get<SummaryMap>();
+        auto hasMetric = [&summary](std::string const &metric) {
+          return summary.count(metric) != 0;
+        };
+        if (!std::all_of(metrics.begin(), metrics.end(), hasMetric)) {
+          continue;
+        }
+
+        Individual mapped(payloadItems.size(), 0);
+        bool known = true;
+        for (std::size_t k = 0; k < ind.size(); ++k) {
+          if (ind[k] == 0) {
+            continue;
+          }
+          if (!position[k].has_value()) {
+            known = false;
+            break;
+          }
+          mapped[*position[k]] = ind[k];
+        }
+
+        if (known && _previous.emplace(key(mapped), summary).second) {
+          ++loaded;
+        }
+      }
+    } catch (std::exception const &e) {
+      firestarter::log::error() << "Could not read " << path << ": "
+                                << e.what();
+      return EXIT_FAILURE;
+    }
+
+    firestarter::log::info() << "Loaded " << loaded
+                             << " evaluations of a previous optimization from "
+                             << path;
+
+    return EXIT_SUCCESS;
   }
 
   inline static void
@@ -234,37 +554,9 @@ public:
       j["metrics"].push_back(eval);
     }
 
-    // get the hostname
-    char cHostname[256];
-    std::string hostname;
-    if (0 != gethostname(cHostname, sizeof(cHostname))) {
-      hostname = "unknown";
-    } else {
-      hostname = cHostname;
-    }
-
-    j["hostname"] = hostname;
-
-    j["startTime"] = startTime;
+    j.update(info(startTime, payloadItems, argc, argv));
     j["endTime"] = getTime();
 
-    // save the payload items
-    j["payloadItems"] = json::array();
-    for (auto const &item : payloadItems) {
-      j["payloadItems"].push_back(item);
-    }
-
-    // save the arguments
-    j["args"] = json::array();
-    for (int i = 0; i < argc; ++i) {
-      j["args"].push_back(argv[i]);
-    }
-
-    // dump the output
-    std::string s = j.dump();
-
-    firestarter::log::trace() << s;
-
     std::string outpath = path;
     if (outpath.empty()) {
       char *pwd = get_current_dir_name();
@@ -275,21 +567,10 @@ public:
         firestarter::log::warn() << "Could not find $PWD.";
         outpath = "/tmp";
       }
-      outpath += "/" + hostname + "_" + startTime + ".json";
+      outpath += "/" + getHostname() + "_" + startTime + ".json";
     }
 
-    firestarter::log::info() << "\nDumping output json in " << outpath;
-
-    std::ofstream fp(outpath);
-
-    if (fp.bad()) {
-      firestarter::log::error() << "Could not open " << outpath;
-      return;
-    }
-
-    fp << s;
-
-    fp.close();
+    writeJson(outpath, j);
   }
 
   inline static std::string getTime() {
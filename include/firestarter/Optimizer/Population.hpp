@@ -22,6 +22,7 @@
 #ifndef FIRESTARTER_OPTIMIZER_POPULATION_HPP
 #define FIRESTARTER_OPTIMIZER_POPULATION_HPP
 
+#include <firestarter/Optimizer/Checkpoint.hpp>
 #include <firestarter/Optimizer/History.hpp>
 #include <firestarter/Optimizer/Individual.hpp>
 #include <firestarter/Optimizer/Problem.hpp>
@@ -44,12 +45,14 @@ public:
       : _problem(std::move(problem)), gen(rd()) {}
 
   Population(Population &pop)
-      : _problem(pop._problem), _x(pop._x), _f(pop._f), gen(rd()) {}
+      : _problem(pop._problem), _x(pop._x), _f(pop._f),
+        _checkpoint(pop._checkpoint), gen(rd()) {}
 
   Population &operator=(Population const &pop) {
     _problem = std::move(pop._problem);
     _x = pop._x;
     _f = pop._f;
+    _checkpoint = pop._checkpoint;
     gen = pop.gen;
 
     return *this;
@@ -79,6 +82,15 @@ public:
   std::vector<Individual> const &x() const { return _x; }
   std::vector<std::vector<double>> const &f() const { return _f; }
 
+  // save the checkpoint after every new evaluation
+  void setCheckpoint(std::shared_ptr<Checkpoint> const &checkpoint) {
+    _checkpoint = checkpoint;
+  }
+  std::shared_ptr<Checkpoint> const &checkpoint() const { return _checkpoint; }
+
+  // seed the generator of random individuals
+  void seed(unsigned seed) { gen.seed(seed); }
+
 private:
   // add one individual to the population with a fitness.
   void append(Individual const &ind, std::vector<double> const &fit);
@@ -89,6 +101,8 @@ private:
   std::vector<Individual> _x;
   std::vector<std::vector<double>> _f;
 
+  std::shared_ptr<Checkpoint> _checkpoint;
+
   std::random_device rd;
   std::mt19937 gen;
 };
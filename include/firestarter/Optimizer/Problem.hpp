@@ -42,7 +42,7 @@ public:
 
   virtual std::vector<double>
   fitness(std::map<std::string, firestarter::measurement::Summary> const
-              &summaries) = 0;
+              &summaries) const = 0;
 
   // get the bounds of the problem
   virtual std::vector<std::tuple<unsigned, unsigned>> getBounds() const = 0;
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <firestarter/Optimizer/History.hpp>
 #include <firestarter/Optimizer/Problem.hpp>
 
 #include <cassert>
@@ -73,7 +74,7 @@ public:
     // start the measurement
     // NOTE: starting the measurement must happen after switching to not mess up
     // ipc-estimate metric
-    _measurementWorker->startMeasurement();
+    _measurementWorker->startMeasurement(_startDelta, _stopDelta);
 
     // wait for the measurement to finish
     std::this_thread::sleep_for(_timeout);
@@ -83,13 +84,18 @@ public:
     // last payload, which we use to estimate the ipc.
     _changePayloadFunction(payload);
 
+    // keep the measured values in the trace of the optimization
+    if (History::tracing()) {
+      History::appendSeries(_measurementWorker->getRawValues());
+    }
+
     // return the results
-    return _measurementWorker->getValues(_startDelta, _stopDelta);
+    return _measurementWorker->getValues();
   }
 
   std::vector<double> fitness(
       std::map<std::string, firestarter::measurement::Summary> const &summaries)
-      override {
+      const override {
     std::vector<double> values = {};
 
     for (auto const &metricName : _metrics) {
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#pragma once
+
+#include <firestarter/Measurement/Summary.hpp>
+#include <firestarter/Measurement/TimeValue.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace firestarter::optimizer {
+
+// Binary columnar trace of an optimization.
+//
+// The file starts with the magic FSTRACE\0, a uint32_t version and a uint32_t
+// reserved field. It is followed by blocks, which are appended as the
+// evaluations finish. Every block has a header of uint32_t type, uint32_t
+// reserved and uint64_t size, followed by size bytes of data padded to a
+// multiple of 8 bytes. All values are in host byte order and 8 byte aligned
+// in the file, so the file can be memory-mapped. Block types:
+//   1 info:       a JSON object with the hostname, startTime, payloadItems and
+//                 args at the start and the endTime at the end
+//   2 metric:     uint32_t id, uint32_t length, name
+//   3 individual: uint64_t index, uint32_t items, uint32_t summaries,
+//                 uint32_t item[items] padded to 8 bytes,
+//                 trace::Summary[summaries]
+//   4 series:     uint64_t index, uint32_t metric id, uint32_t reserved,
+//                 uint64_t count, int64_t time[count], double value[count]
+// The series of an individual contain the measured values of its evaluation
+// with times in nanoseconds since the epoch.
+namespace trace {
+
+enum BlockType : uint32_t { INFO = 1, METRIC = 2, INDIVIDUAL = 3, SERIES = 4 };
+
+struct BlockHeader {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t size;
+};
+
+struct Summary {
+  uint32_t metric;
+  uint32_t reserved;
+  uint64_t numTimepoints;
+  int64_t durationMs;
+  double average;
+  double stddev;
+  double min;
+  double max;
+  double p50;
+  double p95;
+  double p99;
+};
+
+static_assert(sizeof(BlockHeader) == 16, "unexpected padding");
+static_assert(sizeof(Summary) == 80, "unexpected padding");
+
+const char MAGIC[8] = {'F', 'S', 'T', 'R', 'A', 'C', 'E', '\0'};
+const uint32_t VERSION = 1;
+
+} // namespace trace
+
+class TraceWriter {
+public:
+  TraceWriter() = default;
+  ~TraceWriter();
+
+  TraceWriter(TraceWriter const &) = delete;
+  TraceWriter &operator=(TraceWriter const &) = delete;
+
+  // create the file and write the header. returns EXIT_FAILURE on error.
+  int open(std::string const &path);
+
+  // continue an existing trace after the individual with the index
+  // individuals - 1. the blocks after it, e.g. of an interrupted evaluation,
+  // are removed. returns EXIT_FAILURE if the file is not a trace or does not
+  // contain this individual.
+  int resume(std::string const &path, uint64_t individuals);
+
+  void writeInfo(std::string const &json);
+
+  void writeIndividual(
+      uint64_t index, std::vector<unsigned> const &individual,
+      std::map<std::string, firestarter::measurement::Summary> const &metrics);
+
+  void writeSeries(uint64_t index, std::string const &metric,
+                   std::vector<firestarter::measurement::TimeValue> const
+                       &values);
+
+  // flush the written blocks to the disk
+  void sync();
+
+private:
+  // the id of a metric. writes a metric block for new names.
+  uint32_t metricId(std::string const &name);
+
+  void writeBlock(uint32_t type, std::string const &data);
+
+  std::string _path;
+  int _fd = -1;
+  bool _failed = false;
+  std::map<std::string, uint32_t> _metricIds;
+};
+
+// Memory-map a trace and call the callbacks for its blocks in the order of
+// the file. An incomplete block at the end, e.g. of a trace that is still
+// written, is ignored.
+class TraceReader {
+public:
+  using InfoCallback = std::function<void(std::string const &json)>;
+  using IndividualCallback = std::function<void(
+      uint64_t index, std::vector<unsigned> const &individual,
+      std::map<std::string, firestarter::measurement::Summary> const
+          &metrics)>;
+  using SeriesCallback = std::function<void(
+      uint64_t index, std::string const &metric, std::size_t count,
+      const int64_t *times, const double *values)>;
+
+  // returns EXIT_FAILURE and sets the error if the file is not a trace or
+  // the counts of a block point past its end
+  int read(std::string const &path, InfoCallback const &info,
+           IndividualCallback const &individual,
+           SeriesCallback const &series);
+
+  std::string const &error() const { return _error; }
+
+private:
+  std::string _error;
+};
+
+} // namespace firestarter::optimizer
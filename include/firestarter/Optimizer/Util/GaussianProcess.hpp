@@ -0,0 +1,67 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace firestarter::optimizer::util {
+
+// Gaussian process regression with a squared exponential kernel. It is used
+// as a cheap surrogate of the measured fitness.
+//
+// The values are normalized to zero mean and unit variance. The length scale
+// of the kernel is the median distance between the points and a constant
+// noise accounts for the variance of the measurements.
+class GaussianProcess {
+public:
+  GaussianProcess() = default;
+  ~GaussianProcess() {}
+
+  // fit the process to the values y at the points x
+  void fit(std::vector<std::vector<double>> const &x,
+           std::vector<double> const &y);
+
+  // the mean and standard deviation of the prediction at x
+  std::pair<double, double> predict(std::vector<double> const &x) const;
+
+private:
+  double kernel(std::vector<double> const &a,
+                std::vector<double> const &b) const;
+
+  // solve L * out = b for the lower triangular matrix L
+  std::vector<double> solveLower(std::vector<double> const &b) const;
+
+  std::vector<std::vector<double>> _x;
+  // cholesky factor of the kernel matrix
+  std::vector<std::vector<double>> _l;
+  // inverse of the kernel matrix multiplied with the normalized values
+  std::vector<double> _alpha;
+
+  double _mean = 0.0;
+  double _scale = 1.0;
+  double _lengthScale = 1.0;
+  double _noise = 1e-2;
+};
+
+} // namespace firestarter::optimizer::util
@@ -23,6 +23,7 @@
 #include <firestarter/Logging/Log.hpp>
 
 #include <array>
+#include <cstdlib>
 #include <fstream>
 #include <regex>
 
@@ -368,6 +369,76 @@ int CPUTopology::getPkgIdFromPU(unsigned pu) const {
   return -1;
 }
 
+hwloc_obj_t CPUTopology::getNumaNodeFromPU(unsigned pu) const {
+  int width;
+  hwloc_obj_t obj;
+
+  // numa nodes are not necessarily parents of the PUs, therefore search for
+  // the node that contains the PU in its cpuset.
+  width = hwloc_get_nbobjs_by_type(this->topology, HWLOC_OBJ_NUMANODE);
+
+  for (int i = 0; i < width; i++) {
+    obj = hwloc_get_obj_by_type(this->topology, HWLOC_OBJ_NUMANODE, i);
+    if (obj->cpuset != nullptr && hwloc_bitmap_isset(obj->cpuset, pu)) {
+      return obj;
+    }
+  }
+
+  return nullptr;
+}
+
+int CPUTopology::getNumaNodeIdFromPU(unsigned pu) const {
+  hwloc_obj_t obj = this->getNumaNodeFromPU(pu);
+
+  if (obj == nullptr) {
+    return -1;
+  }
+
+  return obj->logical_index;
+}
+
+int CPUTopology::getNumaNodeOsIdFromPU(unsigned pu) const {
+  hwloc_obj_t obj = this->getNumaNodeFromPU(pu);
+
+  if (obj == nullptr) {
+    return -1;
+  }
+
+  return obj->os_index;
+}
+
+int CPUTopology::bindMemoryToPU(void *addr, std::size_t size,
+                                unsigned pu) const {
+  hwloc_obj_t obj = this->getNumaNodeFromPU(pu);
+
+  if (obj == nullptr) {
+    return EXIT_FAILURE;
+  }
+
+  if (0 != hwloc_set_area_membind(this->topology, addr, size, obj->nodeset,
+                                  HWLOC_MEMBIND_BIND,
+                                  HWLOC_MEMBIND_BYNODESET)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+void *CPUTopology::allocateMemoryOnPU(std::size_t size, int pu) const {
+  hwloc_obj_t obj = pu == -1 ? nullptr : this->getNumaNodeFromPU(pu);
+
+  if (obj == nullptr) {
+    return hwloc_alloc(this->topology, size);
+  }
+
+  return hwloc_alloc_membind(this->topology, size, obj->nodeset,
+                             HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+}
+
+void CPUTopology::freeMemory(void *addr, std::size_t size) const {
+  hwloc_free(this->topology, addr, size);
+}
+
 unsigned CPUTopology::maxNumThreads() const {
   hwloc_obj_t obj;
   int width = hwloc_get_nbobjs_by_type(this->topology, HWLOC_OBJ_PU);
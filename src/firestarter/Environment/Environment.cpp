@@ -22,8 +22,10 @@
 #include <firestarter/Environment/Environment.hpp>
 #include <firestarter/Logging/Log.hpp>
 
+#include <algorithm>
 #include <iterator>
 #include <regex>
+#include <sstream>
 #include <string>
 
 using namespace firestarter::environment;
@@ -78,6 +80,48 @@ int Environment::cpuAllowed(unsigned id) {
 }
 #endif
 
+int Environment::parseCpuList(std::string const &cpuList,
+                              std::vector<unsigned> &cpus) {
+  const std::regex re("^(?:(\\d+)(?:-([1-9]\\d*)(?:\\/([1-9]\\d*))?)?)$");
+
+  std::stringstream ss(cpuList);
+
+  while (ss.good()) {
+    std::string token;
+    std::smatch m;
+    std::getline(ss, token, ',');
+
+    if (std::regex_match(token, m, re)) {
+      unsigned long x, y, s;
+
+      x = std::stoul(m[1].str());
+      if (m[2].matched) {
+        y = std::stoul(m[2].str());
+      } else {
+        y = x;
+      }
+      if (m[3].matched) {
+        s = std::stoul(m[3].str());
+      } else {
+        s = 1;
+      }
+      if (y < x) {
+        log::error() << "y has to be >= x in x-y expressions of CPU list: "
+                     << token;
+        return EXIT_FAILURE;
+      }
+      for (unsigned long i = x; i <= y; i += s) {
+        cpus.push_back(i);
+      }
+    } else {
+      log::error() << "Invalid symbols in CPU list: " << token;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
 int Environment::evaluateCpuAffinity(unsigned requestedNumThreads,
                                      std::string cpuBind) {
 #if not((defined(linux) || defined(__linux__)) &&                              \
@@ -135,44 +179,15 @@ int Environment::evaluateCpuAffinity(unsigned requestedNumThreads,
     }
   } else {
     // parse CPULIST for binding
-    const std::string delimiter = ",";
-    const std::regex re("^(?:(\\d+)(?:-([1-9]\\d*)(?:\\/([1-9]\\d*))?)?)$");
-
-    std::stringstream ss(cpuBind);
-
-    while (ss.good()) {
-      std::string token;
-      std::smatch m;
-      std::getline(ss, token, ',');
-      ;
+    std::vector<unsigned> cpus;
 
-      if (std::regex_match(token, m, re)) {
-        unsigned long x, y, s;
+    if (EXIT_SUCCESS != parseCpuList(cpuBind, cpus)) {
+      return EXIT_FAILURE;
+    }
 
-        x = std::stoul(m[1].str());
-        if (m[2].matched) {
-          y = std::stoul(m[2].str());
-        } else {
-          y = x;
-        }
-        if (m[3].matched) {
-          s = std::stoul(m[3].str());
-        } else {
-          s = 1;
-        }
-        if (y < x) {
-          log::error() << "y has to be >= x in x-y expressions of CPU list: "
-                       << token;
-          return EXIT_FAILURE;
-        }
-        for (unsigned long i = x; i <= y; i += s) {
-          ADD_CPU_SET(i, cpuset);
-          requestedNumThreads++;
-        }
-      } else {
-        log::error() << "Invalid symbols in CPU list: " << token;
-        return EXIT_FAILURE;
-      }
+    for (auto const &cpu : cpus) {
+      ADD_CPU_SET(cpu, cpuset);
+      requestedNumThreads++;
     }
   }
 #else
@@ -248,3 +263,32 @@ int Environment::setCpuAffinity(unsigned thread) {
 
   return EXIT_SUCCESS;
 }
+
+int Environment::getCpuIdOfThread(unsigned thread) const {
+#if (defined(linux) || defined(__linux__)) &&                                  \
+    defined(FIRESTARTER_THREAD_AFFINITY)
+  if (thread < this->cpuBind.size()) {
+    return this->cpuBind[thread];
+  }
+#else
+  (void)thread;
+#endif
+
+  return -1;
+}
+
+int Environment::getThreadGroupOfThread(unsigned thread) const {
+  // without binding the CPU lists select the thread numbers
+  int cpu = this->getCpuIdOfThread(thread);
+  unsigned id = cpu == -1 ? thread : cpu;
+
+  for (std::size_t i = 0; i < this->_threadGroups.size(); i++) {
+    auto const &cpus = this->_threadGroups[i].cpus;
+
+    if (std::find(cpus.begin(), cpus.end(), id) != cpus.end()) {
+      return i;
+    }
+  }
+
+  return -1;
+}
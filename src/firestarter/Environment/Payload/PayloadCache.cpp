@@ -0,0 +1,118 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/Environment/Payload/PayloadCache.hpp>
+
+#include <cstdlib>
+
+using namespace firestarter::environment::payload;
+
+std::shared_ptr<Payload> PayloadCache::get(
+    Payload const &payload,
+    std::vector<std::pair<std::string, unsigned>> const &proportion,
+    unsigned instructionCacheSize,
+    std::list<unsigned> const &dataCacheBufferSize, unsigned ramBufferSize,
+    unsigned thread, unsigned numberOfLines, bool dumpRegisters, int replica) {
+  Key key(payload.name(), proportion, instructionCacheSize,
+          dataCacheBufferSize, ramBufferSize, thread, numberOfLines,
+          dumpRegisters, replica);
+  std::shared_ptr<Entry> entry;
+
+  {
+    std::lock_guard<std::mutex> lk(_mutex);
+
+    auto &slot = _entries[key];
+    if (!slot) {
+      slot = std::make_shared<Entry>();
+    }
+    slot->lastUse = ++_useCount;
+
+    entry = slot;
+  }
+
+  std::lock_guard<std::mutex> entryLk(entry->mutex);
+
+  if (entry->payload) {
+    return entry->payload;
+  }
+
+  std::shared_ptr<Payload> compiled(payload.clone());
+
+  if (EXIT_SUCCESS !=
+      compiled->compilePayload(proportion, instructionCacheSize,
+                               dataCacheBufferSize, ramBufferSize, thread,
+                               numberOfLines, dumpRegisters)) {
+    // do not cache failed compilations
+    std::lock_guard<std::mutex> lk(_mutex);
+
+    auto it = _entries.find(key);
+    if (it != _entries.end() && it->second == entry) {
+      _entries.erase(it);
+    }
+
+    return nullptr;
+  }
+
+  {
+    // evict reads the payload of all entries
+    std::lock_guard<std::mutex> lk(_mutex);
+
+    entry->payload = compiled;
+
+    evict();
+  }
+
+  return compiled;
+}
+
+void PayloadCache::setCapacity(std::size_t capacity) {
+  std::lock_guard<std::mutex> lk(_mutex);
+
+  _capacity = capacity;
+
+  evict();
+}
+
+void PayloadCache::evict() {
+  while (_entries.size() > _capacity) {
+    auto lru = _entries.end();
+
+    for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+      auto const &entry = it->second;
+
+      // skip entries which are compiled right now or used by a thread
+      if (entry.use_count() != 1 || !entry->payload ||
+          entry->payload.use_count() != 1) {
+        continue;
+      }
+
+      if (lru == _entries.end() || entry->lastUse < lru->second->lastUse) {
+        lru = it;
+      }
+    }
+
+    if (lru == _entries.end()) {
+      break;
+    }
+
+    _entries.erase(lru);
+  }
+}
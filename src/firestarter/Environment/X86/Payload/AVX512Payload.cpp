@@ -20,11 +20,136 @@
  *****************************************************************************/
 
 #include <firestarter/Environment/X86/Payload/AVX512Payload.hpp>
+#include <firestarter/Environment/X86/Payload/InstructionGroups.hpp>
 
 using namespace firestarter::environment::x86::payload;
 using namespace asmjit;
 using namespace asmjit::x86;
 
+namespace {
+struct AVX512Context {
+  Builder &cb;
+  AddressStreams mem;
+  Gp temp;
+  std::vector<Gp> const &shiftRegs;
+  std::vector<Gp> const &shiftRegs32;
+  Zmm ram;
+  RegisterRing add;
+  RegisterRing trans;
+  ShiftRotation shift;
+
+  void next() {
+    if (shift.left()) {
+      cb.shr(shiftRegs32[shift.current()], Imm(1));
+    } else {
+      cb.shl(shiftRegs32[shift.current()], Imm(1));
+    }
+    add.next();
+    shift.next();
+  }
+};
+
+const InstructionGroups<AVX512Context> groups = {
+    {"REG",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.cb.vfmadd231pd(Zmm(c.trans.current()), zmm2, zmm1);
+       c.cb.xor_(c.shiftRegs[c.shift.neighbour(-1)], c.temp);
+       c.trans.next();
+     }},
+    {"L1_L",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm1, zmmword_ptr(c.mem.l1, 64));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_BROADCAST",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.cb.vbroadcastsd(Zmm(c.add.current()), ptr_64(c.mem.l1, 64));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_S",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.l1, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_LS",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.l1, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmmword_ptr(c.mem.l1, 128));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L2_L",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm1, zmmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_S",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.l2, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_LS",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.l2, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmmword_ptr(c.mem.l2, 128));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L3_L",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm1, zmmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_S",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.l3, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_LS",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.l3, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmmword_ptr(c.mem.l3, 128));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_P",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmmword_ptr(c.mem.l1, 64));
+       c.cb.prefetcht2(ptr(c.mem.l3));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"RAM_L",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.cb.vfmadd231pd(c.ram, zmm1, zmmword_ptr(c.mem.ram, 64));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_S",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.ram, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmm2);
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_LS",
+     [](AVX512Context &c) {
+       c.cb.vmovapd(zmmword_ptr(c.mem.ram, 64), Zmm(c.add.current()));
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0,
+                        zmmword_ptr(c.mem.ram, 128));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_P",
+     [](AVX512Context &c) {
+       c.cb.vfmadd231pd(Zmm(c.add.current()), zmm0, zmmword_ptr(c.mem.l1, 64));
+       c.cb.prefetcht2(ptr(c.mem.ram));
+       c.mem.ramIncrement(c.cb);
+     }}};
+} // namespace
+
 int AVX512Payload::compilePayload(
     std::vector<std::pair<std::string, unsigned>> const &proportion,
     unsigned instructionCacheSize,
@@ -196,126 +321,28 @@ int AVX512Payload::compilePayload(
   auto Loop = cb.newLabel();
   cb.bind(Loop);
 
-  auto shift_pos = 0;
-  bool left = false;
-  auto add_dest = add_start + 1;
-  auto mov_dst = trans_start;
-  auto mov_src = mov_dst + 1;
-  unsigned l1_offset = 0;
-
-#define L1_INCREMENT()                                                         \
-  l1_offset += 64;                                                             \
-  if (l1_offset < l1_size * 0.5) {                                             \
-    cb.add(l1_addr, offset_reg);                                               \
-  } else {                                                                     \
-    l1_offset = 0;                                                             \
-    cb.mov(l1_addr, pointer_reg);                                              \
-  }
+  std::vector<InstructionGroups<AVX512Context>::Emitter> emitters;
+  std::string unknown;
 
-#define L2_INCREMENT() cb.add(l2_addr, offset_reg)
-
-#define L3_INCREMENT() cb.add(l3_addr, offset_reg)
-
-#define RAM_INCREMENT() cb.add(ram_addr, offset_reg)
-
-  for (unsigned count = 0; count < repetitions; count++) {
-    for (const auto &item : sequence) {
-      if (item == "REG") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        cb.vfmadd231pd(Zmm(mov_dst), zmm2, zmm1);
-        cb.xor_(shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs],
-                temp_reg);
-        mov_dst++;
-      } else if (item == "L1_L") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        cb.vfmadd231pd(Zmm(add_dest), zmm1, zmmword_ptr(l1_addr, 64));
-        L1_INCREMENT();
-      } else if (item == "L1_BROADCAST") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        cb.vbroadcastsd(Zmm(add_dest), ptr_64(l1_addr, 64));
-        L1_INCREMENT();
-      } else if (item == "L1_S") {
-        cb.vmovapd(zmmword_ptr(l1_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        L1_INCREMENT();
-      } else if (item == "L1_LS") {
-        cb.vmovapd(zmmword_ptr(l1_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmmword_ptr(l1_addr, 128));
-        L1_INCREMENT();
-      } else if (item == "L2_L") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        cb.vfmadd231pd(Zmm(add_dest), zmm1, zmmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_S") {
-        cb.vmovapd(zmmword_ptr(l2_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        L2_INCREMENT();
-      } else if (item == "L2_LS") {
-        cb.vmovapd(zmmword_ptr(l2_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmmword_ptr(l2_addr, 128));
-        L2_INCREMENT();
-      } else if (item == "L3_L") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        cb.vfmadd231pd(Zmm(add_dest), zmm1, zmmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_S") {
-        cb.vmovapd(zmmword_ptr(l3_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        L3_INCREMENT();
-      } else if (item == "L3_LS") {
-        cb.vmovapd(zmmword_ptr(l3_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmmword_ptr(l3_addr, 128));
-        L3_INCREMENT();
-      } else if (item == "L3_P") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmmword_ptr(l1_addr, 64));
-        cb.prefetcht2(ptr(l3_addr));
-        L3_INCREMENT();
-      } else if (item == "RAM_L") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        cb.vfmadd231pd(ram_reg, zmm1, zmmword_ptr(ram_addr, 64));
-        RAM_INCREMENT();
-      } else if (item == "RAM_S") {
-        cb.vmovapd(zmmword_ptr(ram_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmm2);
-        RAM_INCREMENT();
-      } else if (item == "RAM_LS") {
-        cb.vmovapd(zmmword_ptr(ram_addr, 64), Zmm(add_dest));
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmmword_ptr(ram_addr, 128));
-        RAM_INCREMENT();
-      } else if (item == "RAM_P") {
-        cb.vfmadd231pd(Zmm(add_dest), zmm0, zmmword_ptr(l1_addr, 64));
-        cb.prefetcht2(ptr(ram_addr));
-        RAM_INCREMENT();
-      } else {
-        workerLog::error() << "Instruction group " << item << " not found in "
-                           << this->name() << ".";
-        return EXIT_FAILURE;
-      }
-
-      if (left) {
-        cb.shr(shift_reg32[shift_pos], Imm(1));
-      } else {
-        cb.shl(shift_reg32[shift_pos], Imm(1));
-      }
-      add_dest++;
-      if (add_dest > add_end) {
-        add_dest = add_start;
-      }
-      if (mov_dst > trans_end) {
-        mov_dst = trans_start;
-      }
-      mov_src++;
-      if (mov_src > trans_end) {
-        mov_src = trans_start;
-      }
-      shift_pos++;
-      if (shift_pos == nr_shift_regs) {
-        shift_pos = 0;
-        left = !left;
-      }
-    }
+  if (!groups.resolve(sequence, emitters, unknown)) {
+    workerLog::error() << "Instruction group " << unknown << " not found in "
+                       << this->name() << ".";
+    return EXIT_FAILURE;
   }
 
+  AVX512Context context{
+      cb,
+      {pointer_reg, offset_reg, l1_addr, l2_addr, l3_addr, ram_addr, l1_size},
+      temp_reg,
+      shift_reg,
+      shift_reg32,
+      ram_reg,
+      RegisterRing(add_start, add_end, add_start + 1, add_start),
+      RegisterRing(trans_start, trans_end),
+      ShiftRotation(nr_shift_regs)};
+
+  InstructionGroups<AVX512Context>::emit(emitters, repetitions, context);
+
   cb.movq(temp_reg, iter_reg); // restore iteration counter
   if (this->getRAMSequenceCount(sequence) > 0) {
     // reset RAM counter
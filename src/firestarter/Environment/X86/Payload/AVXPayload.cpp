@@ -20,6 +20,7 @@
  *****************************************************************************/
 
 #include <firestarter/Environment/X86/Payload/AVXPayload.hpp>
+#include <firestarter/Environment/X86/Payload/InstructionGroups.hpp>
 #include <firestarter/Logging/Log.hpp>
 
 #include <iterator>
@@ -29,6 +30,151 @@ using namespace firestarter::environment::x86::payload;
 using namespace asmjit;
 using namespace asmjit::x86;
 
+namespace {
+struct AVXContext {
+  Builder &cb;
+  AddressStreams mem;
+  unsigned &instructions;
+  RegisterRing add;
+  RegisterRing trans;
+  RegisterRing transSrc;
+  unsigned shiftStart;
+  ShiftRotation shift;
+
+  void next() {
+    if (shift.count() > 1) {
+      instructions++;
+      if (shift.left()) {
+        cb.psrlw(Mm(shiftStart + shift.neighbour(3)),
+                 Mm(shiftStart + shift.current()));
+      } else {
+        cb.psllw(Mm(shiftStart + shift.neighbour(3)),
+                 Mm(shiftStart + shift.current()));
+      }
+    }
+
+    add.next();
+    trans.next();
+    transSrc.next();
+    if (shift.count() > 1) {
+      shift.next();
+    }
+  }
+};
+
+const InstructionGroups<AVXContext> groups = {
+    {"REG",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   Ymm(c.add.neighbour(1)));
+       c.cb.vmovdqa(Ymm(c.trans.current()), Ymm(c.transSrc.current()));
+     }},
+    {"L1_L",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l1, 32));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_S",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   Ymm(c.add.neighbour(-1)));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 32), Xmm(c.add.current()));
+       c.mem.l1Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L1_LS",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l1, 32));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 64), Xmm(c.add.current()));
+       c.mem.l1Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L2_L",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_S",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   Ymm(c.add.neighbour(-1)));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l2, 64), Xmm(c.add.current()));
+       c.mem.l2Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L2_LS",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l2, 64));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l2, 96), Xmm(c.add.current()));
+       c.mem.l2Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L3_L",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_S",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   Ymm(c.add.neighbour(-1)));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.mem.l3Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L3_LS",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l3, 64));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.mem.l3Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L3_P",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht0(ptr(c.mem.l3));
+       c.mem.l3Increment(c.cb);
+       c.instructions++;
+     }},
+    {"RAM_L",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.ram, 64));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_S",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   Ymm(c.add.neighbour(-1)));
+       c.cb.vmovapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.mem.ramIncrement(c.cb);
+       c.instructions++;
+     }},
+    {"RAM_LS",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l3, 64));
+       c.cb.vmovapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.mem.ramIncrement(c.cb);
+       c.instructions++;
+     }},
+    {"RAM_P",
+     [](AVXContext &c) {
+       c.cb.vaddpd(Ymm(c.add.current()), Ymm(c.add.current()),
+                   ymmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht2(ptr(c.mem.ram));
+       c.mem.ramIncrement(c.cb);
+       c.instructions++;
+     }}};
+} // namespace
+
 int AVXPayload::compilePayload(
     std::vector<std::pair<std::string, unsigned>> const &proportion,
     unsigned instructionCacheSize,
@@ -222,146 +368,29 @@ int AVXPayload::compilePayload(
   auto Loop = cb.newLabel();
   cb.bind(Loop);
 
-  auto left = false;
-  auto shift_dst = shift_start;
-  auto add_dest = add_start + 1;
-  auto mov_dst = trans_start;
-  auto mov_src = mov_dst + 1;
-  unsigned l1_offset = 0;
-
-#define L1_INCREMENT()                                                         \
-  l1_offset += 64;                                                             \
-  if (l1_offset < l1_size * 0.5) {                                             \
-    cb.add(l1_addr, offset_reg);                                               \
-  } else {                                                                     \
-    l1_offset = 0;                                                             \
-    cb.mov(l1_addr, pointer_reg);                                              \
-  }
-
-#define L2_INCREMENT() cb.add(l2_addr, offset_reg);
-
-#define L3_INCREMENT() cb.add(l3_addr, offset_reg)
-
-#define RAM_INCREMENT() cb.add(ram_addr, offset_reg)
-
-  for (unsigned count = 0; count < repetitions; count++) {
-    for (const auto &item : sequence) {
-      if (item == "REG") {
-        cb.vaddpd(
-            Ymm(add_dest), Ymm(add_dest),
-            Ymm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.vmovdqa(Ymm(mov_dst), Ymm(mov_src));
-      } else if (item == "L1_L") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l1_addr, 32));
-        L1_INCREMENT();
-      } else if (item == "L1_S") {
-        cb.vaddpd(
-            Ymm(add_dest), Ymm(add_dest),
-            Ymm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.vmovapd(xmmword_ptr(l1_addr, 32), Xmm(add_dest));
-        L1_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L1_LS") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l1_addr, 32));
-        cb.vmovapd(xmmword_ptr(l1_addr, 64), Xmm(add_dest));
-        L1_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L2_L") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_S") {
-        cb.vaddpd(
-            Ymm(add_dest), Ymm(add_dest),
-            Ymm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.vmovapd(xmmword_ptr(l2_addr, 64), Xmm(add_dest));
-        L2_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L2_LS") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l2_addr, 64));
-        cb.vmovapd(xmmword_ptr(l2_addr, 96), Xmm(add_dest));
-        L2_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L3_L") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_S") {
-        cb.vaddpd(
-            Ymm(add_dest), Ymm(add_dest),
-            Ymm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.vmovapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        L3_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L3_LS") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l3_addr, 64));
-        cb.vmovapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        L3_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L3_P") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l1_addr, 32));
-        cb.prefetcht0(ptr(l3_addr));
-        L3_INCREMENT();
-        this->_instructions++;
-      } else if (item == "RAM_L") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(ram_addr, 64));
-        RAM_INCREMENT();
-      } else if (item == "RAM_S") {
-        cb.vaddpd(
-            Ymm(add_dest), Ymm(add_dest),
-            Ymm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.vmovapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        RAM_INCREMENT();
-        this->_instructions++;
-      } else if (item == "RAM_LS") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l3_addr, 64));
-        cb.vmovapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        RAM_INCREMENT();
-        this->_instructions++;
-      } else if (item == "RAM_P") {
-        cb.vaddpd(Ymm(add_dest), Ymm(add_dest), ymmword_ptr(l1_addr, 32));
-        cb.prefetcht2(ptr(ram_addr));
-        RAM_INCREMENT();
-        this->_instructions++;
-      } else {
-        workerLog::error() << "Instruction group " << item << " not found in "
-                           << this->name() << ".";
-        return EXIT_FAILURE;
-      }
-
-      if (shift_regs > 1) {
-        this->_instructions++;
-        if (left) {
-          cb.psrlw(Mm(shift_start + (shift_dst - shift_start + 3) % shift_regs),
-                   Mm(shift_dst));
-        } else {
-          cb.psllw(Mm(shift_start + (shift_dst - shift_start + 3) % shift_regs),
-                   Mm(shift_dst));
-        }
-      }
+  std::vector<InstructionGroups<AVXContext>::Emitter> emitters;
+  std::string unknown;
 
-      add_dest++;
-      if (add_dest > add_end) {
-        // DO NOT REMOVE the + 1. It serves for the good of ymm0. If it was to
-        // be overriden, the values in the other registers would rise up to inf.
-        add_dest = add_start + 1;
-      }
-      mov_dst++;
-      if (mov_dst > trans_end) {
-        mov_dst = trans_start;
-      }
-      mov_src++;
-      if (mov_src > trans_end) {
-        mov_src = trans_start;
-      }
-      if (shift_regs > 1) {
-        shift_dst++;
-        if (shift_dst > shift_end) {
-          shift_dst = shift_start;
-          left = !left;
-        }
-      }
-    }
+  if (!groups.resolve(sequence, emitters, unknown)) {
+    workerLog::error() << "Instruction group " << unknown << " not found in "
+                       << this->name() << ".";
+    return EXIT_FAILURE;
   }
 
+  AVXContext context{
+      cb,
+      {pointer_reg, offset_reg, l1_addr, l2_addr, l3_addr, ram_addr, l1_size},
+      this->_instructions,
+      // DO NOT REMOVE the + 1. It serves for the good of ymm0. If it was to be
+      // overriden, the values in the other registers would rise up to inf.
+      RegisterRing(add_start, add_end, add_start + 1, add_start + 1),
+      RegisterRing(trans_start, trans_end),
+      RegisterRing(trans_start, trans_end, trans_start + 1, trans_start),
+      static_cast<unsigned>(shift_start),
+      ShiftRotation(shift_regs)};
+
+  InstructionGroups<AVXContext>::emit(emitters, repetitions, context);
+
   if (this->getRAMSequenceCount(sequence) > 0) {
     // reset RAM counter
     auto NoRamReset = cb.newLabel();
@@ -20,6 +20,7 @@
  *****************************************************************************/
 
 #include <firestarter/Environment/X86/Payload/FMA4Payload.hpp>
+#include <firestarter/Environment/X86/Payload/InstructionGroups.hpp>
 #include <firestarter/Logging/Log.hpp>
 
 #include <iterator>
@@ -29,6 +30,142 @@ using namespace firestarter::environment::x86::payload;
 using namespace asmjit;
 using namespace asmjit::x86;
 
+namespace {
+struct FMA4Context {
+  Builder &cb;
+  AddressStreams mem;
+  Gp temp;
+  std::vector<Gp> const &shiftRegs;
+  std::vector<Gp> const &shiftRegs32;
+  Xmm ram;
+  RegisterRing add;
+  RegisterRing trans;
+  ShiftRotation shift;
+
+  void next() {
+    if (shift.left()) {
+      cb.shr(shiftRegs32[shift.current()], Imm(1));
+    } else {
+      cb.shl(shiftRegs32[shift.current()], Imm(1));
+    }
+    add.next();
+    shift.next();
+  }
+};
+
+const InstructionGroups<FMA4Context> groups = {
+    {"REG",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.cb.vfmaddpd(Xmm(c.trans.current()), Xmm(c.trans.current()), xmm1,
+                     Xmm(c.add.neighbour(2)));
+       c.cb.xor_(c.shiftRegs[c.shift.neighbour(-1)], c.temp);
+       c.trans.next();
+     }},
+    {"L1_L",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.cb.vfmaddpd(Ymm(c.add.current()), Ymm(c.add.current()), ymm1,
+                     ymmword_ptr(c.mem.l1, 32));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_S",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 32), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Ymm(c.add.current()), Ymm(c.add.current()), ymm0,
+                     Ymm(c.add.neighbour(1)));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_LS",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 64), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Ymm(c.add.current()), Ymm(c.add.current()), ymm0,
+                     ymmword_ptr(c.mem.l1, 32));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L2_L",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm1,
+                     xmmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_S",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l2, 64), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_LS",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l2, 96), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     xmmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L3_L",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm1,
+                     xmmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_S",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_LS",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     xmmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_P",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     xmmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht2(ptr(c.mem.l3));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"RAM_L",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.cb.vfmaddpd(c.ram, c.ram, xmm1, xmmword_ptr(c.mem.ram, 64));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_S",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     Xmm(c.add.neighbour(1)));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_LS",
+     [](FMA4Context &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     xmmword_ptr(c.mem.ram, 32));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_P",
+     [](FMA4Context &c) {
+       c.cb.vfmaddpd(Xmm(c.add.current()), Xmm(c.add.current()), xmm0,
+                     xmmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht2(ptr(c.mem.ram));
+       c.mem.ramIncrement(c.cb);
+     }}};
+} // namespace
+
 int FMA4Payload::compilePayload(
     std::vector<std::pair<std::string, unsigned>> const &proportion,
     unsigned instructionCacheSize,
@@ -198,151 +335,28 @@ int FMA4Payload::compilePayload(
   auto Loop = cb.newLabel();
   cb.bind(Loop);
 
-  auto shift_pos = 0;
-  bool left = false;
-  auto add_dest = add_start + 1;
-  auto mov_dst = trans_start;
-  auto mov_src = mov_dst + 1;
-  unsigned l1_offset = 0;
-
-#define L1_INCREMENT()                                                         \
-  l1_offset += 64;                                                             \
-  if (l1_offset < l1_size * 0.5) {                                             \
-    cb.add(l1_addr, offset_reg);                                               \
-  } else {                                                                     \
-    l1_offset = 0;                                                             \
-    cb.mov(l1_addr, pointer_reg);                                              \
-  }
+  std::vector<InstructionGroups<FMA4Context>::Emitter> emitters;
+  std::string unknown;
 
-#define L2_INCREMENT() cb.add(l2_addr, offset_reg);
-
-#define L3_INCREMENT() cb.add(l3_addr, offset_reg)
-
-#define RAM_INCREMENT() cb.add(ram_addr, offset_reg)
-
-  for (unsigned count = 0; count < repetitions; count++) {
-    for (const auto &item : sequence) {
-      if (item == "REG") {
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.vfmaddpd(
-            Xmm(mov_dst), Xmm(mov_dst), xmm1,
-            Xmm(add_start + (add_dest - add_start + add_regs + 2) % add_regs));
-        cb.xor_(shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs],
-                temp_reg);
-        mov_dst++;
-      } else if (item == "L1_L") {
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.vfmaddpd(Ymm(add_dest), Ymm(add_dest), ymm1,
-                    ymmword_ptr(l1_addr, 32));
-        L1_INCREMENT();
-      } else if (item == "L1_S") {
-        cb.vmovapd(xmmword_ptr(l1_addr, 32), Xmm(add_dest));
-        cb.vfmaddpd(
-            Ymm(add_dest), Ymm(add_dest), ymm0,
-            Ymm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        L1_INCREMENT();
-      } else if (item == "L1_LS") {
-        cb.vmovapd(xmmword_ptr(l1_addr, 64), Xmm(add_dest));
-        cb.vfmaddpd(Ymm(add_dest), Ymm(add_dest), ymm0,
-                    ymmword_ptr(l1_addr, 32));
-        L1_INCREMENT();
-      } else if (item == "L2_L") {
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm1,
-                    xmmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_S") {
-        cb.vmovapd(xmmword_ptr(l2_addr, 64), Xmm(add_dest));
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        L2_INCREMENT();
-      } else if (item == "L2_LS") {
-        cb.vmovapd(xmmword_ptr(l2_addr, 96), Xmm(add_dest));
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm0,
-                    xmmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L3_L") {
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm1,
-                    xmmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_S") {
-        cb.vmovapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        L3_INCREMENT();
-      } else if (item == "L3_LS") {
-        cb.vmovapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm0,
-                    xmmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_P") {
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm0,
-                    xmmword_ptr(l1_addr, 32));
-        cb.prefetcht2(ptr(l3_addr));
-        L3_INCREMENT();
-      } else if (item == "RAM_L") {
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.vfmaddpd(ram_reg, ram_reg, xmm1, xmmword_ptr(ram_addr, 64));
-        RAM_INCREMENT();
-      } else if (item == "RAM_S") {
-        cb.vmovapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        cb.vfmaddpd(
-            Xmm(add_dest), Xmm(add_dest), xmm0,
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        RAM_INCREMENT();
-      } else if (item == "RAM_LS") {
-        cb.vmovapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm0,
-                    xmmword_ptr(ram_addr, 32));
-        RAM_INCREMENT();
-      } else if (item == "RAM_P") {
-        cb.vfmaddpd(Xmm(add_dest), Xmm(add_dest), xmm0,
-                    xmmword_ptr(l1_addr, 32));
-        cb.prefetcht2(ptr(ram_addr));
-        RAM_INCREMENT();
-      } else {
-        workerLog::error() << "Instruction group " << item << " not found in "
-                           << this->name() << ".";
-        return EXIT_FAILURE;
-      }
-
-      if (left) {
-        cb.shr(shift_reg32[shift_pos], Imm(1));
-      } else {
-        cb.shl(shift_reg32[shift_pos], Imm(1));
-      }
-      add_dest++;
-      if (add_dest > add_end) {
-        add_dest = add_start;
-      }
-      if (mov_dst > trans_end) {
-        mov_dst = trans_start;
-      }
-      mov_src++;
-      if (mov_src > trans_end) {
-        mov_src = trans_start;
-      }
-      shift_pos++;
-      if (shift_pos == nr_shift_regs) {
-        shift_pos = 0;
-        left = !left;
-      }
-    }
+  if (!groups.resolve(sequence, emitters, unknown)) {
+    workerLog::error() << "Instruction group " << unknown << " not found in "
+                       << this->name() << ".";
+    return EXIT_FAILURE;
   }
 
+  FMA4Context context{
+      cb,
+      {pointer_reg, offset_reg, l1_addr, l2_addr, l3_addr, ram_addr, l1_size},
+      temp_reg,
+      shift_reg,
+      shift_reg32,
+      ram_reg,
+      RegisterRing(add_start, add_end, add_start + 1, add_start),
+      RegisterRing(trans_start, trans_end),
+      ShiftRotation(nr_shift_regs)};
+
+  InstructionGroups<FMA4Context>::emit(emitters, repetitions, context);
+
   cb.movq(temp_reg, iter_reg); // restore iteration counter
   if (this->getRAMSequenceCount(sequence) > 0) {
     // reset RAM counter
@@ -20,6 +20,7 @@
  *****************************************************************************/
 
 #include <firestarter/Environment/X86/Payload/FMAPayload.hpp>
+#include <firestarter/Environment/X86/Payload/InstructionGroups.hpp>
 #include <firestarter/Logging/Log.hpp>
 
 #include <iterator>
@@ -29,6 +30,182 @@ using namespace firestarter::environment::x86::payload;
 using namespace asmjit;
 using namespace asmjit::x86;
 
+namespace {
+struct FMAContext {
+  Builder &cb;
+  AddressStreams mem;
+  Gp temp;
+  std::vector<Gp> const &shiftRegs;
+  std::vector<Gp> const &shiftRegs32;
+  Ymm ram;
+  RegisterRing add;
+  RegisterRing trans;
+  ShiftRotation shift;
+  bool skipShift = false;
+
+  void next() {
+    if (!skipShift) {
+      if (shift.left()) {
+        cb.shr(shiftRegs32[shift.current()], Imm(1));
+      } else {
+        cb.shl(shiftRegs32[shift.current()], Imm(1));
+      }
+    }
+    skipShift = false;
+    add.next();
+    shift.next();
+  }
+};
+
+const InstructionGroups<FMAContext> groups = {
+    {"REG",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.cb.vfmadd231pd(Ymm(c.trans.current()), ymm2, ymm1);
+       c.cb.xor_(c.shiftRegs[c.shift.neighbour(-1)], c.temp);
+       c.trans.next();
+     }},
+    {"L1_L",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm1,
+                        ymmword_ptr(c.mem.l1, 32));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_2L",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l1, 32));
+       c.cb.vfmadd231pd(Ymm(c.trans.current()), ymm1,
+                        ymmword_ptr(c.mem.l1, 64));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_S",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 32), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_LS",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 64), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l1, 32));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_LS_256",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l1, 64));
+       c.cb.vmovapd(ymmword_ptr(c.mem.l1, 32), Ymm(c.add.current()));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_2LS_256",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l1, 64));
+       c.cb.vfmadd231pd(Ymm(c.trans.current()), ymm1,
+                        ymmword_ptr(c.mem.l1, 96));
+       c.cb.vmovapd(ymmword_ptr(c.mem.l1, 32), Ymm(c.add.current()));
+       c.mem.l1Increment(c.cb, 2);
+       c.skipShift = true;
+     }},
+    {"L2_L",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm1,
+                        ymmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_S",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l2, 64), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_LS",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l2, 96), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_LS_256",
+     [](FMAContext &c) {
+       c.cb.vmovapd(ymmword_ptr(c.mem.l2, 96), Ymm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_2LS_256",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ptr(c.mem.l2, 64));
+       c.cb.vfmadd231pd(Ymm(c.trans.current()), ymm1, ptr(c.mem.l2, 96));
+       c.cb.vmovapd(ymmword_ptr(c.mem.l2, 32), Ymm(c.add.current()));
+       c.mem.l2Increment(c.cb, 2);
+       c.skipShift = true;
+     }},
+    {"L3_L",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm1,
+                        ymmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_S",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_LS",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_LS_256",
+     [](FMAContext &c) {
+       c.cb.vmovapd(ymmword_ptr(c.mem.l3, 96), Ymm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_P",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht2(ptr(c.mem.l3));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"RAM_L",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.cb.vfmadd231pd(c.ram, ymm1, ymmword_ptr(c.mem.ram, 64));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_S",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0, ymm2);
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_LS",
+     [](FMAContext &c) {
+       c.cb.vmovapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.ram, 32));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_P",
+     [](FMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), ymm0,
+                        ymmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht2(ptr(c.mem.ram));
+       c.mem.ramIncrement(c.cb);
+     }}};
+} // namespace
+
 int FMAPayload::compilePayload(
     std::vector<std::pair<std::string, unsigned>> const &proportion,
     unsigned instructionCacheSize,
@@ -199,158 +376,27 @@ int FMAPayload::compilePayload(
   auto Loop = cb.newLabel();
   cb.bind(Loop);
 
-  auto shift_pos = 0;
-  bool left = false;
-  auto add_dest = add_start + 1;
-  auto mov_dst = trans_start;
-  auto mov_src = mov_dst + 1;
-  unsigned l1_offset = 0;
-
-#define L1_INCREMENT_TIMES(n)                                                  \
-  l1_offset += n * 64;                                                         \
-  if (l1_offset < l1_size * 0.5) {                                             \
-    cb.add(l1_addr, offset_reg);                                               \
-  } else {                                                                     \
-    l1_offset = 0;                                                             \
-    cb.mov(l1_addr, pointer_reg);                                              \
-  }
-
-#define L1_INCREMENT() L1_INCREMENT_TIMES(1)
+  std::vector<InstructionGroups<FMAContext>::Emitter> emitters;
+  std::string unknown;
 
-#define L2_INCREMENT_TIMES(n)                                                  \
-  if (n == 1) {                                                                \
-    cb.add(l2_addr, offset_reg);                                               \
-  } else {                                                                     \
-    cb.add(l2_addr, n * 64);                                                   \
+  if (!groups.resolve(sequence, emitters, unknown)) {
+    workerLog::error() << "Instruction group " << unknown << " not found in "
+                       << this->name() << ".";
+    return EXIT_FAILURE;
   }
 
-#define L2_INCREMENT() L2_INCREMENT_TIMES(1)
-
-#define L3_INCREMENT() cb.add(l3_addr, offset_reg)
-
-#define RAM_INCREMENT() cb.add(ram_addr, offset_reg)
-
-  for (unsigned count = 0; count < repetitions; count++) {
-    for (const auto &item : sequence) {
-      if (item == "REG") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        cb.vfmadd231pd(Ymm(mov_dst), ymm2, ymm1);
-        cb.xor_(shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs],
-                temp_reg);
-        mov_dst++;
-      } else if (item == "L1_L") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        cb.vfmadd231pd(Ymm(add_dest), ymm1, ymmword_ptr(l1_addr, 32));
-        L1_INCREMENT();
-      } else if (item == "L1_2L") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l1_addr, 32));
-        cb.vfmadd231pd(Ymm(mov_dst), ymm1, ymmword_ptr(l1_addr, 64));
-        L1_INCREMENT();
-      } else if (item == "L1_S") {
-        cb.vmovapd(xmmword_ptr(l1_addr, 32), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        L1_INCREMENT();
-      } else if (item == "L1_LS") {
-        cb.vmovapd(xmmword_ptr(l1_addr, 64), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l1_addr, 32));
-        L1_INCREMENT();
-      } else if (item == "L1_LS_256") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l1_addr, 64));
-        cb.vmovapd(ymmword_ptr(l1_addr, 32), Ymm(add_dest));
-        L1_INCREMENT();
-      } else if (item == "L1_2LS_256") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l1_addr, 64));
-        cb.vfmadd231pd(Ymm(mov_dst), ymm1, ymmword_ptr(l1_addr, 96));
-        cb.vmovapd(ymmword_ptr(l1_addr, 32), Ymm(add_dest));
-        L1_INCREMENT_TIMES(2);
-      } else if (item == "L2_L") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        cb.vfmadd231pd(Ymm(add_dest), ymm1, ymmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_S") {
-        cb.vmovapd(xmmword_ptr(l2_addr, 64), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        L2_INCREMENT();
-      } else if (item == "L2_LS") {
-        cb.vmovapd(xmmword_ptr(l2_addr, 96), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_LS_256") {
-        cb.vmovapd(ymmword_ptr(l2_addr, 96), Ymm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_2LS_256") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ptr(l2_addr, 64));
-        cb.vfmadd231pd(Ymm(mov_dst), ymm1, ptr(l2_addr, 96));
-        cb.vmovapd(ymmword_ptr(l2_addr, 32), Ymm(add_dest));
-        L2_INCREMENT_TIMES(2);
-      } else if (item == "L3_L") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        cb.vfmadd231pd(Ymm(add_dest), ymm1, ymmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_S") {
-        cb.vmovapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        L3_INCREMENT();
-      } else if (item == "L3_LS") {
-        cb.vmovapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_LS_256") {
-        cb.vmovapd(ymmword_ptr(l3_addr, 96), Ymm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_P") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l1_addr, 32));
-        cb.prefetcht2(ptr(l3_addr));
-        L3_INCREMENT();
-      } else if (item == "RAM_L") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        cb.vfmadd231pd(ram_reg, ymm1, ymmword_ptr(ram_addr, 64));
-        RAM_INCREMENT();
-      } else if (item == "RAM_S") {
-        cb.vmovapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymm2);
-        RAM_INCREMENT();
-      } else if (item == "RAM_LS") {
-        cb.vmovapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(ram_addr, 32));
-        RAM_INCREMENT();
-      } else if (item == "RAM_P") {
-        cb.vfmadd231pd(Ymm(add_dest), ymm0, ymmword_ptr(l1_addr, 32));
-        cb.prefetcht2(ptr(ram_addr));
-        RAM_INCREMENT();
-      } else {
-        workerLog::error() << "Instruction group " << item << " not found in "
-                           << this->name() << ".";
-        return EXIT_FAILURE;
-      }
-
-      if (item != "L1_2LS_256" && item != "L2_2LS_256") {
-        if (left) {
-          cb.shr(shift_reg32[shift_pos], Imm(1));
-        } else {
-          cb.shl(shift_reg32[shift_pos], Imm(1));
-        }
-      }
-      add_dest++;
-      if (add_dest > add_end) {
-        add_dest = add_start;
-      }
-      if (mov_dst > trans_end) {
-        mov_dst = trans_start;
-      }
-      mov_src++;
-      if (mov_src > trans_end) {
-        mov_src = trans_start;
-      }
-      shift_pos++;
-      if (shift_pos == nr_shift_regs) {
-        shift_pos = 0;
-        left = !left;
-      }
-    }
-  }
+  FMAContext context{cb,
+                     {pointer_reg, offset_reg, l1_addr, l2_addr, l3_addr,
+                      ram_addr, l1_size},
+                     temp_reg,
+                     shift_reg,
+                     shift_reg32,
+                     ram_reg,
+                     RegisterRing(add_start, add_end, add_start + 1, add_start),
+                     RegisterRing(trans_start, trans_end),
+                     ShiftRotation(nr_shift_regs)};
+
+  InstructionGroups<FMAContext>::emit(emitters, repetitions, context);
 
   cb.movq(temp_reg, iter_reg); // restore iteration counter
   if (this->getRAMSequenceCount(sequence) > 0) {
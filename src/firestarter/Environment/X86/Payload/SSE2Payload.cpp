@@ -19,6 +19,7 @@
  * Contact: daniel.hackenberg@tu-dresden.de
  *****************************************************************************/
 
+#include <firestarter/Environment/X86/Payload/InstructionGroups.hpp>
 #include <firestarter/Environment/X86/Payload/SSE2Payload.hpp>
 #include <firestarter/Logging/Log.hpp>
 
@@ -29,6 +30,130 @@ using namespace firestarter::environment::x86::payload;
 using namespace asmjit;
 using namespace asmjit::x86;
 
+namespace {
+struct SSE2Context {
+  Builder &cb;
+  AddressStreams mem;
+  unsigned &instructions;
+  RegisterRing add;
+  RegisterRing trans;
+  RegisterRing transSrc;
+  unsigned movRegs;
+  RegisterRing movq;
+
+  void next() {
+    if (movRegs > 0) {
+      instructions++;
+      cb.movq(Mm(movq.neighbour(-1)), Mm(movq.current()));
+    }
+
+    add.next();
+    trans.next();
+    transSrc.next();
+    if (movRegs > 0) {
+      movq.next();
+    }
+  }
+};
+
+const InstructionGroups<SSE2Context> groups = {
+    {"REG",
+     [](SSE2Context &c) {
+       c.cb.addpd( Xmm(c.add.current()), Xmm(c.add.neighbour(1)));
+       c.cb.movdqa(Xmm(c.trans.current()), Xmm(c.transSrc.current()));
+     }},
+    {"L1_L",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l1, 32));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L1_S",
+     [](SSE2Context &c) {
+       c.cb.addpd( Xmm(c.add.current()), Xmm(c.add.neighbour(-1)));
+       c.cb.movapd(xmmword_ptr(c.mem.l1, 32), Xmm(c.add.current()));
+       c.mem.l1Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L1_LS",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l1, 32));
+       c.cb.movapd(xmmword_ptr(c.mem.l1, 64), Xmm(c.add.current()));
+       c.mem.l1Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L2_L",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l2, 64));
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L2_S",
+     [](SSE2Context &c) {
+       c.cb.addpd( Xmm(c.add.current()), Xmm(c.add.neighbour(-1)));
+       c.cb.movapd(xmmword_ptr(c.mem.l2, 64), Xmm(c.add.current()));
+       c.mem.l2Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L2_LS",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l2, 64));
+       c.cb.movapd(xmmword_ptr(c.mem.l2, 96), Xmm(c.add.current()));
+       c.mem.l2Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L3_L",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l3, 64));
+       c.mem.l3Increment(c.cb);
+     }},
+    {"L3_S",
+     [](SSE2Context &c) {
+       c.cb.addpd( Xmm(c.add.current()), Xmm(c.add.neighbour(-1)));
+       c.cb.movapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.mem.l3Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L3_LS",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l3, 64));
+       c.cb.movapd(xmmword_ptr(c.mem.l3, 96), Xmm(c.add.current()));
+       c.mem.l3Increment(c.cb);
+       c.instructions++;
+     }},
+    {"L3_P",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht0(ptr(c.mem.l3));
+       c.mem.l3Increment(c.cb);
+       c.instructions++;
+     }},
+    {"RAM_L",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.ram, 64));
+       c.mem.ramIncrement(c.cb);
+     }},
+    {"RAM_S",
+     [](SSE2Context &c) {
+       c.cb.addpd( Xmm(c.add.current()), Xmm(c.add.neighbour(-1)));
+       c.cb.movapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.mem.ramIncrement(c.cb);
+       c.instructions++;
+     }},
+    {"RAM_LS",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l3, 64));
+       c.cb.movapd(xmmword_ptr(c.mem.ram, 64), Xmm(c.add.current()));
+       c.mem.ramIncrement(c.cb);
+       c.instructions++;
+     }},
+    {"RAM_P",
+     [](SSE2Context &c) {
+       c.cb.addpd(Xmm(c.add.current()), xmmword_ptr(c.mem.l1, 32));
+       c.cb.prefetcht2(ptr(c.mem.ram));
+       c.mem.ramIncrement(c.cb);
+       c.instructions++;
+     }}};
+} // namespace
+
 int SSE2Payload::compilePayload(
     std::vector<std::pair<std::string, unsigned>> const &proportion,
     unsigned instructionCacheSize,
@@ -219,140 +344,29 @@ int SSE2Payload::compilePayload(
   auto Loop = cb.newLabel();
   cb.bind(Loop);
 
-  auto movq_dst = mov_start;
-  auto add_dest = add_start + 1;
-  auto mov_dst = trans_start;
-  auto mov_src = mov_dst + 1;
-  unsigned l1_offset = 0;
-
-#define L1_INCREMENT()                                                         \
-  l1_offset += 64;                                                             \
-  if (l1_offset < l1_size * 0.5) {                                             \
-    cb.add(l1_addr, offset_reg);                                               \
-  } else {                                                                     \
-    l1_offset = 0;                                                             \
-    cb.mov(l1_addr, pointer_reg);                                              \
-  }
-
-#define L2_INCREMENT() cb.add(l2_addr, offset_reg);
-
-#define L3_INCREMENT() cb.add(l3_addr, offset_reg)
-
-#define RAM_INCREMENT() cb.add(ram_addr, offset_reg)
-
-  for (unsigned count = 0; count < repetitions; count++) {
-    for (const auto &item : sequence) {
-      if (item == "REG") {
-        cb.addpd(
-            Xmm(add_dest),
-            Xmm(add_start + (add_dest - add_start + add_regs + 1) % add_regs));
-        cb.movdqa(Xmm(mov_dst), Xmm(mov_src));
-      } else if (item == "L1_L") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l1_addr, 32));
-        L1_INCREMENT();
-      } else if (item == "L1_S") {
-        cb.addpd(
-            Xmm(add_dest),
-            Xmm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.movapd(xmmword_ptr(l1_addr, 32), Xmm(add_dest));
-        L1_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L1_LS") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l1_addr, 32));
-        cb.movapd(xmmword_ptr(l1_addr, 64), Xmm(add_dest));
-        L1_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L2_L") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l2_addr, 64));
-        L2_INCREMENT();
-      } else if (item == "L2_S") {
-        cb.addpd(
-            Xmm(add_dest),
-            Xmm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.movapd(xmmword_ptr(l2_addr, 64), Xmm(add_dest));
-        L2_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L2_LS") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l2_addr, 64));
-        cb.movapd(xmmword_ptr(l2_addr, 96), Xmm(add_dest));
-        L2_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L3_L") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l3_addr, 64));
-        L3_INCREMENT();
-      } else if (item == "L3_S") {
-        cb.addpd(
-            Xmm(add_dest),
-            Xmm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.movapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        L3_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L3_LS") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l3_addr, 64));
-        cb.movapd(xmmword_ptr(l3_addr, 96), Xmm(add_dest));
-        L3_INCREMENT();
-        this->_instructions++;
-      } else if (item == "L3_P") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l1_addr, 32));
-        cb.prefetcht0(ptr(l3_addr));
-        L3_INCREMENT();
-        this->_instructions++;
-      } else if (item == "RAM_L") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(ram_addr, 64));
-        RAM_INCREMENT();
-      } else if (item == "RAM_S") {
-        cb.addpd(
-            Xmm(add_dest),
-            Xmm(add_start + (add_dest - add_start + add_regs - 1) % add_regs));
-        cb.movapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        RAM_INCREMENT();
-        this->_instructions++;
-      } else if (item == "RAM_LS") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l3_addr, 64));
-        cb.movapd(xmmword_ptr(ram_addr, 64), Xmm(add_dest));
-        RAM_INCREMENT();
-        this->_instructions++;
-      } else if (item == "RAM_P") {
-        cb.addpd(Xmm(add_dest), xmmword_ptr(l1_addr, 32));
-        cb.prefetcht2(ptr(ram_addr));
-        RAM_INCREMENT();
-        this->_instructions++;
-      } else {
-        workerLog::error() << "Instruction group " << item << " not found in "
-                           << this->name() << ".";
-        return EXIT_FAILURE;
-      }
-
-      if (mov_regs > 0) {
-        this->_instructions++;
-        cb.movq(
-            Mm(mov_start + (movq_dst - mov_start + mov_regs - 1) % mov_regs),
-            Mm(movq_dst));
-      }
+  std::vector<InstructionGroups<SSE2Context>::Emitter> emitters;
+  std::string unknown;
 
-      add_dest++;
-      if (add_dest > add_end) {
-        // DO NOT REMOVE the + 1. It serves for the good of ymm0. If it was to
-        // be overriden, the values in the other registers would rise up to inf.
-        add_dest = add_start + 1;
-      }
-      mov_dst++;
-      if (mov_dst > trans_end) {
-        mov_dst = trans_start;
-      }
-      mov_src++;
-      if (mov_src > trans_end) {
-        mov_src = trans_start;
-      }
-      if (mov_regs > 0) {
-        movq_dst++;
-        if (movq_dst > mov_end) {
-          movq_dst = mov_start;
-        }
-      }
-    }
+  if (!groups.resolve(sequence, emitters, unknown)) {
+    workerLog::error() << "Instruction group " << unknown << " not found in "
+                       << this->name() << ".";
+    return EXIT_FAILURE;
   }
 
+  SSE2Context context{
+      cb,
+      {pointer_reg, offset_reg, l1_addr, l2_addr, l3_addr, ram_addr, l1_size},
+      this->_instructions,
+      // DO NOT REMOVE the + 1. It serves for the good of ymm0. If it was to be
+      // overriden, the values in the other registers would rise up to inf.
+      RegisterRing(add_start, add_end, add_start + 1, add_start + 1),
+      RegisterRing(trans_start, trans_end),
+      RegisterRing(trans_start, trans_end, trans_start + 1, trans_start),
+      static_cast<unsigned>(mov_regs),
+      RegisterRing(mov_start, mov_end)};
+
+  InstructionGroups<SSE2Context>::emit(emitters, repetitions, context);
+
   if (this->getRAMSequenceCount(sequence) > 0) {
     // reset RAM counter
     auto NoRamReset = cb.newLabel();
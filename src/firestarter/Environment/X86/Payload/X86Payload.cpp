@@ -19,6 +19,7 @@
  * Contact: daniel.hackenberg@tu-dresden.de
  *****************************************************************************/
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -27,6 +28,8 @@
 #include <intrin.h>
 #endif
 
+#include <emmintrin.h>
+
 #include <firestarter/Environment/X86/Payload/X86Payload.hpp>
 
 using namespace firestarter::environment::x86::payload;
@@ -74,15 +77,34 @@ void X86Payload::init(unsigned long long *memoryAddr,
                       double lastValue) {
   unsigned long long i = 0;
 
-  for (; i < INIT_BLOCKSIZE; i++)
+  for (; i < INIT_BLOCKSIZE && i < bufferSize; i++)
     *((double *)(memoryAddr + i)) = 0.25 + (double)i * 8.0 * firstValue;
-  for (; i <= bufferSize - INIT_BLOCKSIZE; i += INIT_BLOCKSIZE)
-    std::memcpy(memoryAddr + i, memoryAddr + i - INIT_BLOCKSIZE,
-                sizeof(unsigned long long) * INIT_BLOCKSIZE);
+
+  // copy the first block over the buffer with non-temporal stores. the
+  // buffer is 16 byte aligned and the first block stays in the cache.
+  __m128i const *src = reinterpret_cast<__m128i const *>(memoryAddr);
+  for (; i + INIT_BLOCKSIZE <= bufferSize; i += INIT_BLOCKSIZE) {
+    __m128i *dst = reinterpret_cast<__m128i *>(memoryAddr + i);
+    for (unsigned j = 0; j < INIT_BLOCKSIZE * sizeof(unsigned long long) /
+                                 sizeof(__m128i);
+         j++) {
+      _mm_stream_si128(dst + j, _mm_load_si128(src + j));
+    }
+  }
+  _mm_sfence();
+
   for (; i < bufferSize; i++)
     *((double *)(memoryAddr + i)) = 0.25 + (double)i * 8.0 * lastValue;
 }
 
+void X86Payload::reinit(unsigned long long *memoryAddr,
+                        unsigned long long bufferSize) {
+  // init of the first block only writes the values used for seeding. the
+  // init of the specific payload is hidden by the generic one in this class.
+  static_cast<environment::payload::Payload *>(this)->init(
+      memoryAddr, std::min(bufferSize, (unsigned long long)INIT_BLOCKSIZE));
+}
+
 unsigned long long
 X86Payload::highLoadFunction(unsigned long long *addrMem,
                              volatile unsigned long long *addrHigh,
@@ -19,6 +19,7 @@
  * Contact: daniel.hackenberg@tu-dresden.de
  *****************************************************************************/
 
+#include <firestarter/Environment/X86/Payload/InstructionGroups.hpp>
 #include <firestarter/Environment/X86/Payload/ZENFMAPayload.hpp>
 #include <firestarter/Logging/Log.hpp>
 
@@ -29,6 +30,88 @@ using namespace firestarter::environment::x86::payload;
 using namespace asmjit;
 using namespace asmjit::x86;
 
+namespace {
+struct ZENFMAContext {
+  Builder &cb;
+  AddressStreams mem;
+  Gp temp;
+  std::vector<Gp> const &shiftRegs;
+  Ymm ram;
+  RegisterRing add;
+  ShiftRotation shift;
+  unsigned itemCount;
+  unsigned totalItems;
+
+  // swap second and third param of fma instruction to force bitchanges on
+  // the pipes to its execution units
+  Ymm secondParam() const { return 0 == itemCount % 2 ? ymm0 : ymm1; }
+  Ymm thirdParam() const { return 0 == itemCount % 2 ? ymm1 : ymm0; }
+
+  void next() {
+    // make sure the shifts do could end up shifting out the data one end.
+    if (itemCount < totalItems - totalItems % 4) {
+      switch (itemCount % 4) {
+      case 0:
+        cb.vpsrlq(Xmm(13), Xmm(13), Imm(1));
+        break;
+      case 1:
+        cb.vpsllq(Xmm(14), Xmm(14), Imm(1));
+        break;
+      case 2:
+        cb.vpsllq(Xmm(13), Xmm(13), Imm(1));
+        break;
+      case 3:
+        cb.vpsrlq(Xmm(14), Xmm(14), Imm(1));
+        break;
+      }
+    }
+
+    itemCount++;
+    add.next();
+    shift.next();
+  }
+};
+
+const InstructionGroups<ZENFMAContext> groups = {
+    {"REG",
+     [](ZENFMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), c.secondParam(), c.thirdParam());
+       c.cb.xor_(c.temp, c.shiftRegs[c.shift.neighbour(-1)]);
+       if (c.shift.left()) {
+         c.cb.shr(c.shiftRegs[c.shift.current()], Imm(1));
+       } else {
+         c.cb.shl(c.shiftRegs[c.shift.current()], Imm(1));
+       }
+     }},
+    {"L1_LS",
+     [](ZENFMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), c.secondParam(),
+                        ymmword_ptr(c.mem.l1, 32));
+       c.cb.vmovapd(xmmword_ptr(c.mem.l1, 64), Xmm(c.add.current()));
+       c.mem.l1Increment(c.cb);
+     }},
+    {"L2_L",
+     [](ZENFMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), c.secondParam(),
+                        ymmword_ptr(c.mem.l2, 64));
+       c.cb.xor_(c.temp, c.shiftRegs[c.shift.neighbour(-1)]);
+       c.mem.l2Increment(c.cb);
+     }},
+    {"L3_L",
+     [](ZENFMAContext &c) {
+       c.cb.vfmadd231pd(Ymm(c.add.current()), c.secondParam(),
+                        ymmword_ptr(c.mem.l3, 64));
+       c.cb.xor_(c.temp, c.shiftRegs[c.shift.neighbour(-1)]);
+       c.mem.l3Increment(c.cb);
+     }},
+    {"RAM_L",
+     [](ZENFMAContext &c) {
+       c.cb.vfmadd231pd(c.ram, c.secondParam(), ymmword_ptr(c.mem.ram, 32));
+       c.cb.xor_(c.temp, c.shiftRegs[c.shift.neighbour(-1)]);
+       c.mem.ramIncrement(c.cb);
+     }}};
+} // namespace
+
 int ZENFMAPayload::compilePayload(
     std::vector<std::pair<std::string, unsigned>> const &proportion,
     unsigned instructionCacheSize,
@@ -203,110 +286,28 @@ int ZENFMAPayload::compilePayload(
   auto Loop = cb.newLabel();
   cb.bind(Loop);
 
-  auto shift_pos = 0;
-  bool left = false;
-  auto itemCount = 0;
-  auto add_dest = add_regs_start;
-  unsigned l1_offset = 0;
-
-#define L1_INCREMENT()                                                         \
-  l1_offset += 64;                                                             \
-  if (l1_offset < l1_size * 0.5) {                                             \
-    cb.add(l1_addr, offset_reg);                                               \
-  } else {                                                                     \
-    l1_offset = 0;                                                             \
-    cb.mov(l1_addr, pointer_reg);                                              \
-  }
-
-#define L2_INCREMENT() cb.add(l2_addr, offset_reg);
-
-#define L3_INCREMENT() cb.add(l3_addr, offset_reg)
-
-#define RAM_INCREMENT() cb.add(ram_addr, offset_reg)
-
-  for (unsigned count = 0; count < repetitions; count++) {
-    for (const auto &item : sequence) {
-
-      // swap second and third param of fma instruction to force bitchanges on
-      // the pipes to its execution units
-      Ymm secondParam;
-      Ymm thirdParam;
-      if (0 == itemCount % 2) {
-        secondParam = ymm0;
-        thirdParam = ymm1;
-      } else {
-        secondParam = ymm1;
-        thirdParam = ymm0;
-      }
+  std::vector<InstructionGroups<ZENFMAContext>::Emitter> emitters;
+  std::string unknown;
 
-      if (item == "REG") {
-        cb.vfmadd231pd(Ymm(add_dest), secondParam, thirdParam);
-        cb.xor_(temp_reg,
-                shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs]);
-        if (left) {
-          cb.shr(shift_reg[shift_pos], Imm(1));
-        } else {
-          cb.shl(shift_reg[shift_pos], Imm(1));
-        }
-      } else if (item == "L1_LS") {
-        cb.vfmadd231pd(Ymm(add_dest), secondParam, ymmword_ptr(l1_addr, 32));
-        cb.vmovapd(xmmword_ptr(l1_addr, 64), Xmm(add_dest));
-        L1_INCREMENT();
-      } else if (item == "L2_L") {
-        cb.vfmadd231pd(Ymm(add_dest), secondParam, ymmword_ptr(l2_addr, 64));
-        cb.xor_(temp_reg,
-                shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs]);
-        L2_INCREMENT();
-      } else if (item == "L3_L") {
-        cb.vfmadd231pd(Ymm(add_dest), secondParam, ymmword_ptr(l3_addr, 64));
-        cb.xor_(temp_reg,
-                shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs]);
-        L3_INCREMENT();
-      } else if (item == "RAM_L") {
-        cb.vfmadd231pd(Ymm(ram_reg), secondParam, ymmword_ptr(ram_addr, 32));
-        cb.xor_(temp_reg,
-                shift_reg[(shift_pos + nr_shift_regs - 1) % nr_shift_regs]);
-        RAM_INCREMENT();
-      } else {
-        workerLog::error() << "Instruction group " << item << " not found in "
-                           << this->name() << ".";
-        return EXIT_FAILURE;
-      }
-
-      // make sure the shifts do could end up shifting out the data one end.
-      if (itemCount < (int)(sequence.size() * repetitions -
-                            (sequence.size() * repetitions) % 4)) {
-        switch (itemCount % 4) {
-        case 0:
-          cb.vpsrlq(Xmm(13), Xmm(13), Imm(1));
-          break;
-        case 1:
-          cb.vpsllq(Xmm(14), Xmm(14), Imm(1));
-          break;
-        case 2:
-          cb.vpsllq(Xmm(13), Xmm(13), Imm(1));
-          break;
-        case 3:
-          cb.vpsrlq(Xmm(14), Xmm(14), Imm(1));
-          break;
-        }
-      }
-
-      itemCount++;
-
-      add_dest++;
-      if (add_dest > add_regs_end) {
-        add_dest = add_regs_start;
-      }
-
-      shift_pos++;
-      if (shift_pos == nr_shift_regs) {
-        shift_pos = 0;
-        left = !left;
-      }
-    }
+  if (!groups.resolve(sequence, emitters, unknown)) {
+    workerLog::error() << "Instruction group " << unknown << " not found in "
+                       << this->name() << ".";
+    return EXIT_FAILURE;
   }
 
+  ZENFMAContext context{
+      cb,
+      {pointer_reg, offset_reg, l1_addr, l2_addr, l3_addr, ram_addr, l1_size},
+      temp_reg,
+      shift_reg,
+      ram_reg,
+      RegisterRing(add_regs_start, add_regs_end),
+      ShiftRotation(nr_shift_regs),
+      0,
+      static_cast<unsigned>(sequence.size() * repetitions)};
+
+  InstructionGroups<ZENFMAContext>::emit(emitters, repetitions, context);
+
   cb.movq(temp_reg, iter_reg); // restore iteration counter
   if (this->getRAMSequenceCount(sequence) > 0) {
     // reset RAM counter
@@ -135,8 +135,9 @@ int X86Environment::selectFunction(unsigned functionId,
   return EXIT_FAILURE;
 }
 
-int X86Environment::selectInstructionGroups(std::string groups) {
-  const std::string delimiter = ",";
+int X86Environment::parseInstructionGroups(
+    std::string groups,
+    std::vector<std::pair<std::string, unsigned>> &payloadSettings) {
   const std::regex re("^(\\w+):(\\d+)$");
   const auto availableInstructionGroups = this->selectedConfig()
                                               .platformConfig()
@@ -144,7 +145,6 @@ int X86Environment::selectInstructionGroups(std::string groups) {
                                               .getAvailableInstructions();
 
   std::stringstream ss(groups);
-  std::vector<std::pair<std::string, unsigned>> payloadSettings = {};
 
   while (ss.good()) {
     std::string token;
@@ -179,6 +179,16 @@ int X86Environment::selectInstructionGroups(std::string groups) {
     }
   }
 
+  return EXIT_SUCCESS;
+}
+
+int X86Environment::selectInstructionGroups(std::string groups) {
+  std::vector<std::pair<std::string, unsigned>> payloadSettings = {};
+
+  if (EXIT_SUCCESS != this->parseInstructionGroups(groups, payloadSettings)) {
+    return EXIT_FAILURE;
+  }
+
   this->selectedConfig().setPayloadSettings(payloadSettings);
 
   log::info() << "  Running custom instruction group: " << groups;
@@ -186,6 +196,56 @@ int X86Environment::selectInstructionGroups(std::string groups) {
   return EXIT_SUCCESS;
 }
 
+int X86Environment::selectThreadInstructionGroups(std::string groups) {
+  const std::regex re("^([^=]+)=(.+)$");
+
+  std::stringstream ss(groups);
+  std::vector<unsigned> selectedCpus;
+
+  while (ss.good()) {
+    std::string token;
+    std::smatch m;
+    std::getline(ss, token, ';');
+
+    if (!std::regex_match(token, m, re)) {
+      log::error() << "Invalid symbols in CPU instruction-groups: " << token
+                   << "\n       --run-instruction-groups-on-cpus format: "
+                      "multiple CPULIST=GROUPS pairs semicolon-seperated";
+      return EXIT_FAILURE;
+    }
+
+    ThreadGroup group;
+    group.cpuList = m[1].str();
+
+    if (EXIT_SUCCESS != parseCpuList(group.cpuList, group.cpus)) {
+      return EXIT_FAILURE;
+    }
+
+    for (auto const &cpu : group.cpus) {
+      if (std::find(selectedCpus.begin(), selectedCpus.end(), cpu) !=
+          selectedCpus.end()) {
+        log::error() << "CPU " << cpu
+                     << " is selected by more than one CPULIST in "
+                        "--run-instruction-groups-on-cpus";
+        return EXIT_FAILURE;
+      }
+      selectedCpus.push_back(cpu);
+    }
+
+    if (EXIT_SUCCESS !=
+        this->parseInstructionGroups(m[2].str(), group.payloadSettings)) {
+      return EXIT_FAILURE;
+    }
+
+    log::info() << "  Running custom instruction group on CPUs "
+                << group.cpuList << ": " << m[2].str();
+
+    this->_threadGroups.push_back(std::move(group));
+  }
+
+  return EXIT_SUCCESS;
+}
+
 void X86Environment::printAvailableInstructionGroups() {
   std::stringstream ss;
 
@@ -0,0 +1,367 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/Firestarter.hpp>
+#include <firestarter/Logging/Log.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+extern "C" {
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+using namespace firestarter;
+
+namespace {
+const std::string UNIX_PREFIX = "unix:";
+
+// time between checks of the termination and samples of the iterations
+constexpr int POLL_MSEC = 200;
+constexpr auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+
+// escape a label value of the OpenMetrics text format
+std::string escapeLabel(std::string const &value) {
+  std::string escaped;
+  for (auto c : value) {
+    if (c == '\\' || c == '"') {
+      escaped.push_back('\\');
+      escaped.push_back(c);
+    } else if (c == '\n') {
+      escaped.append("\\n");
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+void sendAll(int fd, std::string const &data) {
+  const char *ptr = data.data();
+  std::size_t size = data.size();
+
+  while (size > 0) {
+    auto count = send(fd, ptr, size, MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return;
+    }
+    ptr += count;
+    size -= count;
+  }
+}
+} // namespace
+
+int Firestarter::initExporterWorker() {
+  if (_exporterAddress.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0) {
+    auto path = _exporterAddress.substr(UNIX_PREFIX.size());
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      log::error() << "Option --exporter: invalid socket path " << path;
+      return EXIT_FAILURE;
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // remove the socket of a previous run
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+      unlink(path.c_str());
+    }
+
+    _exporterFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_exporterFd >= 0 &&
+        bind(_exporterFd, reinterpret_cast<struct sockaddr *>(&addr),
+             sizeof(addr)) != 0) {
+      close(_exporterFd);
+      _exporterFd = -1;
+    }
+  } else {
+    // [HOST:]PORT, HOST defaults to the loopback
+    std::string host = "127.0.0.1";
+    std::string port = _exporterAddress;
+    auto pos = _exporterAddress.rfind(':');
+    if (pos != std::string::npos) {
+      host = _exporterAddress.substr(0, pos);
+      port = _exporterAddress.substr(pos + 1);
+      // IPv6 addresses are given as [ADDRESS]
+      if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+      }
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo *result;
+    int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (error != 0) {
+      log::error() << "Option --exporter: " << _exporterAddress << ": "
+                   << gai_strerror(error);
+      return EXIT_FAILURE;
+    }
+
+    for (auto ai = result; ai != nullptr; ai = ai->ai_next) {
+      _exporterFd =
+          socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+      if (_exporterFd < 0) {
+        continue;
+      }
+
+      int reuse = 1;
+      setsockopt(_exporterFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+      if (bind(_exporterFd, ai->ai_addr, ai->ai_addrlen) == 0) {
+        break;
+      }
+
+      close(_exporterFd);
+      _exporterFd = -1;
+    }
+
+    freeaddrinfo(result);
+  }
+
+  if (_exporterFd < 0 || listen(_exporterFd, 16) != 0) {
+    log::error() << "Option --exporter: could not listen on "
+                 << _exporterAddress << ": " << std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  // the payload of the master thread does not change
+  this->exporterThread =
+      std::thread(&Firestarter::exporterWorker, this,
+                  this->environment().selectedConfig().payload().name());
+
+  return EXIT_SUCCESS;
+}
+
+void Firestarter::joinExporterWorker() {
+  this->exporterThread.join();
+
+  close(_exporterFd);
+  _exporterFd = -1;
+
+  if (_exporterAddress.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0) {
+    unlink(_exporterAddress.substr(UNIX_PREFIX.size()).c_str());
+  }
+}
+
+void Firestarter::exporterWorker(std::string payloadName) {
+  using clock = std::chrono::steady_clock;
+
+  // the iterations of the threads at the last sample to calculate the rates
+  std::vector<unsigned long long> lastIterations(this->loadThreads.size(), 0);
+  std::vector<double> iterationRates(this->loadThreads.size(), 0);
+  auto lastSample = clock::now();
+
+  for (;;) {
+    struct pollfd pfd = {_exporterFd, POLLIN, 0};
+    int ready = poll(&pfd, 1, POLL_MSEC);
+
+    {
+      std::lock_guard<std::mutex> lk(Firestarter::_watchdogTerminateMutex);
+      if (Firestarter::_watchdog_terminate) {
+        return;
+      }
+    }
+
+    // the watchdog stopped the threads after the timeout
+    if (Firestarter::loadVar == LOAD_STOP) {
+      return;
+    }
+
+    auto now = clock::now();
+    if (now - lastSample >= SAMPLE_INTERVAL) {
+      double seconds = std::chrono::duration<double>(now - lastSample).count();
+      for (std::size_t i = 0; i < this->loadThreads.size(); i++) {
+        auto iterations = this->loadThreads[i].second->totalIterations.load(
+            std::memory_order_relaxed);
+        iterationRates[i] = (iterations - lastIterations[i]) / seconds;
+        lastIterations[i] = iterations;
+      }
+      lastSample = now;
+    }
+
+    if (ready <= 0) {
+      continue;
+    }
+
+    int client = accept4(_exporterFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      continue;
+    }
+
+    // do not let a client block the exporter
+    struct timeval timeout = {1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // read the request header
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.size() < 8192) {
+      auto count = recv(client, buffer, sizeof(buffer), 0);
+      if (count <= 0) {
+        break;
+      }
+      request.append(buffer, count);
+    }
+
+    std::string method, target;
+    std::istringstream(request.substr(0, request.find("\r\n"))) >> method >>
+        target;
+
+    std::string status = "200 OK";
+    std::string contentType =
+        "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    std::string body;
+
+    if (method != "GET") {
+      status = "405 Method Not Allowed";
+    } else if (target != "/metrics" && target != "/") {
+      status = "404 Not Found";
+    } else {
+      body = this->exporterMetrics(payloadName, lastIterations, iterationRates);
+    }
+
+    if (body.empty()) {
+      contentType = "text/plain; charset=utf-8";
+      body = status + "\n";
+    }
+
+    std::stringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: " << contentType << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+
+    sendAll(client, response.str());
+    close(client);
+  }
+}
+
+std::string Firestarter::exporterMetrics(
+    std::string const &payloadName,
+    std::vector<unsigned long long> const &iterations,
+    std::vector<double> const &iterationRates) {
+  std::stringstream ss;
+
+  // the latest values published by the measurement worker
+  if (_measurementWorker) {
+    ss << "# TYPE firestarter_metric gauge\n"
+       << "# HELP firestarter_metric Latest value of a metric. Accumulative "
+          "metrics are given as rate per second.\n";
+
+    auto snapshot = _measurementWorker->snapshot();
+    if (snapshot) {
+      for (auto const &entry : *snapshot) {
+        auto time =
+            std::chrono::duration<double>(entry.time.time_since_epoch())
+                .count();
+        char timestamp[32];
+        std::snprintf(timestamp, sizeof(timestamp), "%.3f", time);
+
+        ss << "firestarter_metric{metric=\"" << escapeLabel(entry.name)
+           << "\",unit=\"" << escapeLabel(entry.unit) << "\"} " << entry.value
+           << " " << timestamp << "\n";
+      }
+    }
+  }
+
+  // the threads only publish their iterations when they leave the high load
+  // function. without a load period the values would never change.
+  if (_period != std::chrono::microseconds::zero()) {
+    // the iterations of the load threads as sampled by the exporter
+    ss << "# TYPE firestarter_thread_iterations counter\n"
+       << "# HELP firestarter_thread_iterations Iterations of the payload. "
+          "Updated whenever a thread leaves the high load.\n";
+    for (std::size_t i = 0; i < iterations.size(); i++) {
+      auto const &td = this->loadThreads[i].second;
+      ss << "firestarter_thread_iterations_total{thread=\"" << td->id()
+         << "\",cpu=\"" << this->environment().getCpuIdOfThread(td->id())
+         << "\"} " << iterations[i] << "\n";
+    }
+
+    ss << "# TYPE firestarter_thread_iteration_rate gauge\n"
+       << "# HELP firestarter_thread_iteration_rate Iterations of the payload "
+          "per second.\n";
+    for (std::size_t i = 0; i < iterationRates.size(); i++) {
+      auto const &td = this->loadThreads[i].second;
+      ss << "firestarter_thread_iteration_rate{thread=\"" << td->id()
+         << "\",cpu=\"" << this->environment().getCpuIdOfThread(td->id())
+         << "\"} " << iterationRates[i] << "\n";
+    }
+  }
+
+  // the current payload settings
+  ss << "# TYPE firestarter_payload info\n"
+     << "# HELP firestarter_payload The payload of the load threads.\n"
+     << "firestarter_payload_info{payload=\"" << escapeLabel(payloadName)
+     << "\"} 1\n";
+
+  ss << "# TYPE firestarter_payload_setting gauge\n"
+     << "# HELP firestarter_payload_setting Number of instruction groups of "
+        "an item of the payload.\n";
+  auto settings = std::atomic_load(&_payloadSettings);
+  if (settings) {
+    for (auto const &[item, count] : *settings) {
+      ss << "firestarter_payload_setting{item=\"" << escapeLabel(item)
+         << "\"} " << count << "\n";
+    }
+  }
+
+  // the load state at the time of the request
+  unsigned long long load = Firestarter::loadVar;
+  ss << "# TYPE firestarter_load stateset\n"
+     << "# HELP firestarter_load The load requested by the watchdog.\n";
+  std::pair<const char *, unsigned long long> const states[] = {
+      {"high", LOAD_HIGH},
+      {"low", LOAD_LOW},
+      {"switch", LOAD_SWITCH},
+      {"stop", LOAD_STOP}};
+  for (auto const &[state, value] : states) {
+    ss << "firestarter_load{firestarter_load=\"" << state << "\"} "
+       << (load == value ? 1 : 0) << "\n";
+  }
+
+  ss << "# TYPE firestarter_load_percent gauge\n"
+     << "# HELP firestarter_load_percent The requested load in percent.\n"
+     << "firestarter_load_percent " << _loadPercent << "\n";
+
+  ss << "# EOF\n";
+
+  return ss.str();
+}
@@ -24,16 +24,20 @@
 #ifndef FIRESTARTER_BUILD_CUDA_ONLY
 #if defined(linux) || defined(__linux__)
 #include <firestarter/Optimizer/Algorithm/NSGA2.hpp>
+#include <firestarter/Optimizer/Algorithm/SurrogateNSGA2.hpp>
 #include <firestarter/Optimizer/History.hpp>
 #include <firestarter/Optimizer/Problem/CLIArgumentProblem.hpp>
 extern "C" {
 #include <firestarter/Measurement/Metric/IPCEstimate.h>
+#include <firestarter/Measurement/Metric/MSR.h>
+#include <firestarter/Measurement/Metric/Perf.h>
 }
 #endif
 #endif
 
 #include <csignal>
 #include <functional>
+#include <numeric>
 #include <thread>
 
 #ifdef _MSC_VER
@@ -42,39 +46,161 @@ extern "C" {
 
 using namespace firestarter;
 
+#ifndef FIRESTARTER_BUILD_CUDA_ONLY
+namespace {
+// format payload settings as ITEM:COUNT,...
+std::string payloadSettingsString(
+    std::vector<std::pair<std::string, unsigned>> const &settings) {
+  std::string result;
+  for (auto const &[item, count] : settings) {
+    if (!result.empty()) {
+      result += ",";
+    }
+    result += item + ":" + std::to_string(count);
+  }
+  return result;
+}
+
+#if defined(linux) || defined(__linux__)
+// the smallest individual whose high load loop has the same instructions as
+// the one of individual. offsets are the index of the first item of every
+// thread group, linesPerThread the number of instruction groups in the high
+// load loop of a thread.
+optimizer::Individual
+canonicalIndividual(optimizer::Individual const &individual,
+                    std::vector<std::size_t> const &offsets,
+                    unsigned linesPerThread) {
+  using environment::payload::Payload;
+
+  optimizer::Individual canonical(individual);
+
+  for (std::size_t g = 0; g < offsets.size(); ++g) {
+    auto begin = offsets[g];
+    auto end = g + 1 < offsets.size() ? offsets[g + 1] : individual.size();
+
+    unsigned divisor = 0;
+    unsigned long long length = 0;
+    for (auto i = begin; i < end; ++i) {
+      divisor = std::gcd(divisor, individual[i]);
+      length += individual[i];
+    }
+
+    // the sequence is not repeated at all if it is longer than the loop. the
+    // loop stays empty like the one of an individual of zeros.
+    if (length > linesPerThread) {
+      std::fill(canonical.begin() + begin, canonical.begin() + end, 0);
+      continue;
+    }
+
+    if (divisor <= 1) {
+      continue;
+    }
+
+    std::vector<std::pair<std::string, unsigned>> proportion;
+    for (auto i = begin; i < end; ++i) {
+      proportion.emplace_back(std::to_string(i), individual[i]);
+    }
+    auto sequence = Payload::generateSequence(proportion);
+
+    // the loop repeats the sequence linesPerThread / length times. dividing
+    // the individual by d keeps the loop if the sequence repeats the reduced
+    // sequence and the remainder of the loop is too short for another
+    // repetition of the reduced sequence. try the largest divisor first.
+    for (unsigned d = divisor; d > 1; --d) {
+      if (divisor % d != 0 || linesPerThread % length >= length / d) {
+        continue;
+      }
+
+      std::vector<std::pair<std::string, unsigned>> reducedProportion;
+      for (auto i = begin; i < end; ++i) {
+        reducedProportion.emplace_back(std::to_string(i), individual[i] / d);
+      }
+      auto reducedSequence = Payload::generateSequence(reducedProportion);
+
+      bool repeats = true;
+      for (std::size_t i = 0; i < sequence.size(); ++i) {
+        if (sequence[i] != reducedSequence[i % reducedSequence.size()]) {
+          repeats = false;
+          break;
+        }
+      }
+
+      if (repeats) {
+        for (auto i = begin; i < end; ++i) {
+          canonical[i] = individual[i] / d;
+        }
+        break;
+      }
+    }
+  }
+
+  return canonical;
+}
+#endif
+} // namespace
+#endif
+
 Firestarter::Firestarter(
     const int argc, const char **argv, std::chrono::seconds const &timeout,
     unsigned loadPercent, std::chrono::microseconds const &period,
-    unsigned requestedNumThreads, std::string const &cpuBind,
+    bool precisePeriod, std::chrono::microseconds const &spinTime,
+    bool realtimeWatchdog, std::string const &loadProfile,
+    std::string const &stagger, unsigned requestedNumThreads,
+    std::string const &cpuBind, std::string const &loadVariable,
+    bool payloadPerPackage, std::string const &hugePages,
     bool printFunctionSummary, unsigned functionId, bool listInstructionGroups,
-    std::string const &instructionGroups, unsigned lineCount,
+    std::string const &instructionGroups,
+    std::string const &cpuInstructionGroups, unsigned lineCount,
     bool allowUnavailablePayload, bool dumpRegisters,
     std::chrono::seconds const &dumpRegistersTimeDelta,
-    std::string const &dumpRegistersOutpath, int gpus, unsigned gpuMatrixSize,
-    bool gpuUseFloat, bool gpuUseDouble, bool listMetrics, bool measurement,
+    std::string const &dumpRegistersOutpath, bool measureLoadSkew, int gpus,
+    unsigned gpuMatrixSize, bool gpuUseFloat, bool gpuUseDouble,
+    bool listMetrics, bool measurement,
     std::chrono::milliseconds const &startDelta,
     std::chrono::milliseconds const &stopDelta,
     std::chrono::milliseconds const &measurementInterval,
     std::vector<std::string> const &metricPaths,
-    std::vector<std::string> const &stdinMetrics, bool optimize,
+    std::vector<std::string> const &stdinMetrics,
+    unsigned long long measurementBufferSize,
+    std::string const &measurementSpillPath, std::string const &perfEvents,
+    unsigned msrRaplInterval, std::string const &streamDestination,
+    std::string const &streamFormat,
+    std::string const &exporterAddress, std::string const &controlMetric,
+    double controlTarget, std::chrono::milliseconds const &controlInterval,
+    double controlKp, double controlKi, double controlKd,
+    double controlMaxRate, bool optimize,
     std::chrono::seconds const &preheat,
     std::string const &optimizationAlgorithm,
     std::vector<std::string> const &optimizationMetrics,
     std::chrono::seconds const &evaluationDuration, unsigned individuals,
-    std::string const &optimizeOutfile, unsigned generations, double nsga2_cr,
-    double nsga2_m)
+    std::string const &optimizeOutfile, std::string const &optimizeTrace,
+    std::string const &optimizeCheckpoint, bool resume,
+    std::vector<std::string> const &optimizeWarmStart, unsigned generations,
+    double nsga2_cr, double nsga2_m, unsigned surrogateEvaluations)
     : _argc(argc), _argv(argv), _timeout(timeout), _loadPercent(loadPercent),
-      _period(period), _dumpRegisters(dumpRegisters),
+      _period(period), _precisePeriod(precisePeriod), _spinTime(spinTime),
+      _realtimeWatchdog(realtimeWatchdog), _stagger(stagger),
+      _dumpRegisters(dumpRegisters),
       _dumpRegistersTimeDelta(dumpRegistersTimeDelta),
-      _dumpRegistersOutpath(dumpRegistersOutpath), _gpus(gpus),
-      _gpuMatrixSize(gpuMatrixSize), _gpuUseFloat(gpuUseFloat),
+      _dumpRegistersOutpath(dumpRegistersOutpath), _loadVariable(loadVariable),
+      _payloadPerPackage(payloadPerPackage), _hugePages(hugePages),
+      _measureLoadSkew(measureLoadSkew),
+      _gpus(gpus), _gpuMatrixSize(gpuMatrixSize), _gpuUseFloat(gpuUseFloat),
       _gpuUseDouble(gpuUseDouble), _startDelta(startDelta),
-      _stopDelta(stopDelta), _measurement(measurement), _optimize(optimize),
+      _stopDelta(stopDelta), _measurement(measurement),
+      _exporterAddress(exporterAddress), _controlMetric(controlMetric),
+      _controlTarget(controlTarget), _controlInterval(controlInterval),
+      _controlKp(controlKp),
+      _controlKi(controlKi), _controlKd(controlKd),
+      _controlMaxRate(controlMaxRate), _optimize(optimize),
       _preheat(preheat), _optimizationAlgorithm(optimizationAlgorithm),
       _optimizationMetrics(optimizationMetrics),
       _evaluationDuration(evaluationDuration), _individuals(individuals),
-      _optimizeOutfile(optimizeOutfile), _generations(generations),
-      _nsga2_cr(nsga2_cr), _nsga2_m(nsga2_m) {
+      _optimizeOutfile(optimizeOutfile), _optimizeTrace(optimizeTrace),
+      _optimizeCheckpoint(optimizeCheckpoint), _resume(resume),
+      _optimizeWarmStart(optimizeWarmStart), _generations(generations),
+      _nsga2_cr(nsga2_cr), _nsga2_m(nsga2_m),
+      _surrogateEvaluations(surrogateEvaluations) {
   int returnCode;
 
   _load = (_period * _loadPercent) / 100;
@@ -82,6 +208,26 @@ Firestarter::Firestarter(
     _period = std::chrono::microseconds::zero();
   }
 
+#ifndef FIRESTARTER_BUILD_CUDA_ONLY
+  // the load level is taken from the profile in every period
+  if (!loadProfile.empty()) {
+    _loadProfile = LoadProfile::fromString(loadProfile);
+    _period = period;
+  }
+
+#if defined(linux) || defined(__linux__)
+  // the controller sets the load level, starting in the middle
+  if (!_controlMetric.empty()) {
+    auto profile = std::make_unique<VariableLoadProfile>(0.5);
+    _controlledLoadProfile = profile.get();
+    _loadProfile = std::move(profile);
+    _period = period;
+  }
+#endif
+#else
+  (void)loadProfile;
+#endif
+
 #ifndef FIRESTARTER_BUILD_CUDA_ONLY
 #if defined(linux) || defined(__linux__)
 #else
@@ -89,6 +235,12 @@ Firestarter::Firestarter(
   (void)measurementInterval;
   (void)metricPaths;
   (void)stdinMetrics;
+  (void)measurementBufferSize;
+  (void)measurementSpillPath;
+  (void)perfEvents;
+  (void)msrRaplInterval;
+  (void)streamDestination;
+  (void)streamFormat;
 #endif
 
 #if defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) ||            \
@@ -101,6 +253,11 @@ Firestarter::Firestarter(
     std::exit(returnCode);
   }
 
+  if (_precisePeriod && !this->environment().topology().hasInvariantRdtsc()) {
+    log::warn() << "The TSC is not invariant, option --precise-period will "
+                   "be ignored.";
+  }
+
   this->environment().evaluateFunctions();
 
   if (printFunctionSummary) {
@@ -126,23 +283,73 @@ Firestarter::Firestarter(
     }
   }
 
+  if (!cpuInstructionGroups.empty()) {
+    if (EXIT_SUCCESS !=
+        (returnCode = this->environment().selectThreadInstructionGroups(
+             cpuInstructionGroups))) {
+      std::exit(returnCode);
+    }
+  }
+
   if (lineCount != 0) {
     this->environment().setLineCount(lineCount);
   }
 
 #if defined(linux) || defined(__linux__)
-  if (_measurement || listMetrics || _optimize) {
+  if (_measurement || listMetrics || _optimize || !_controlMetric.empty() ||
+      !streamDestination.empty() || !_exporterAddress.empty()) {
+    measurement::MetricStream::Format format;
+    if (EXIT_SUCCESS !=
+        measurement::MetricStream::parseFormat(streamFormat, format)) {
+      log::error() << "Option --stream-format: unknown format \""
+                   << streamFormat << "\"";
+      std::exit(EXIT_FAILURE);
+    }
+
+    if (!perfEvents.empty() &&
+        EXIT_SUCCESS != perf_events_metric_set_events(perfEvents.c_str())) {
+      log::error() << "Option --perf-events: "
+                   << perf_events_metric.get_error();
+      std::exit(EXIT_FAILURE);
+    }
+
+    // measure perf-ipc and perf-freq only on the cpus of the load threads and
+    // sample msr-rapl on the other cpus
+    std::vector<int> loadCpus;
+    for (unsigned long long i = 0;
+         i < this->environment().requestedNumThreads(); i++) {
+      auto cpu = this->environment().getCpuIdOfThread(i);
+      if (cpu >= 0) {
+        loadCpus.push_back(cpu);
+      }
+    }
+    perf_metric_set_cpus(loadCpus.data(), loadCpus.size());
+    msr_rapl_metric_set_load_cpus(loadCpus.data(), loadCpus.size());
+
     _measurementWorker = std::make_shared<measurement::MeasurementWorker>(
         measurementInterval, this->environment().requestedNumThreads(),
-        metricPaths, stdinMetrics);
+        metricPaths, stdinMetrics, measurementBufferSize, measurementSpillPath);
 
     if (listMetrics) {
       log::info() << _measurementWorker->availableMetrics();
       std::exit(EXIT_SUCCESS);
     }
 
-    // init all metrics
+    // init all metrics. perf-events and the samplers of msr-rapl are only
+    // used if they were requested.
     auto all = _measurementWorker->metricNames();
+    if (perfEvents.empty()) {
+      all.erase(std::remove(all.begin(), all.end(),
+                            std::string(perf_events_metric.name)),
+                all.end());
+    }
+    if (msrRaplInterval == 0) {
+      all.erase(std::remove(all.begin(), all.end(),
+                            std::string(msr_rapl_metric.name)),
+                all.end());
+    } else {
+      msr_rapl_metric_set_interval(msrRaplInterval);
+    }
     auto initialized = _measurementWorker->initMetrics(all);
 
     if (initialized.size() == 0) {
@@ -151,27 +358,94 @@ Firestarter::Firestarter(
     }
 
     // check if selected metrics are initialized
-    for (auto const &optimizationMetric : optimizationMetrics) {
-      auto nameEqual = [optimizationMetric](auto const &name) {
-        return name.compare(optimizationMetric) == 0;
+    auto selectedMetrics = optimizationMetrics;
+    if (!_controlMetric.empty()) {
+      selectedMetrics.push_back(_controlMetric);
+    }
+
+    for (auto const &selectedMetric : selectedMetrics) {
+      if (perfEvents.empty() &&
+          0 == selectedMetric.rfind(perf_events_metric.name, 0)) {
+        log::error() << "Metric \"" << selectedMetric
+                     << "\" requires --perf-events.";
+        std::exit(EXIT_FAILURE);
+      }
+      if (msrRaplInterval == 0 &&
+          0 == selectedMetric.rfind(msr_rapl_metric.name, 0)) {
+        log::error() << "Metric \"" << selectedMetric
+                     << "\" requires --msr-rapl-interval.";
+        std::exit(EXIT_FAILURE);
+      }
+      auto nameEqual = [selectedMetric](auto const &name) {
+        return name.compare(selectedMetric) == 0;
       };
-      // metric name is not found
-      if (std::find_if(all.begin(), all.end(), nameEqual) == all.end()) {
-        log::error() << "Metric \"" << optimizationMetric
-                     << "\" does not exist.";
+      // metric name is not found. submetrics are only known after
+      // initialization.
+      if (std::find_if(all.begin(), all.end(), nameEqual) == all.end() &&
+          std::find_if(initialized.begin(), initialized.end(), nameEqual) ==
+              initialized.end()) {
+        log::error() << "Metric \"" << selectedMetric << "\" does not exist.";
         std::exit(EXIT_FAILURE);
       }
       // metric has not initialized properly
       if (std::find_if(initialized.begin(), initialized.end(), nameEqual) ==
           initialized.end()) {
-        log::error() << "Metric \"" << optimizationMetric
+        log::error() << "Metric \"" << selectedMetric
                      << "\" failed to initialize.";
         std::exit(EXIT_FAILURE);
       }
     }
+
+    if (!streamDestination.empty() &&
+        EXIT_SUCCESS !=
+            _measurementWorker->startStream(streamDestination, format)) {
+      std::exit(EXIT_FAILURE);
+    }
+
+    if (!_exporterAddress.empty()) {
+      _measurementWorker->enableSnapshots();
+    }
   }
 
   if (_optimize) {
+    // find the thread groups which are in use. index 0 are the threads
+    // without a thread group.
+    auto const &threadGroups = this->environment().threadGroups();
+    std::vector<bool> groupUsed(threadGroups.size() + 1, false);
+
+    for (unsigned i = 0; i < this->environment().requestedNumThreads(); i++) {
+      groupUsed[this->environment().getThreadGroupOfThread(i) + 1] = true;
+    }
+
+    for (std::size_t i = 0; i < groupUsed.size(); i++) {
+      _optimizationItemOffsets.push_back(_optimizationItems.size());
+
+      if (!groupUsed[i]) {
+        continue;
+      }
+
+      if (i == 0) {
+        for (auto const &item :
+             this->environment().selectedConfig().payloadItems()) {
+          _optimizationItems.push_back(item);
+        }
+      } else {
+        for (auto const &item : threadGroups[i - 1].payloadSettings) {
+          _optimizationItems.push_back(item.first + "@" +
+                                       threadGroups[i - 1].cpuList);
+        }
+      }
+    }
+
+    // individuals with the same high load loops share their evaluation
+    optimizer::History::setCanonical(
+        [offsets = _optimizationItemOffsets,
+         linesPerThread = this->environment().selectedConfig().lines() /
+                          this->environment().selectedConfig().thread()](
+            optimizer::Individual const &individual) {
+          return canonicalIndividual(individual, offsets, linesPerThread);
+        });
+
     auto applySettings = std::bind(
         [this](std::vector<std::pair<std::string, unsigned>> const &setting) {
           using Clock = std::chrono::high_resolution_clock;
@@ -180,43 +454,46 @@ Firestarter::Firestarter(
           for (auto &thread : this->loadThreads) {
             auto td = thread.second;
 
-            td->config().setPayloadSettings(setting);
-          }
+            // take the values of the items of the thread group
+            auto group = this->environment().getThreadGroupOfThread(td->id());
+            auto offset = this->_optimizationItemOffsets[group + 1];
+            auto items = td->config().payloadItems();
 
-          for (auto const &thread : this->loadThreads) {
-            auto td = thread.second;
+            std::vector<std::pair<std::string, unsigned>> threadSetting;
+            for (std::size_t i = 0; i < items.size(); i++) {
+              threadSetting.push_back(
+                  std::make_pair(items[i], setting[offset + i].second));
+            }
 
-            td->mutex.lock();
+            td->config().setPayloadSettings(threadSetting);
           }
 
-          for (auto const &thread : this->loadThreads) {
-            auto td = thread.second;
-
-            td->comm = THREAD_SWITCH;
-            td->mutex.unlock();
+          // compile the new payload while the threads are still running the
+          // old one
+          if (EXIT_SUCCESS != this->compileLoadWorkerPayloads()) {
+            std::exit(EXIT_FAILURE);
           }
 
-          this->loadVar = LOAD_SWITCH;
+          // the threads will only see the command after they left the high
+          // load function
+          this->controlPlane.post(THREAD_SWITCH);
 
-          for (auto const &thread : this->loadThreads) {
-            auto td = thread.second;
-            bool ack;
-
-            do {
-              td->mutex.lock();
-              ack = td->ack;
-              td->mutex.unlock();
-            } while (!ack);
+          // write every load variable, the threads may use their own copy
+          this->setLoad(LOAD_SWITCH);
 
-            td->mutex.lock();
-            td->ack = false;
-            td->mutex.unlock();
-          }
+          this->controlPlane.waitForAcks();
 
-          this->loadVar = LOAD_HIGH;
+          this->setLoad(LOAD_HIGH);
 
           this->signalWork();
 
+          this->insertEvent("payload", payloadSettingsString(setting));
+          std::atomic_store(
+              &this->_payloadSettings,
+              std::make_shared<
+                  const std::vector<std::pair<std::string, unsigned>>>(
+                  setting));
+
           unsigned long long startTimestamp = 0xffffffffffffffff;
           unsigned long long stopTimestamp = 0;
 
@@ -235,10 +512,7 @@ Firestarter::Firestarter(
             auto td = thread.second;
             ipc_estimate_metric_insert(
                 (double)td->lastIterations *
-                (double)this->loadThreads.front()
-                    .second->config()
-                    .payload()
-                    .instructions() /
+                (double)td->config().payload().instructions() /
                 (double)(stopTimestamp - startTimestamp));
           }
 
@@ -255,14 +529,17 @@ Firestarter::Firestarter(
     auto prob =
         std::make_shared<firestarter::optimizer::problem::CLIArgumentProblem>(
             std::move(applySettings), _measurementWorker, _optimizationMetrics,
-            _evaluationDuration, _startDelta, _stopDelta,
-            this->environment().selectedConfig().payloadItems());
+            _evaluationDuration, _startDelta, _stopDelta, _optimizationItems);
 
     _population = firestarter::optimizer::Population(std::move(prob));
 
     if (_optimizationAlgorithm == "NSGA2") {
       _algorithm = std::make_unique<firestarter::optimizer::algorithm::NSGA2>(
           _generations, _nsga2_cr, _nsga2_m);
+    } else if (_optimizationAlgorithm == "NSGA2-GP") {
+      _algorithm = std::make_unique<
+          firestarter::optimizer::algorithm::SurrogateNSGA2>(
+          _generations, _nsga2_cr, _nsga2_m, _surrogateEvaluations);
     } else {
       throw std::invalid_argument("Algorithm " + _optimizationAlgorithm +
                                   " unknown.");
@@ -271,6 +548,13 @@ Firestarter::Firestarter(
     _algorithm->checkPopulation(
         static_cast<firestarter::optimizer::Population const &>(_population),
         _individuals);
+
+    if (!_optimizeCheckpoint.empty()) {
+      _checkpoint = std::make_shared<firestarter::optimizer::Checkpoint>(
+          _optimizeCheckpoint, _optimizationAlgorithm, _optimizationItems);
+      _algorithm->setCheckpoint(_checkpoint);
+      _population.setCheckpoint(_checkpoint);
+    }
   }
 #endif
 
@@ -320,11 +604,34 @@ void Firestarter::mainThread() {
 #if defined(linux) || defined(__linux__)
   // if measurement is enabled, start it here
   if (_measurement) {
-    _measurementWorker->startMeasurement();
+    _measurementWorker->startMeasurement(_startDelta, _stopDelta);
   }
 #endif
 
-  this->signalWork();
+  {
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+
+    // the threads acknowledge the work command after they finished their
+    // initialization
+    this->signalWork();
+
+    this->insertEvent(
+        "payload",
+        this->environment().selectedConfig().payload().name() + " " +
+            payloadSettingsString(
+                this->environment().selectedConfig().payloadSettings()));
+
+    auto end = Clock::now();
+
+    log::debug() << "Initializing the load threads took "
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(end -
+                                                                          start)
+                        .count()
+                 << "ms";
+  }
+
+  this->printMemorySummary();
 
 #ifdef FIRESTARTER_DEBUG_FEATURES
   if (_dumpRegisters) {
@@ -336,6 +643,23 @@ void Firestarter::mainThread() {
   }
 #endif
 
+#if defined(linux) || defined(__linux__)
+  if (!_controlMetric.empty()) {
+    this->initLoadControllerWorker();
+  }
+
+  if (!_exporterAddress.empty()) {
+    std::atomic_store(
+        &_payloadSettings,
+        std::make_shared<const std::vector<std::pair<std::string, unsigned>>>(
+            this->environment().selectedConfig().payloadSettings()));
+
+    if (EXIT_SUCCESS != this->initExporterWorker()) {
+      std::exit(EXIT_FAILURE);
+    }
+  }
+#endif
+
   // worker thread for load control
   this->watchdogWorker(_period, _load, _timeout);
 
@@ -344,6 +668,27 @@ void Firestarter::mainThread() {
   if (_optimize) {
     auto startTime = optimizer::History::getTime();
 
+    if (_resume && EXIT_SUCCESS != _checkpoint->load()) {
+      std::exit(EXIT_FAILURE);
+    }
+
+    // the trace is opened after the checkpoint is loaded to continue it
+    if (!_optimizeTrace.empty()) {
+      if (EXIT_SUCCESS != optimizer::History::openTrace(
+                              _optimizeTrace, startTime, _optimizationItems,
+                              _argc, _argv, _resume)) {
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
+    for (auto const &path : _optimizeWarmStart) {
+      if (EXIT_SUCCESS !=
+          optimizer::History::loadPrevious(path, _optimizationItems,
+                                           _optimizationMetrics)) {
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
     Firestarter::_optimizer = std::make_unique<optimizer::OptimizerWorker>(
         std::move(_algorithm), _population, _optimizationAlgorithm,
         _individuals, _preheat);
@@ -351,14 +696,16 @@ void Firestarter::mainThread() {
     // wait here until optimizer thread terminates
     Firestarter::_optimizer->join();
 
-    auto payloadItems = this->environment().selectedConfig().payloadItems();
-
     // print the best 20 according to each metric
     firestarter::optimizer::History::printBest(_optimizationMetrics,
-                                               payloadItems);
+                                               _optimizationItems);
 
-    firestarter::optimizer::History::save(_optimizeOutfile, startTime,
-                                          payloadItems, _argc, _argv);
+    if (firestarter::optimizer::History::tracing()) {
+      firestarter::optimizer::History::closeTrace();
+    } else {
+      firestarter::optimizer::History::save(_optimizeOutfile, startTime,
+                                            _optimizationItems, _argc, _argv);
+    }
 
     // stop all the load threads
     std::raise(SIGTERM);
@@ -367,6 +714,15 @@ void Firestarter::mainThread() {
 
   // wait for watchdog to timeout or until user terminates
   this->joinLoadWorkers();
+  this->insertEvent("load", "stop");
+#if defined(linux) || defined(__linux__)
+  if (!_controlMetric.empty()) {
+    this->joinLoadControllerWorker();
+  }
+  if (!_exporterAddress.empty()) {
+    this->joinExporterWorker();
+  }
+#endif
 #ifdef FIRESTARTER_DEBUG_FEATURES
   if (_dumpRegisters) {
     this->joinDumpRegisterWorker();
@@ -377,25 +733,77 @@ void Firestarter::mainThread() {
     this->printPerformanceReport();
   }
 
+  if (_measureLoadSkew) {
+    this->printLoadSkewReport();
+  }
+
 #if defined(linux) || defined(__linux__)
   // if measurment is enabled, stop it here
   if (_measurement) {
     // TODO: clear this up
-    log::info() << "metric,num_timepoints,duration_ms,average,stddev";
-    for (auto const &[name, sum] :
-         _measurementWorker->getValues(_startDelta, _stopDelta)) {
+    log::info() << "metric,num_timepoints,duration_ms,average,stddev,min,max,"
+                   "p50,p95,p99";
+    for (auto const &[name, sum] : _measurementWorker->getValues()) {
       log::info() << std::quoted(name) << "," << sum.num_timepoints << ","
                   << sum.duration.count() << "," << sum.average << ","
-                  << sum.stddev;
+                  << sum.stddev << "," << sum.min << "," << sum.max << ","
+                  << sum.p50 << "," << sum.p95 << "," << sum.p99;
     }
   }
 #endif
 #endif
 }
 
+void Firestarter::insertEvent(std::string const &name,
+                              std::string const &value) {
+#if !defined(FIRESTARTER_BUILD_CUDA_ONLY) &&                                   \
+    (defined(linux) || defined(__linux__))
+  if (_measurementWorker) {
+    _measurementWorker->insertEvent(name, value);
+  }
+#else
+  (void)name;
+  (void)value;
+#endif
+}
+
+bool Firestarter::eventsActive() const {
+#if !defined(FIRESTARTER_BUILD_CUDA_ONLY) &&                                   \
+    (defined(linux) || defined(__linux__))
+  return _measurementWorker && _measurementWorker->streamActive();
+#else
+  return false;
+#endif
+}
+
 void Firestarter::setLoad(unsigned long long value) {
+  Firestarter::_loadChangeCount.fetch_add(1, std::memory_order_relaxed);
+
   // signal load change to workers
   Firestarter::loadVar = value;
+  for (auto &loadVariable : Firestarter::_loadVariables) {
+    loadVariable.value = value;
+  }
+#if defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) ||            \
+    defined(_M_X64)
+#ifndef _MSC_VER
+  __asm__ __volatile__("mfence;");
+#else
+  _mm_mfence();
+#endif
+#else
+#error "FIRESTARTER is not implemented for this ISA"
+#endif
+}
+
+void Firestarter::setLoadVariable(std::size_t index,
+                                  unsigned long long value) {
+  // do not restart the threads after they were requested to stop
+  if (Firestarter::loadVar == LOAD_STOP) {
+    return;
+  }
+
+  Firestarter::_loadVariables[index].value = value;
 #if defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) ||            \
     defined(_M_X64)
 #ifndef _MSC_VER
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/Firestarter.hpp>
+#include <firestarter/LoadController.hpp>
+#include <firestarter/Logging/Log.hpp>
+
+using namespace firestarter;
+
+void Firestarter::initLoadControllerWorker() {
+  this->loadControllerThread =
+      std::thread(&Firestarter::loadControllerWorker, this);
+}
+
+void Firestarter::joinLoadControllerWorker() {
+  this->loadControllerThread.join();
+}
+
+void Firestarter::loadControllerWorker() {
+  using clock = std::chrono::steady_clock;
+
+  LoadController controller(
+      _controlKp, _controlKi, _controlKd, _controlMaxRate,
+      _controlledLoadProfile->level(std::chrono::nanoseconds::zero()));
+
+  auto last = clock::now();
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lk(Firestarter::_watchdogTerminateMutex);
+      // abort waiting if we get the interrupt signal
+      Firestarter::_watchdogTerminateAlert.wait_for(
+          lk, _controlInterval,
+          []() { return Firestarter::_watchdog_terminate; });
+      if (Firestarter::_watchdog_terminate) {
+        return;
+      }
+    }
+
+    // the watchdog stopped the threads after the timeout
+    if (Firestarter::loadVar == LOAD_STOP) {
+      return;
+    }
+
+    auto now = clock::now();
+    double dt = std::chrono::duration<double>(now - last).count();
+    last = now;
+
+    measurement::Summary summary;
+    if (EXIT_SUCCESS != _measurementWorker->getRecentValue(
+                            _controlMetric, _controlInterval, summary) ||
+        summary.num_timepoints == 0) {
+      log::debug() << "Load controller: no values of metric "
+                   << _controlMetric << " in the last interval.";
+      continue;
+    }
+
+    // the gains apply to the error relative to the target
+    double error = (_controlTarget - summary.average) / _controlTarget;
+    double level = controller.update(error, dt);
+
+    _controlledLoadProfile->setLevel(level);
+
+    log::debug() << "Load controller: " << _controlMetric << " "
+                 << summary.average << ", load level " << 100.0 * level
+                 << " %";
+  }
+}
@@ -0,0 +1,271 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/LoadProfile.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+using namespace firestarter;
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+std::vector<std::string> split(std::string const &str, char delimiter) {
+  std::vector<std::string> parts;
+  std::stringstream ss(str);
+  std::string part;
+
+  while (std::getline(ss, part, delimiter)) {
+    parts.push_back(part);
+  }
+
+  return parts;
+}
+
+double parseNumber(std::string const &str, std::string const &what) {
+  std::size_t pos;
+  double value;
+
+  try {
+    value = std::stod(str, &pos);
+  } catch (std::exception const &) {
+    throw std::invalid_argument("Load profile: " + what +
+                                " is not a number: \"" + str + "\"");
+  }
+
+  if (pos != str.size() || !std::isfinite(value)) {
+    throw std::invalid_argument("Load profile: " + what +
+                                " is not a number: \"" + str + "\"");
+  }
+
+  return value;
+}
+
+// parse a load level in percent and return it in [0,1]
+double parseLevel(std::string const &str) {
+  auto value = parseNumber(str, "load");
+
+  if (value < 0 || value > 100) {
+    throw std::invalid_argument("Load profile: load must be in [0,100]: \"" +
+                                str + "\"");
+  }
+
+  return value / 100;
+}
+
+std::chrono::nanoseconds parseSeconds(std::string const &str) {
+  auto value = parseNumber(str, "duration");
+
+  if (value < 0) {
+    throw std::invalid_argument(
+        "Load profile: duration may not be negative: \"" + str + "\"");
+  }
+
+  return std::chrono::nanoseconds((long long)(value * 1e9));
+}
+
+} // namespace
+
+std::unique_ptr<LoadProfile>
+LoadProfile::fromString(std::string const &profile) {
+  auto colon = profile.find(':');
+  auto type = profile.substr(0, colon);
+  auto args = colon == std::string::npos ? "" : profile.substr(colon + 1);
+
+  if (type == "trace") {
+    if (args.empty()) {
+      throw std::invalid_argument(
+          "Load profile: trace requires a file: trace:FILE");
+    }
+    return TraceLoadProfile::fromFile(args);
+  }
+
+  if (type == "steps") {
+    std::vector<std::pair<double, std::chrono::nanoseconds>> steps;
+
+    for (auto const &step : split(args, ',')) {
+      auto values = split(step, ':');
+      if (values.size() != 2) {
+        throw std::invalid_argument(
+            "Load profile: steps format: steps:LOAD:SECS,LOAD:SECS,...");
+      }
+      steps.push_back(
+          std::make_pair(parseLevel(values[0]), parseSeconds(values[1])));
+    }
+
+    if (steps.empty()) {
+      throw std::invalid_argument(
+          "Load profile: steps format: steps:LOAD:SECS,LOAD:SECS,...");
+    }
+
+    return std::make_unique<StepLoadProfile>(steps);
+  }
+
+  auto values = split(args, ':');
+
+  if (type == "ramp") {
+    if (values.size() != 3) {
+      throw std::invalid_argument(
+          "Load profile: ramp format: ramp:FROM:TO:SECS");
+    }
+    return std::make_unique<RampLoadProfile>(parseLevel(values[0]),
+                                             parseLevel(values[1]),
+                                             parseSeconds(values[2]));
+  }
+
+  if (type == "sine") {
+    if (values.size() != 3) {
+      throw std::invalid_argument(
+          "Load profile: sine format: sine:MEAN:AMPLITUDE:HZ");
+    }
+    auto mean = parseLevel(values[0]);
+    auto amplitude = parseLevel(values[1]);
+    auto frequency = parseNumber(values[2], "frequency");
+    if (frequency <= 0) {
+      throw std::invalid_argument(
+          "Load profile: frequency must be greater than zero");
+    }
+    return std::make_unique<SineLoadProfile>(mean, amplitude, frequency);
+  }
+
+  throw std::invalid_argument("Load profile: unknown type \"" + type +
+                              "\", must be any of: ramp, sine, steps, trace");
+}
+
+double RampLoadProfile::level(std::chrono::nanoseconds time) const {
+  if (time >= _duration) {
+    return _to;
+  }
+
+  return _from + (_to - _from) * ((double)time.count() / _duration.count());
+}
+
+double SineLoadProfile::level(std::chrono::nanoseconds time) const {
+  double seconds = (double)time.count() / 1e9;
+  double level =
+      _mean + _amplitude * std::sin(2 * PI * _frequency * seconds);
+
+  return std::min(1.0, std::max(0.0, level));
+}
+
+StepLoadProfile::StepLoadProfile(
+    std::vector<std::pair<double, std::chrono::nanoseconds>> const &steps)
+    : _steps(steps), _cycle(0) {
+  for (auto const &step : _steps) {
+    _cycle += step.second;
+  }
+}
+
+double StepLoadProfile::level(std::chrono::nanoseconds time) const {
+  if (_cycle.count() == 0) {
+    return _steps.back().first;
+  }
+
+  auto offset = time % _cycle;
+
+  for (auto const &step : _steps) {
+    if (offset < step.second) {
+      return step.first;
+    }
+    offset -= step.second;
+  }
+
+  return _steps.back().first;
+}
+
+std::unique_ptr<TraceLoadProfile>
+TraceLoadProfile::fromFile(std::string const &path) {
+  std::ifstream file(path);
+
+  if (!file.is_open()) {
+    throw std::invalid_argument("Load profile: could not open trace \"" +
+                                path + "\"");
+  }
+
+  std::vector<std::pair<std::chrono::nanoseconds, double>> samples;
+  std::string line;
+  unsigned lineNumber = 0;
+
+  while (std::getline(file, line)) {
+    lineNumber++;
+
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    auto values = split(line, ',');
+
+    // allow a header in the first line
+    if (lineNumber == 1 && !values.empty() && !values[0].empty() &&
+        !std::isdigit(values[0][0]) && values[0][0] != '.') {
+      continue;
+    }
+
+    if (values.size() != 2) {
+      throw std::invalid_argument("Load profile: line " +
+                                  std::to_string(lineNumber) + " of \"" +
+                                  path + "\" is not of the format SECS,LOAD");
+    }
+
+    auto time = parseSeconds(values[0]);
+
+    if (!samples.empty() && time < samples.back().first) {
+      throw std::invalid_argument("Load profile: the times in \"" + path +
+                                  "\" must be ascending");
+    }
+
+    samples.push_back(std::make_pair(time, parseLevel(values[1])));
+  }
+
+  if (samples.empty()) {
+    throw std::invalid_argument("Load profile: trace \"" + path +
+                                "\" is empty");
+  }
+
+  return std::make_unique<TraceLoadProfile>(samples);
+}
+
+double TraceLoadProfile::level(std::chrono::nanoseconds time) const {
+  // find the last sample at or before the time
+  auto it = std::upper_bound(
+      _samples.begin(), _samples.end(), time,
+      [](std::chrono::nanoseconds const &t,
+         std::pair<std::chrono::nanoseconds, double> const &sample) {
+        return t < sample.first;
+      });
+
+  if (it == _samples.begin()) {
+    return it->second;
+  }
+
+  return std::prev(it)->second;
+}
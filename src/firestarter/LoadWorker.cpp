@@ -35,34 +35,23 @@ extern "C" {
 #include <SCOREP_User.h>
 #endif
 
-#include <cmath>
+#include <algorithm>
 #include <cstdlib>
 #include <functional>
+#include <map>
+#include <random>
 #include <thread>
 
-#define PAD_SIZE(size, align)                                                  \
-  align *(int)std::ceil((double)size / (double)align)
-
-#if defined(__APPLE__)
-#define ALIGNED_MALLOC(size, align) aligned_alloc(align, PAD_SIZE(size, align))
-#define ALIGNED_FREE free
-#elif defined(__MINGW64__)
-#define ALIGNED_MALLOC(size, align) _mm_malloc(PAD_SIZE(size, align), align)
-#define ALIGNED_FREE _mm_free
-#elif defined(_MSC_VER)
-#define ALIGNED_MALLOC(size, align)                                            \
-  _aligned_malloc(PAD_SIZE(size, align), align)
-#define ALIGNED_FREE _aligned_free
-#else
-#define ALIGNED_MALLOC(size, align)                                            \
-  std::aligned_alloc(align, PAD_SIZE(size, align))
-#define ALIGNED_FREE std::free
-#endif
+// maximum number of load changes recorded per thread with --measure-load-skew
+#define LOAD_SKEW_MAX_RECORDS 8192
 
 using namespace firestarter;
 
 int Firestarter::initLoadWorkers(bool lowLoad, unsigned long long period,
                                  bool dumpRegisters) {
+  using Clock = std::chrono::high_resolution_clock;
+  auto start = Clock::now();
+
   int returnCode;
 
   if (EXIT_SUCCESS != (returnCode = this->environment().setCpuAffinity(0))) {
@@ -73,10 +62,107 @@ int Firestarter::initLoadWorkers(bool lowLoad, unsigned long long period,
   // work.
   this->loadVar = lowLoad ? LOAD_LOW : LOAD_HIGH;
 
+  this->controlPlane.setNumWorkers(this->environment().requestedNumThreads());
+
+  // select the load variable of each thread
+  std::vector<unsigned> loadVariableIndex;
+
+  if (_loadVariable == "thread") {
+    for (unsigned i = 0; i < this->environment().requestedNumThreads(); i++) {
+      loadVariableIndex.push_back(i);
+    }
+  } else if (_loadVariable == "numa" || _loadVariable == "package") {
+    bool numa = _loadVariable == "numa";
+    std::map<int, unsigned> domains;
+
+    for (unsigned i = 0; i < this->environment().requestedNumThreads(); i++) {
+      int domain = -1;
+      int cpu = this->environment().getCpuIdOfThread(i);
+
+      if (cpu != -1) {
+        domain = numa ? this->environment().topology().getNumaNodeIdFromPU(cpu)
+                      : this->environment().topology().getPkgIdFromPU(cpu);
+      }
+
+      if (domain == -1) {
+        std::string name = numa ? "NUMA node" : "package";
+        log::warn() << "Could not determine the " << name << " of thread " << i
+                    << ". It will share its load variable with all other "
+                       "threads of unknown "
+                    << name << ".";
+      }
+
+      auto index = domains.emplace(domain, domains.size()).first->second;
+      loadVariableIndex.push_back(index);
+    }
+  }
+
+  if (!loadVariableIndex.empty()) {
+    Firestarter::_loadVariables.resize(
+        *std::max_element(loadVariableIndex.begin(), loadVariableIndex.end()) +
+        1);
+    for (auto &loadVariable : Firestarter::_loadVariables) {
+      loadVariable.value = this->loadVar;
+    }
+
+    log::debug() << "Using " << Firestarter::_loadVariables.size()
+                 << " load variables.";
+
+    // spread the start of the high load of every load variable over the
+    // period
+    if (!_stagger.empty()) {
+      std::mt19937 generator(std::random_device{}());
+      std::uniform_real_distribution<double> distribution(0.0, 1.0);
+      auto size = Firestarter::_loadVariables.size();
+
+      for (std::size_t i = 0; i < size; i++) {
+        auto &phase = Firestarter::_loadVariables[i].phase;
+
+        if (_stagger == "even") {
+          phase = (double)i / (double)size;
+        } else {
+          phase = distribution(generator);
+        }
+
+        log::debug() << "Load variable " << i << " starts its high load at "
+                     << 100.0 * phase << " % of the period.";
+      }
+    }
+  }
+
   for (unsigned long long i = 0; i < this->environment().requestedNumThreads();
        i++) {
+    volatile unsigned long long *loadVar =
+        loadVariableIndex.empty()
+            ? &this->loadVar
+            : &Firestarter::_loadVariables[loadVariableIndex[i]].value;
+
     auto td = std::make_shared<LoadWorkerData>(
-        i, this->environment(), &this->loadVar, period, dumpRegisters);
+        i, this->environment(), this->controlPlane, loadVar, period,
+        dumpRegisters);
+
+    auto threadGroup = this->environment().getThreadGroupOfThread(i);
+    if (threadGroup != -1) {
+      td->config().setPayloadSettings(
+          this->environment().threadGroups()[threadGroup].payloadSettings);
+    }
+
+    if (_measureLoadSkew) {
+      td->loadChanges.reserve(LOAD_SKEW_MAX_RECORDS);
+    }
+
+    if (_hugePages == "thp") {
+      td->hugePages = LoadWorkerMemory::HugePages::Transparent;
+    } else if (_hugePages == "off") {
+      td->hugePages = LoadWorkerMemory::HugePages::Off;
+    }
+
+    if (_payloadPerPackage) {
+      int cpu = this->environment().getCpuIdOfThread(i);
+      if (cpu != -1) {
+        td->payloadReplica = this->environment().topology().getPkgIdFromPU(cpu);
+      }
+    }
 
     auto dataCacheSizeIt =
         td->config().platformConfig().dataCacheBufferSize().begin();
@@ -100,41 +186,85 @@ int Firestarter::initLoadWorkers(bool lowLoad, unsigned long long period,
     this->loadThreads.push_back(std::make_pair(std::move(t), td));
   }
 
+  if (EXIT_SUCCESS != (returnCode = this->compileLoadWorkerPayloads())) {
+    return returnCode;
+  }
+
   this->signalLoadWorkers(THREAD_INIT);
 
+  auto end = Clock::now();
+
+  log::debug() << "Starting the load threads took "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(end -
+                                                                        start)
+                      .count()
+               << "ms";
+
   return EXIT_SUCCESS;
 }
 
-void Firestarter::signalLoadWorkers(int comm) {
-  bool ack;
+int Firestarter::compileLoadWorkerPayloads() {
+  using Clock = std::chrono::high_resolution_clock;
+
+  // with one copy per package the first thread on each package compiles it to
+  // allocate the code on the local NUMA node.
+  if (_payloadPerPackage) {
+    return EXIT_SUCCESS;
+  }
+
+  auto start = Clock::now();
+
+  // show the output of the compilation as if it was done in the first thread
+  firestarter::logging::FirstWorkerThreadFilter<
+      firestarter::logging::record>::setFirstThread(std::this_thread::get_id());
+
+  // the payload is compiled once and placed in the cache. the threads take it
+  // from there, as they may still execute the old one.
+  int returnCode = EXIT_SUCCESS;
+
+  this->compiledPayloads.clear();
 
-  // start the work
   for (auto const &thread : this->loadThreads) {
     auto td = thread.second;
 
-    td->mutex.lock();
+    auto payload =
+        td->config().compiledPayload(td->dumpRegisters, td->payloadReplica);
+
+    if (payload == nullptr) {
+      log::error() << "Could not compile payload";
+      returnCode = EXIT_FAILURE;
+      break;
+    }
+
+    // keep the payload in the cache until the threads have picked it up
+    if (std::find(this->compiledPayloads.begin(), this->compiledPayloads.end(),
+                  payload) == this->compiledPayloads.end()) {
+      this->compiledPayloads.push_back(payload);
+    }
   }
 
-  for (auto const &thread : this->loadThreads) {
-    auto td = thread.second;
+  firestarter::logging::FirstWorkerThreadFilter<
+      firestarter::logging::record>::setFirstThread(this->loadThreads.front()
+                                                        .first.get_id());
 
-    td->comm = comm;
-    td->mutex.unlock();
+  if (returnCode != EXIT_SUCCESS) {
+    return returnCode;
   }
 
-  for (auto const &thread : this->loadThreads) {
-    auto td = thread.second;
+  auto end = Clock::now();
 
-    do {
-      td->mutex.lock();
-      ack = td->ack;
-      td->mutex.unlock();
-    } while (!ack);
+  log::debug() << "Compiling the payload took "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(end -
+                                                                        start)
+                      .count()
+               << "ms";
 
-    td->mutex.lock();
-    td->ack = false;
-    td->mutex.unlock();
-  }
+  return EXIT_SUCCESS;
+}
+
+void Firestarter::signalLoadWorkers(int comm) {
+  // broadcast the command and wait until every thread has seen it
+  this->controlPlane.signal(comm);
 }
 
 void Firestarter::joinLoadWorkers() {
@@ -150,6 +280,9 @@ void Firestarter::printPerformanceReport() {
   unsigned long long stopTimestamp = 0;
 
   unsigned long long iterations = 0;
+  // the threads may run different payloads
+  double flops = 0;
+  double bytes = 0;
 
   log::debug() << "\nperformance report:\n";
 
@@ -167,16 +300,14 @@ void Firestarter::printPerformanceReport() {
     }
 
     iterations += td->iterations;
+    flops += (double)td->config().payload().flops() * (double)td->iterations;
+    bytes += (double)td->config().payload().bytes() * (double)td->iterations;
   }
 
   double runtime = (double)(stopTimestamp - startTimestamp) /
                    (double)this->environment().topology().clockrate();
-  double gFlops =
-      (double)this->loadThreads.front().second->config().payload().flops() *
-      0.000000001 * (double)iterations / runtime;
-  double bandwidth =
-      (double)this->loadThreads.front().second->config().payload().bytes() *
-      0.000000001 * (double)iterations / runtime;
+  double gFlops = flops * 0.000000001 / runtime;
+  double bandwidth = bytes * 0.000000001 / runtime;
 
   // insert values for ipc-estimate metric
   // if we are on linux
@@ -184,12 +315,10 @@ void Firestarter::printPerformanceReport() {
   if (_measurement) {
     for (auto const &thread : this->loadThreads) {
       auto td = thread.second;
-      ipc_estimate_metric_insert((double)td->iterations *
-                                 (double)this->loadThreads.front()
-                                     .second->config()
-                                     .payload()
-                                     .instructions() /
-                                 (double)(stopTimestamp - startTimestamp));
+      ipc_estimate_metric_insert(
+          (double)td->iterations *
+          (double)td->config().payload().instructions() /
+          (double)(stopTimestamp - startTimestamp));
     }
   }
 #endif
@@ -227,9 +356,101 @@ void Firestarter::printPerformanceReport() {
       << "  executed on an unsupported architecture!";
 }
 
-void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
+void Firestarter::printMemorySummary() {
+  // count the threads per page type and binding
+  std::map<std::pair<LoadWorkerMemory::PageType, bool>, unsigned> summary;
+
+  for (auto const &thread : this->loadThreads) {
+    auto td = thread.second;
+
+    if (td->memory != nullptr) {
+      summary[std::make_pair(td->memory->pageType(), td->memory->bound())]++;
+    }
+  }
+
+  log::info() << "\n  memory of the load threads:";
+
+  for (auto const &[key, count] : summary) {
+    log::info() << "    - " << count << " thread(s) using "
+                << LoadWorkerMemory::pageTypeName(key.first) << ", "
+                << (key.second ? "bound to the local NUMA node"
+                               : "not bound to a NUMA node");
+  }
+}
+
+void Firestarter::printLoadSkewReport() {
+  // collect the timestamps of every load change over all threads
+  std::map<unsigned long long,
+           std::pair<unsigned long long, unsigned long long>>
+      changes;
+  std::map<unsigned long long, unsigned> numThreads;
+
+  for (auto const &thread : this->loadThreads) {
+    auto td = thread.second;
+
+    for (auto const &[count, timestamp] : td->loadChanges) {
+      auto it = changes.find(count);
+      if (it == changes.end()) {
+        changes[count] = std::make_pair(timestamp, timestamp);
+      } else {
+        it->second.first = std::min(it->second.first, timestamp);
+        it->second.second = std::max(it->second.second, timestamp);
+      }
+      numThreads[count]++;
+    }
+  }
+
+  // only consider load changes seen by every thread
+  std::vector<double> skews;
+  double clockrate = (double)this->environment().topology().clockrate();
+
+  for (auto const &[count, minMax] : changes) {
+    if (numThreads[count] != this->loadThreads.size()) {
+      continue;
+    }
+    skews.push_back((double)(minMax.second - minMax.first) / clockrate * 1e6);
+  }
+
+  if (skews.empty()) {
+    log::info() << "\nload skew: no load changes were recorded by all threads.";
+    return;
+  }
+
+  std::sort(skews.begin(), skews.end());
+
+  double sum = 0;
+  for (auto const &skew : skews) {
+    sum += skew;
+  }
+
+  log::info() << "\nload skew between threads over " << skews.size()
+              << " load changes:\n"
+              << "  min:    " << skews.front() << " usec\n"
+              << "  median: " << skews[skews.size() / 2] << " usec\n"
+              << "  avg:    " << sum / skews.size() << " usec\n"
+              << "  max:    " << skews.back() << " usec\n"
+              << "  The skew includes the time for a thread to finish the "
+                 "current loop iteration\n"
+              << "  of the high load function.";
+}
+
+void Firestarter::recordLoadChange(LoadWorkerData &td) {
+  // do not allocate memory in the load loop
+  if (td.loadChanges.size() == td.loadChanges.capacity()) {
+    return;
+  }
+
+  auto count = Firestarter::_loadChangeCount.load(std::memory_order_relaxed);
+
+  // the low load function returns immediately if the load did not change
+  if (!td.loadChanges.empty() && td.loadChanges.back().first == count) {
+    return;
+  }
 
-  int old = THREAD_WAIT;
+  td.loadChanges.emplace_back(count, td.environment().topology().timestamp());
+}
+
+void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
 
   // use REGISTER_MAX_NUM cache lines for the dumped registers
   // and another cache line for the control variable.
@@ -245,20 +466,8 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
 #endif
 
   for (;;) {
-    td->mutex.lock();
-    int comm = td->comm;
-    td->mutex.unlock();
-
-    if (comm != old) {
-      old = comm;
-
-      td->mutex.lock();
-      td->ack = true;
-      td->mutex.unlock();
-    } else {
-      std::this_thread::sleep_for(std::chrono::microseconds(1));
-      continue;
-    }
+    // sleep until the next command is posted
+    int comm = td->controlPlane().receive(td->epoch);
 
     switch (comm) {
     // allocate and initialize memory
@@ -266,27 +475,31 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
       // set affinity
       td->environment().setCpuAffinity(td->id());
 
-      // compile payload
-      td->config().payload().compilePayload(
-          td->config().payloadSettings(), td->config().instructionCacheSize(),
-          td->config().dataCacheBufferSize(), td->config().ramBufferSize(),
-          td->config().thread(), td->config().lines(), td->dumpRegisters);
+      // compile payload or get it from the cache
+      if (EXIT_SUCCESS !=
+          td->config().compilePayload(td->dumpRegisters, td->payloadReplica)) {
+        workerLog::error() << "Could not compile payload for CPU load thread";
+        exit(EXIT_FAILURE);
+      }
 
       // allocate memory
       // if we should dump some registers, we use the first part of the memory
       // for them.
-      td->addrMem =
-          reinterpret_cast<unsigned long long *>(ALIGNED_MALLOC(
-              (td->buffersizeMem + addrOffset) * sizeof(unsigned long long),
-              64)) +
-          addrOffset;
+      td->memory = LoadWorkerMemory::allocate(
+          (td->buffersizeMem + addrOffset) * sizeof(unsigned long long),
+          td->hugePages, td->environment().topology(),
+          td->environment().getCpuIdOfThread(td->id()));
 
       // exit application on error
-      if (td->addrMem - addrOffset == nullptr) {
+      if (td->memory == nullptr) {
         workerLog::error() << "Could not allocate memory for CPU load thread";
         exit(ENOMEM);
       }
 
+      td->addrMem =
+          reinterpret_cast<unsigned long long *>(td->memory->data()) +
+          addrOffset;
+
       if (td->dumpRegisters) {
         reinterpret_cast<DumpRegisterStruct *>(td->addrMem - addrOffset)
             ->dumpVar = DumpVariable::Wait;
@@ -294,6 +507,7 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
 
       // call init function
       td->config().payload().init(td->addrMem, td->buffersizeMem);
+      td->bufferPayload = td->config().payload().name();
       break;
     // perform stress test
     case THREAD_WORK:
@@ -310,8 +524,16 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
         SCOREP_USER_REGION_BY_NAME_BEGIN("HIGH",
                                          SCOREP_USER_REGION_TYPE_COMMON);
 #endif
+        auto iterations = td->iterations;
         td->iterations = td->config().payload().highLoadFunction(
             td->addrMem, td->addrHigh, td->iterations);
+        // only this thread writes the total
+        td->totalIterations.store(
+            td->totalIterations.load(std::memory_order_relaxed) +
+                td->iterations - iterations,
+            std::memory_order_relaxed);
+
+        recordLoadChange(*td);
 
         // call low load function
 #ifdef ENABLE_VTRACING
@@ -323,6 +545,8 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
         SCOREP_USER_REGION_BY_NAME_BEGIN("LOW", SCOREP_USER_REGION_TYPE_COMMON);
 #endif
         td->config().payload().lowLoadFunction(td->addrHigh, td->period);
+
+        recordLoadChange(*td);
 #ifdef ENABLE_VTRACING
         VT_USER_END("LOW_LOAD_FUNC");
 #endif
@@ -334,7 +558,7 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
         if (*td->addrHigh == LOAD_STOP) {
           td->stopTsc = td->environment().topology().timestamp();
 
-          ALIGNED_FREE(td->addrMem - addrOffset);
+          td->memory.reset();
           return;
         }
 
@@ -346,14 +570,21 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
       }
       break;
     case THREAD_SWITCH:
-      // compile payload
-      td->config().payload().compilePayload(
-          td->config().payloadSettings(), td->config().instructionCacheSize(),
-          td->config().dataCacheBufferSize(), td->config().ramBufferSize(),
-          td->config().thread(), td->config().lines(), td->dumpRegisters);
+      // compile payload or get it from the cache
+      if (EXIT_SUCCESS !=
+          td->config().compilePayload(td->dumpRegisters, td->payloadReplica)) {
+        workerLog::error() << "Could not compile payload for CPU load thread";
+        exit(EXIT_FAILURE);
+      }
 
-      // call init function
-      td->config().payload().init(td->addrMem, td->buffersizeMem);
+      // the buffer only has to be initialized completely if it was used by a
+      // different payload. otherwise reset the values seeding the registers.
+      if (td->bufferPayload == td->config().payload().name()) {
+        td->config().payload().reinit(td->addrMem, td->buffersizeMem);
+      } else {
+        td->config().payload().init(td->addrMem, td->buffersizeMem);
+        td->bufferPayload = td->config().payload().name();
+      }
 
       // save old iteration count
       td->lastIterations = td->iterations;
@@ -365,7 +596,7 @@ void Firestarter::loadThreadWorker(std::shared_ptr<LoadWorkerData> td) {
       break;
     case THREAD_STOP:
     default:
-      ALIGNED_FREE(td->addrMem - addrOffset);
+      td->memory.reset();
       return;
     }
   }
@@ -0,0 +1,208 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/LoadWorkerMemory.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(linux) || defined(__linux__)
+extern "C" {
+#include <sys/mman.h>
+}
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+#define ROUND_UP(size, align) (((size) + (align)-1) / (align) * (align))
+
+using namespace firestarter;
+
+#if defined(linux) || defined(__linux__)
+namespace {
+// check if the NUMA node of cpu has count free hugepages of pageSize
+bool freeHugePages(environment::CPUTopology const &topology, int cpu,
+                   std::size_t pageSize, std::size_t count) {
+  auto node = topology.getNumaNodeOsIdFromPU(cpu);
+  if (node < 0) {
+    return false;
+  }
+
+  std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/hugepages/hugepages-" +
+                     std::to_string(pageSize / 1024) + "kB/free_hugepages");
+  std::size_t free = 0;
+  if (!(file >> free)) {
+    return false;
+  }
+
+  return free >= count;
+}
+} // namespace
+#endif
+
+LoadWorkerMemory::~LoadWorkerMemory() {
+#if defined(linux) || defined(__linux__)
+  if (_mapped) {
+    munmap(_data, _size);
+    return;
+  }
+#endif
+  _topology.freeMemory(_data, _size);
+}
+
+std::unique_ptr<LoadWorkerMemory>
+LoadWorkerMemory::allocate(std::size_t size, HugePages hugePages,
+                           environment::CPUTopology const &topology, int cpu) {
+#if defined(linux) || defined(__linux__)
+  // try the page types from the largest to the smallest. the memory is bound
+  // before it is touched, so every page will be allocated on the right node.
+  struct Mapping {
+    PageType pageType;
+    std::size_t pageSize;
+    int flags;
+  };
+
+  std::vector<Mapping> mappings;
+
+  if (hugePages == HugePages::Auto) {
+    // do not waste more than half of a 1 GiB page
+    if (size >= (1ull << 30) / 2) {
+      mappings.push_back({PageType::Huge1G, 1ull << 30,
+                          MAP_HUGETLB | MAP_HUGE_1GB});
+    }
+    mappings.push_back({PageType::Huge2M, 1ull << 21,
+                        MAP_HUGETLB | MAP_HUGE_2MB});
+  }
+  if (hugePages != HugePages::Off) {
+    mappings.push_back({PageType::TransparentHuge, 1ull << 21, 0});
+  }
+  mappings.push_back({PageType::Normal, 1ull << 12, 0});
+
+  for (auto const &mapping : mappings) {
+    std::size_t mappedSize = ROUND_UP(size, mapping.pageSize);
+    bool transparent = mapping.pageType == PageType::TransparentHuge;
+
+    // transparent hugepages are only used for aligned 2 MiB regions, so map
+    // one page more and cut the mapping to an aligned start
+    std::size_t reservedSize =
+        transparent ? mappedSize + mapping.pageSize : mappedSize;
+
+    void *reserved = mmap(nullptr, reservedSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | mapping.flags, -1, 0);
+
+    if (reserved == MAP_FAILED) {
+      continue;
+    }
+
+    void *data = reserved;
+
+    if (transparent) {
+      auto start = reinterpret_cast<std::uintptr_t>(reserved);
+      auto aligned = ROUND_UP(start, mapping.pageSize);
+      auto end = start + reservedSize;
+
+      if (aligned != start) {
+        munmap(reserved, aligned - start);
+      }
+      if (end != aligned + mappedSize) {
+        munmap(reinterpret_cast<void *>(aligned + mappedSize),
+               end - aligned - mappedSize);
+      }
+
+      data = reinterpret_cast<void *>(aligned);
+
+      if (0 != madvise(data, mappedSize, MADV_HUGEPAGE)) {
+        munmap(data, mappedSize);
+        continue;
+      }
+    }
+
+    bool bound = cpu != -1 && EXIT_SUCCESS == topology.bindMemoryToPU(
+                                                  data, mappedSize, cpu);
+
+    // explicit hugepages are taken from the pool of the bound node when they
+    // are touched. if it is empty, the access would result in a SIGBUS.
+    // populate them now to detect this and fall back to smaller pages.
+    if (mapping.flags & MAP_HUGETLB) {
+      bool populated = 0 == madvise(data, mappedSize, MADV_POPULATE_WRITE);
+
+      // kernels before 5.14 do not know MADV_POPULATE_WRITE. check the free
+      // pages of the node instead.
+      if (!populated && errno == EINVAL) {
+        populated = !bound || freeHugePages(topology, cpu, mapping.pageSize,
+                                            mappedSize / mapping.pageSize);
+      }
+
+      if (!populated) {
+        munmap(data, mappedSize);
+        continue;
+      }
+    }
+
+    return std::unique_ptr<LoadWorkerMemory>(new LoadWorkerMemory(
+        data, mappedSize, mapping.pageType, bound, true, topology));
+  }
+
+  return nullptr;
+#else
+  (void)hugePages;
+
+  void *data = topology.allocateMemoryOnPU(size, cpu);
+
+  if (data == nullptr) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<LoadWorkerMemory>(new LoadWorkerMemory(
+      data, size, PageType::Normal, cpu != -1, false, topology));
+#endif
+}
+
+std::string LoadWorkerMemory::pageTypeName(PageType pageType) {
+  switch (pageType) {
+  case PageType::Huge1G:
+    return "1 GiB hugepages";
+  case PageType::Huge2M:
+    return "2 MiB hugepages";
+  case PageType::TransparentHuge:
+    return "transparent hugepages (if granted by the kernel)";
+  case PageType::Normal:
+  default:
+    return "normal pages";
+  }
+}
@@ -21,6 +21,9 @@
 
 #include <firestarter/Firestarter.hpp>
 #include <firestarter/Logging/Log.hpp>
+#if defined(linux) || defined(__linux__)
+#include <firestarter/Optimizer/History.hpp>
+#endif
 
 #include <cxxopts.hpp>
 
@@ -36,6 +39,7 @@ struct Config {
 #endif
 #if defined(linux) || defined(__linux__)
                     {"measurement", "Measurement:\n"},
+                    {"control", "Load control:\n"},
                     {"optimization", "Optimization:\n"}
 #endif
   };
@@ -44,18 +48,28 @@ struct Config {
   std::chrono::seconds timeout;
   unsigned loadPercent;
   std::chrono::microseconds period;
+  bool precisePeriod = false;
+  std::chrono::microseconds spinTime;
+  bool realtimeWatchdog = false;
+  std::string loadProfile;
   unsigned requestedNumThreads;
   std::string cpuBind = "";
+  std::string loadVariable;
+  std::string stagger;
+  bool payloadPerPackage = false;
+  std::string hugePages;
   bool printFunctionSummary;
   unsigned functionId;
   bool listInstructionGroups;
   std::string instructionGroups;
+  std::string cpuInstructionGroups;
   unsigned lineCount = 0;
   // debug features
   bool allowUnavailablePayload = false;
   bool dumpRegisters = false;
   std::chrono::seconds dumpRegistersTimeDelta = std::chrono::seconds(0);
   std::string dumpRegistersOutpath = "";
+  bool measureLoadSkew = false;
   // CUDA parameters
   int gpus = 0;
   unsigned gpuMatrixSize = 0;
@@ -68,9 +82,25 @@ struct Config {
   std::chrono::milliseconds stopDelta = std::chrono::milliseconds(0);
   std::chrono::milliseconds measurementInterval = std::chrono::milliseconds(0);
   std::vector<std::string> stdinMetrics;
+  unsigned long long measurementBufferSize;
+  std::string measurementSpillPath;
+  std::string perfEvents;
+  unsigned msrRaplInterval = 0;
+  std::string streamDestination;
+  std::string streamFormat;
+  std::string exporterAddress;
   // linux and dynamic linked binary
   std::vector<std::string> metricPaths;
 
+  // load control
+  std::string controlMetric;
+  double controlTarget = 0;
+  std::chrono::milliseconds controlInterval = std::chrono::milliseconds(0);
+  double controlKp = 0;
+  double controlKi = 0;
+  double controlKd = 0;
+  double controlMaxRate = 0;
+
   // optimization
   bool optimize = false;
   std::chrono::seconds preheat;
@@ -79,9 +109,15 @@ struct Config {
   std::chrono::seconds evaluationDuration;
   unsigned individuals;
   std::string optimizeOutfile = "";
+  std::string optimizeTrace = "";
+  std::string optimizeCheckpoint = "";
+  bool resume = false;
+  std::vector<std::string> optimizeWarmStart;
+  std::string convertTrace = "";
   unsigned generations;
   double nsga2_cr;
   double nsga2_m;
+  unsigned surrogateEvaluations;
 
   Config(int argc, const char **argv);
 };
@@ -156,6 +192,9 @@ void print_help(cxxopts::Options const &parser, std::string const &section) {
     << "                                starts FIRESTARTER optimizing with the sysfs-powercap-rapl\n"
     << "                                and perf-ipc metric. The duration is 20s long. The default\n"
     << "                                instruction groups for the current platform will be used.\n"
+    << "  ./FIRESTARTER --control-target 80 --control-metric sysfs-thermal\n"
+    << "                                starts FIRESTARTER adjusting the load to keep\n"
+    << "                                the hottest CPU temperature sensor at 80 C\n"
 #endif
     ;
   // clang-format on
@@ -167,7 +206,7 @@ Config::Config(int argc, const char **argv) {
 
   // clang-format off
   parser.add_options("information")
-    ("h,help", "Display usage information. SECTION can be any of: information | general | specialized-workloads | debug\n| measurement | optimization",
+    ("h,help", "Display usage information. SECTION can be any of: information | general | specialized-workloads | debug\n| measurement | control | optimization",
       cxxopts::value<std::string>()->implicit_value(""), "SECTION")
     ("v,version", "Display version information")
     ("c,copyright", "Display copyright information")
@@ -197,18 +236,34 @@ Config::Config(int argc, const char **argv) {
      , cxxopts::value<unsigned>()->default_value("100"), "LOAD")
     ("p,period", "Set the interval length for CPUs to PERIOD\n(usec), default: 100000, each interval contains\na high load and an idle phase, the percentage\nof high load is defined by -l.",
       cxxopts::value<unsigned>()->default_value("100000"), "PERIOD")
+    ("precise-period", "Keep the load changes of -p | --period on time\nby sleeping until shortly before each change and\nbusy-waiting on the TSC for the rest. Use it for\nperiods down to tens of usec. SPIN is the time\nspent busy-waiting (usec), default: 100. Reports\nthe achieved duty cycle at the end.",
+      cxxopts::value<unsigned>()->implicit_value("100"), "SPIN")
+    ("load-profile", "Change the load level in every period of -p |\n--period instead of using a fixed -l | --load.\nPROFILE can be any of: ramp:FROM:TO:SECS (linear\nfrom FROM to TO % within SECS seconds),\nsine:MEAN:AMPLITUDE:HZ (in %), steps:LOAD:SECS,\nLOAD:SECS,... (staircase, repeated), trace:FILE\n(CSV file with SECS,LOAD lines). The achieved\nload level is available as metric load-level.",
+      cxxopts::value<std::string>()->default_value(""), "PROFILE")
+#if defined(linux) || defined(__linux__)
+    ("realtime-watchdog", "Run the thread that changes the load level with\nthe SCHED_FIFO real-time policy. Requires\nCAP_SYS_NICE.")
+#endif
     ("n,threads", "Specify the number of threads. Cannot be\ncombined with -b | --bind, which impicitly\nspecifies the number of threads.",
       cxxopts::value<unsigned>()->default_value("0"), "COUNT")
 #if (defined(linux) || defined(__linux__)) && defined(FIRESTARTER_THREAD_AFFINITY)
     ("b,bind", "Select certain CPUs. CPULIST format: \"x,y,z\",\n\"x-y\", \"x-y/step\", and any combination of the\nabove. Cannot be combined with -n | --threads.",
       cxxopts::value<std::string>()->default_value(""), "CPULIST")
 #endif
+    ("load-variable", "Select which threads share a variable signaling\nthe load level. MODE can be any of: shared (all\nthreads), thread (one per thread), numa (one per\nNUMA node), package (one per package), default:\nshared",
+      cxxopts::value<std::string>()->default_value("shared"), "MODE")
+    ("stagger", "Shift the high load phases of the load variables\nagainst each other within the period to smooth\nthe load steps. MODE can be any of: even (evenly\nspread), random. Uses one load variable per\nthread unless --load-variable is given, e.g.\n--load-variable package staggers the packages.",
+      cxxopts::value<std::string>(), "MODE")
+    ("payload-per-package", "Compile a separate copy of the payload on every\npackage instead of sharing one copy between all\nthreads. The copy is placed on the NUMA node of\nthe first thread of the package.")
+    ("hugepages", "Select the pages backing the memory of the load\nthreads. MODE can be any of: auto (explicit 1 GiB\nor 2 MiB hugepages, then transparent hugepages,\nthen normal pages), thp (transparent hugepages,\nthen normal pages), off (normal pages), default:\nauto. The memory is bound to the NUMA node of\neach thread.",
+      cxxopts::value<std::string>()->default_value("auto"), "MODE")
     ;
 
   parser.add_options("specialized-workloads")
     ("list-instruction-groups", "List the available instruction groups for the\npayload of the current platform.")
     ("run-instruction-groups", "Run the payload with the specified\ninstruction groups. GROUPS format: multiple INST:VAL\npairs comma-seperated.",
       cxxopts::value<std::string>()->default_value(""), "GROUPS")
+    ("run-instruction-groups-on-cpus", "Run the payload with different instruction\ngroups on the given CPUs. CPUGROUPS format:\nmultiple CPULIST=GROUPS pairs semicolon-seperated,\ne.g. \"0-3=RAM_L:1;4-7=REG:4,L1_L:1\". CPULIST has\nthe format of -b | --bind and selects thread\nnumbers if the threads are not bound. Threads on\nother CPUs run the default instruction groups or\nthe ones of --run-instruction-groups.",
+      cxxopts::value<std::string>()->default_value(""), "CPUGROUPS")
     ("set-line-count", "Set the number of lines for a payload.",
       cxxopts::value<unsigned>());
 
@@ -218,7 +273,8 @@ Config::Config(int argc, const char **argv) {
     ("dump-registers", "Dump the working registers on the first\nthread. Depending on the payload these are mm, xmm,\nymm or zmm. Only use it without a timeout and\n100 percent load. DELAY between dumps in secs.",
       cxxopts::value<unsigned>()->implicit_value("10"), "DELAY")
     ("dump-registers-outpath", "Path for the dump of the output files. If\nPATH is not given, current working directory will\nbe used.",
-      cxxopts::value<std::string>()->default_value(""), "PATH");
+      cxxopts::value<std::string>()->default_value(""), "PATH")
+    ("measure-load-skew", "Record the timestamps at which every thread\nobserves a change of the load level and report\nhow far apart they are at the end of the run.");
 #endif
 
 #if defined(linux) || defined(__linux__)
@@ -233,6 +289,20 @@ Config::Config(int argc, const char **argv) {
     ("measurement", "Start a measurement for the time specified by\n-t | --timeout. (The timeout must be greater\nthan the start and stop deltas.) Cannot be\ncombined with --optimize.")
     ("measurement-interval", "Interval of measurements in milliseconds, default: 100",
       cxxopts::value<unsigned>()->default_value("100"))
+    ("measurement-buffer", "Number of values kept in memory for every metric.\nThe oldest values are overwritten unless\n--measurement-spill is given, default: 1048576",
+      cxxopts::value<unsigned long long>()->default_value("1048576"), "N")
+    ("measurement-spill", "Move old values to files in the directory DIR\ninstead of overwriting them.",
+      cxxopts::value<std::string>()->default_value(""), "DIR")
+    ("perf-events", "Count EVENTS of FIRESTARTER with the perf-events\nmetric. EVENTS is a comma separated list of\ncache-references, cache-misses,\nbranch-instructions, branch-misses, bus-cycles,\nstalled-cycles-frontend, stalled-cycles-backend,\nref-cycles or NAME=rCODE with a raw event CODE\nin hex, e.g. fp-ops=r01c7.",
+      cxxopts::value<std::string>()->default_value(""), "EVENTS")
+    ("msr-rapl-interval", "Enable the msr-rapl metric and sample the RAPL\nMSRs every USEC microseconds, e.g. 100. The\nenergy of every AMD core is sampled at most\nevery 10 ms.",
+      cxxopts::value<unsigned>(), "USEC")
+    ("stream", "Write all measured values and events like load\nchanges and payload switches to DEST while\nrunning. DEST is a file, a named pipe or\nunix:PATH for a Unix socket.",
+      cxxopts::value<std::string>()->default_value(""), "DEST")
+    ("stream-format", "Format of --stream: csv, jsonl or binary,\ndefault: csv",
+      cxxopts::value<std::string>()->default_value("csv"), "FORMAT")
+    ("exporter", "Serve the current metric values, iteration rates,\npayload settings and load state in the\nOpenMetrics format via HTTP on ADDRESS, which is\n[HOST:]PORT (HOST defaults to 127.0.0.1) or\nunix:PATH for a Unix socket.",
+      cxxopts::value<std::string>()->default_value(""), "ADDRESS")
     ("start-delta", "Cut of first N milliseconds of measurement, default: 5000",
       cxxopts::value<unsigned>()->default_value("5000"), "N")
     ("stop-delta", "Cut of last N milliseconds of measurement, default: 2000",
@@ -240,11 +310,32 @@ Config::Config(int argc, const char **argv) {
     ("preheat", "Preheat for N seconds, default: 240",
       cxxopts::value<unsigned>()->default_value("240"), "N");
 
+  parser.add_options("control")
+    ("control-target", "Adjust the load level continuously to keep the\nmetric of --control-metric at VALUE, e.g. a\npackage power in W or a temperature in C. Uses\n-p | --period. Cannot be combined with -l |\n--load, --load-profile or --optimize.",
+      cxxopts::value<double>(), "VALUE")
+    ("control-metric", "Metric to control, default: sysfs-powercap-rapl",
+      cxxopts::value<std::string>()->default_value("sysfs-powercap-rapl"), "METRIC")
+    ("control-interval", "Interval of the controller in milliseconds. It\nshould contain multiple measurements of\n--measurement-interval, default: 500",
+      cxxopts::value<unsigned>()->default_value("500"), "N")
+    ("control-pid", "Gains of the PID controller applied to the error\nrelative to VALUE, default: 0.5,1,0",
+      cxxopts::value<std::vector<double>>()->default_value("0.5,1,0"), "KP,KI,KD")
+    ("control-max-rate", "Maximal change of the load level in percent per\nsecond, default: 50",
+      cxxopts::value<double>()->default_value("50"), "RATE");
+
   parser.add_options("optimization")
-    ("optimize", "Run the optimization with one of these algorithms: NSGA2.\nCannot be combined with --measurement.",
+    ("optimize", "Run the optimization with one of these algorithms: NSGA2,\nNSGA2-GP. Cannot be combined with --measurement.",
       cxxopts::value<std::string>())
     ("optimize-outfile", "Dump the output of the optimization into this\nfile, default: $PWD/$HOSTNAME_$DATE.json",
       cxxopts::value<std::string>())
+    ("optimize-trace", "Write the optimization and the measured values of\nevery evaluation incrementally to FILE in a\nbinary trace format instead of the json file.",
+      cxxopts::value<std::string>(), "FILE")
+    ("optimize-checkpoint", "Save the state of the optimization to FILE after\nevery evaluation.",
+      cxxopts::value<std::string>(), "FILE")
+    ("resume", "Resume the optimization from the file given with\n--optimize-checkpoint. Individuals that were\nalready evaluated are not measured again.")
+    ("optimize-warm-start", "Reuse the evaluations of previous optimizations\non identical hardware from their output files\ninstead of measuring the individuals again.",
+      cxxopts::value<std::vector<std::string>>(), "FILE,...")
+    ("convert-trace", "Convert the binary trace FILE to the json format\nof --optimize-outfile and exit. The output is\nwritten to --optimize-outfile, default: FILE.json",
+      cxxopts::value<std::string>(), "FILE")
     ("optimization-metric", "Use a metric for optimization. Metrics listed\nwith cli argument --list-metrics or specified\nwith --metric-from-stdin are valid.",
       cxxopts::value<std::vector<std::string>>())
     ("individuals", "Number of individuals for the population. For\nNSGA2 specify at least 5 and a multiple of 4,\ndefault: 20",
@@ -254,7 +345,9 @@ Config::Config(int argc, const char **argv) {
     ("nsga2-cr", "Crossover probability. Must be in range [0,1[\ndefault: 0.6",
       cxxopts::value<double>()->default_value("0.6"))
     ("nsga2-m", "Mutation probability. Must be in range [0,1]\ndefault: 0.4",
-      cxxopts::value<double>()->default_value("0.4"));
+      cxxopts::value<double>()->default_value("0.4"))
+    ("surrogate-evaluations", "Number of individuals measured per generation\nby NSGA2-GP, default: a quarter of --individuals",
+      cxxopts::value<unsigned>(), "N");
 #endif
   // clang-format on
 
@@ -317,6 +410,19 @@ Config::Config(int argc, const char **argv) {
     timeout = std::chrono::seconds(options["timeout"].as<unsigned>());
     loadPercent = options["load"].as<unsigned>();
     period = std::chrono::microseconds(options["period"].as<unsigned>());
+    precisePeriod = options.count("precise-period");
+    if (precisePeriod) {
+      spinTime =
+          std::chrono::microseconds(options["precise-period"].as<unsigned>());
+    }
+#if defined(linux) || defined(__linux__)
+    realtimeWatchdog = options.count("realtime-watchdog");
+#endif
+    loadProfile = options["load-profile"].as<std::string>();
+    if (!loadProfile.empty() && options.count("load")) {
+      throw std::invalid_argument(
+          "Options -l | --load and --load-profile cannot be used together.");
+    }
 
     if (loadPercent > 100) {
       throw std::invalid_argument("Option -l/--load may not be above 100.");
@@ -333,6 +439,7 @@ Config::Config(int argc, const char **argv) {
       }
     }
     allowUnavailablePayload = options.count("allow-unavailable-payload");
+    measureLoadSkew = options.count("measure-load-skew");
 #endif
 
     requestedNumThreads = options["threads"].as<unsigned>();
@@ -348,6 +455,41 @@ Config::Config(int argc, const char **argv) {
     }
 #endif
 
+    loadVariable = options["load-variable"].as<std::string>();
+    if (loadVariable != "shared" && loadVariable != "thread" &&
+        loadVariable != "numa" && loadVariable != "package") {
+      throw std::invalid_argument("Option --load-variable must be any of: "
+                                  "shared, thread, numa, package");
+    }
+    if (options.count("stagger")) {
+      stagger = options["stagger"].as<std::string>();
+      if (stagger != "even" && stagger != "random") {
+        throw std::invalid_argument(
+            "Option --stagger must be any of: even, random");
+      }
+      if (!options.count("load-variable")) {
+        loadVariable = "thread";
+      } else if (loadVariable == "shared") {
+        throw std::invalid_argument(
+            "Option --stagger requires more than one load variable.");
+      }
+      if ((loadPercent == 0 || loadPercent == 100) && loadProfile.empty()) {
+        throw std::invalid_argument("Option --stagger requires -l | --load "
+                                    "between 0 and 100 or --load-profile.");
+      }
+      if (measureLoadSkew) {
+        throw std::invalid_argument(
+            "Options --stagger and --measure-load-skew cannot be used "
+            "together.");
+      }
+    }
+    payloadPerPackage = options.count("payload-per-package");
+    hugePages = options["hugepages"].as<std::string>();
+    if (hugePages != "auto" && hugePages != "thp" && hugePages != "off") {
+      throw std::invalid_argument(
+          "Option --hugepages must be any of: auto, thp, off");
+    }
+
 #ifdef FIRESTARTER_BUILD_CUDA
     gpuUseFloat = options.count("usegpufloat");
     gpuUseDouble = options.count("usegpudouble");
@@ -372,6 +514,8 @@ Config::Config(int argc, const char **argv) {
 
     listInstructionGroups = options.count("list-instruction-groups");
     instructionGroups = options["run-instruction-groups"].as<std::string>();
+    cpuInstructionGroups =
+        options["run-instruction-groups-on-cpus"].as<std::string>();
     if (options.count("set-line-count")) {
       lineCount = options["set-line-count"].as<unsigned>();
     }
@@ -391,6 +535,70 @@ Config::Config(int argc, const char **argv) {
     }
     measurement = options.count("measurement");
     listMetrics = options.count("list-metrics");
+    perfEvents = options["perf-events"].as<std::string>();
+    if (options.count("msr-rapl-interval")) {
+      msrRaplInterval = options["msr-rapl-interval"].as<unsigned>();
+
+      if (msrRaplInterval == 0) {
+        throw std::invalid_argument(
+            "Option --msr-rapl-interval must be greater than 0.");
+      }
+    }
+    measurementBufferSize =
+        options["measurement-buffer"].as<unsigned long long>();
+    measurementSpillPath = options["measurement-spill"].as<std::string>();
+    streamDestination = options["stream"].as<std::string>();
+    streamFormat = options["stream-format"].as<std::string>();
+    exporterAddress = options["exporter"].as<std::string>();
+
+    if (measurementBufferSize == 0) {
+      throw std::invalid_argument(
+          "Option --measurement-buffer must be greater than 0.");
+    }
+
+    if (options.count("control-target")) {
+      controlMetric = options["control-metric"].as<std::string>();
+      controlTarget = options["control-target"].as<double>();
+      controlInterval = std::chrono::milliseconds(
+          options["control-interval"].as<unsigned>());
+      auto gains = options["control-pid"].as<std::vector<double>>();
+      controlMaxRate = options["control-max-rate"].as<double>() / 100;
+
+      if (controlTarget <= 0) {
+        throw std::invalid_argument(
+            "Option --control-target must be greater than zero.");
+      }
+      if (gains.size() != 3) {
+        throw std::invalid_argument(
+            "Option --control-pid format: KP,KI,KD");
+      }
+      controlKp = gains[0];
+      controlKi = gains[1];
+      controlKd = gains[2];
+      if (controlInterval.count() == 0 || controlMaxRate <= 0) {
+        throw std::invalid_argument("Options --control-interval and "
+                                    "--control-max-rate must be greater than "
+                                    "zero.");
+      }
+      if (options.count("load") || !loadProfile.empty() ||
+          options.count("optimize")) {
+        throw std::invalid_argument(
+            "Option --control-target cannot be combined with -l | --load, "
+            "--load-profile or --optimize.");
+      }
+      if (period == std::chrono::microseconds::zero()) {
+        throw std::invalid_argument(
+            "Option --control-target requires -p | --period greater than "
+            "zero.");
+      }
+    }
+
+    if (options.count("convert-trace")) {
+      convertTrace = options["convert-trace"].as<std::string>();
+      if (options.count("optimize-outfile")) {
+        optimizeOutfile = options["optimize-outfile"].as<std::string>();
+      }
+    }
 
     if ((optimize = options.count("optimize"))) {
       if (measurement) {
@@ -403,9 +611,10 @@ Config::Config(int argc, const char **argv) {
         optimizationMetrics =
             options["optimization-metric"].as<std::vector<std::string>>();
       }
-      if (loadPercent != 100) {
-        throw std::invalid_argument("Options -p | --period and -l | --load are "
-                                    "not compatible with --optimize.");
+      if (loadPercent != 100 || !loadProfile.empty()) {
+        throw std::invalid_argument("Options -p | --period, -l | --load and "
+                                    "--load-profile are not compatible with "
+                                    "--optimize.");
       }
       if (timeout == std::chrono::seconds::zero()) {
         throw std::invalid_argument(
@@ -418,12 +627,34 @@ Config::Config(int argc, const char **argv) {
       if (options.count("optimize-outfile")) {
         optimizeOutfile = options["optimize-outfile"].as<std::string>();
       }
+      if (options.count("optimize-trace")) {
+        optimizeTrace = options["optimize-trace"].as<std::string>();
+      }
+      if (options.count("optimize-checkpoint")) {
+        optimizeCheckpoint = options["optimize-checkpoint"].as<std::string>();
+      }
+      resume = options.count("resume");
+      if (options.count("optimize-warm-start")) {
+        optimizeWarmStart =
+            options["optimize-warm-start"].as<std::vector<std::string>>();
+      }
+      if (resume && optimizeCheckpoint.empty()) {
+        throw std::invalid_argument(
+            "Option --resume requires --optimize-checkpoint.");
+      }
       generations = options["generations"].as<unsigned>();
       nsga2_cr = options["nsga2-cr"].as<double>();
       nsga2_m = options["nsga2-m"].as<double>();
+      if (options.count("surrogate-evaluations")) {
+        surrogateEvaluations = options["surrogate-evaluations"].as<unsigned>();
+      } else {
+        surrogateEvaluations = (std::max)(individuals / 4, 1u);
+      }
 
-      if (optimizationAlgorithm != "NSGA2") {
-        throw std::invalid_argument("Option --optimize must be any of: NSGA2");
+      if (optimizationAlgorithm != "NSGA2" &&
+          optimizationAlgorithm != "NSGA2-GP") {
+        throw std::invalid_argument(
+            "Option --optimize must be any of: NSGA2, NSGA2-GP");
       }
     }
 #endif
@@ -447,19 +678,35 @@ int main(int argc, const char **argv) {
 
   Config cfg{argc, argv};
 
+#if defined(linux) || defined(__linux__)
+  if (!cfg.convertTrace.empty()) {
+    return firestarter::optimizer::History::convertTrace(cfg.convertTrace,
+                                                         cfg.optimizeOutfile);
+  }
+#endif
+
   try {
     firestarter::Firestarter firestarter(
         argc, argv, cfg.timeout, cfg.loadPercent, cfg.period,
-        cfg.requestedNumThreads, cfg.cpuBind, cfg.printFunctionSummary,
+        cfg.precisePeriod, cfg.spinTime, cfg.realtimeWatchdog, cfg.loadProfile,
+        cfg.stagger, cfg.requestedNumThreads, cfg.cpuBind, cfg.loadVariable,
+        cfg.payloadPerPackage, cfg.hugePages, cfg.printFunctionSummary,
         cfg.functionId, cfg.listInstructionGroups, cfg.instructionGroups,
-        cfg.lineCount, cfg.allowUnavailablePayload, cfg.dumpRegisters,
-        cfg.dumpRegistersTimeDelta, cfg.dumpRegistersOutpath, cfg.gpus,
+        cfg.cpuInstructionGroups, cfg.lineCount, cfg.allowUnavailablePayload,
+        cfg.dumpRegisters, cfg.dumpRegistersTimeDelta,
+        cfg.dumpRegistersOutpath, cfg.measureLoadSkew, cfg.gpus,
         cfg.gpuMatrixSize, cfg.gpuUseFloat, cfg.gpuUseDouble, cfg.listMetrics,
-        cfg.measurement, cfg.startDelta, cfg.stopDelta, cfg.measurementInterval,
-        cfg.metricPaths, cfg.stdinMetrics, cfg.optimize, cfg.preheat,
-        cfg.optimizationAlgorithm, cfg.optimizationMetrics,
-        cfg.evaluationDuration, cfg.individuals, cfg.optimizeOutfile,
-        cfg.generations, cfg.nsga2_cr, cfg.nsga2_m);
+        cfg.measurement, cfg.startDelta, cfg.stopDelta,
+        cfg.measurementInterval, cfg.metricPaths, cfg.stdinMetrics,
+        cfg.measurementBufferSize, cfg.measurementSpillPath, cfg.perfEvents,
+        cfg.msrRaplInterval, cfg.streamDestination, cfg.streamFormat,
+        cfg.exporterAddress, cfg.controlMetric, cfg.controlTarget,
+        cfg.controlInterval, cfg.controlKp, cfg.controlKi, cfg.controlKd,
+        cfg.controlMaxRate, cfg.optimize, cfg.preheat, cfg.optimizationAlgorithm,
+        cfg.optimizationMetrics, cfg.evaluationDuration, cfg.individuals,
+        cfg.optimizeOutfile, cfg.optimizeTrace, cfg.optimizeCheckpoint,
+        cfg.resume, cfg.optimizeWarmStart, cfg.generations, cfg.nsga2_cr,
+        cfg.nsga2_m, cfg.surrogateEvaluations);
 
     firestarter.mainThread();
 
@@ -21,6 +21,9 @@
 
 #include <firestarter/Measurement/MeasurementWorker.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
 #include <queue>
 #include <thread>
 
@@ -41,8 +44,10 @@ using namespace firestarter::measurement;
 MeasurementWorker::MeasurementWorker(
     std::chrono::milliseconds updateInterval, unsigned long long numThreads,
     std::vector<std::string> const &metricDylibs,
-    std::vector<std::string> const &stdinMetrics)
-    : updateInterval(updateInterval), numThreads(numThreads) {
+    std::vector<std::string> const &stdinMetrics, std::size_t bufferSize,
+    std::string const &spillPath)
+    : updateInterval(updateInterval), numThreads(numThreads),
+      bufferSize(bufferSize), spillPath(spillPath) {
 
 #ifndef FIRESTARTER_LINK_STATIC
   // open dylibs and find metric symbol.
@@ -107,8 +112,17 @@ MeasurementWorker::MeasurementWorker(
     std::string name(metric->name);
     maxLength = maxLength < name.size() ? name.size() : maxLength;
     int returnCode = metric->init();
-    metric->fini();
     available[name] = returnCode == EXIT_SUCCESS ? true : false;
+    if (returnCode == EXIT_SUCCESS && metric->type.submetrics) {
+      for (auto submetric = metric->get_submetric_names();
+           *submetric != nullptr; submetric++) {
+        auto submetricName = name + "/" + *submetric;
+        maxLength = maxLength < submetricName.size() ? submetricName.size()
+                                                     : maxLength;
+        available[submetricName] = true;
+      }
+    }
+    metric->fini();
   }
 
   unsigned padding = maxLength > 6 ? maxLength - 6 : 0;
@@ -146,9 +160,20 @@ MeasurementWorker::~MeasurementWorker() {
     pthread_join(this->stdinThread, NULL);
   }
 
-  for (auto const &[key, value] : this->values) {
-    auto metric = this->findMetricByName(key);
-    if (metric == nullptr) {
+  // write the remaining values to the stream
+  if (_streamThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(_streamMutex);
+      _streamStop = true;
+    }
+    _streamStopAlert.notify_all();
+    _streamThread.join();
+  }
+
+  for (auto const &values : this->metricValues) {
+    auto metric = values->metric;
+    // submetrics are deinitialized with their metric
+    if (metric == nullptr || values->name.compare(metric->name) != 0) {
       continue;
     }
 
@@ -184,6 +209,14 @@ MeasurementWorker::findMetricByName(std::string metricName) {
 
   // metric not found
   if (metric == this->metrics.end()) {
+    // the name of a submetric is METRIC/SUBMETRIC
+    auto pos = metricName.find('/');
+    if (pos != std::string::npos) {
+      auto parent = this->findMetricByName(metricName.substr(0, pos));
+      if (parent != nullptr && parent->type.submetrics) {
+        return parent;
+      }
+    }
     return nullptr;
   }
   // metric found
@@ -194,116 +227,410 @@ MeasurementWorker::findMetricByName(std::string metricName) {
 // if not done so things like perf_event_attr.inherit might not work as expected
 std::vector<std::string>
 MeasurementWorker::initMetrics(std::vector<std::string> const &metricNames) {
-  this->values_mutex.lock();
+  std::lock_guard<std::mutex> lk(this->metricValuesMutex);
 
   std::vector<std::string> initialized = {};
 
+  // metrics which insert their values by themselves. they are registered once
+  // the ids of all metrics are known.
+  std::vector<const metric_interface_t *> insertCallbackMetrics = {};
+
   // try to find each metric and initialize it
   for (auto const &metricName : metricNames) {
-    // init values map with empty vector
-    auto name_equal = [metricName](auto const &pair) {
-      return metricName.compare(pair.first) == 0;
-    };
-    auto pair =
-        std::find_if(this->values.begin(), this->values.end(), name_equal);
-    if (pair != this->values.end()) {
-      pair->second.clear();
-    } else {
-      auto metric = this->findMetricByName(metricName);
-      if (metric != nullptr) {
-        int returnValue = metric->init();
-        if (returnValue != EXIT_SUCCESS) {
-          log::error() << "Metric " << metric->name << ": "
-                       << metric->get_error();
-          continue;
-        }
+    auto id = this->metricIds.find(metricName);
+    if (id != this->metricIds.end()) {
+      auto &values = *this->metricValues[id->second];
+      values.buffer->clear();
+      for (auto submetricId : values.submetrics) {
+        this->metricValues[submetricId]->buffer->clear();
       }
-      this->values[metricName] = std::vector<TimeValue>();
-      if (metric != nullptr) {
-        if (metric->type.insert_callback) {
-          metric->register_insert_callback(::insertCallback, this);
-        }
+      continue;
+    }
+
+    // the ids are resolved without locking after the first call
+    if (this->initialized) {
+      continue;
+    }
+
+    auto metric = this->findMetricByName(metricName);
+    if (metric != nullptr) {
+      int returnValue = metric->init();
+      if (returnValue != EXIT_SUCCESS) {
+        log::error() << "Metric " << metric->name << ": "
+                     << metric->get_error();
+        continue;
       }
-      initialized.push_back(metricName);
+    }
+
+    auto &values = this->addMetricValues(metricName, metric);
+    initialized.push_back(metricName);
+
+    if (metric != nullptr && metric->type.submetrics) {
+      for (auto submetric = metric->get_submetric_names();
+           *submetric != nullptr; submetric++) {
+        auto submetricName = metricName + "/" + *submetric;
+        values.submetrics.push_back(this->metricValues.size());
+        this->addMetricValues(submetricName, metric);
+        initialized.push_back(submetricName);
+      }
+    }
+
+    if (metric != nullptr && metric->type.insert_callback) {
+      insertCallbackMetrics.push_back(metric);
     }
   }
 
-  this->values_mutex.unlock();
+  this->initialized = true;
+
+  for (auto const &metric : insertCallbackMetrics) {
+    metric->register_insert_callback(::insertCallback, this);
+  }
 
   return initialized;
 }
 
+MeasurementWorker::MetricValues &
+MeasurementWorker::addMetricValues(std::string const &name,
+                                   const metric_interface_t *metric) {
+  std::string spillFile = "";
+  if (!this->spillPath.empty()) {
+    auto fileName = name;
+    std::replace(fileName.begin(), fileName.end(), '/', '_');
+    spillFile = this->spillPath + "/" + fileName + ".spill";
+  }
+
+  auto values = std::make_unique<MetricValues>();
+  values->name = name;
+  values->metric = metric;
+  values->buffer =
+      std::make_unique<TimeValueBuffer>(this->bufferSize, spillFile);
+  values->lostWarning = false;
+  values->hasSnapshotValue = false;
+  values->hasSnapshotRate = false;
+
+  // the name does not move with the unique_ptr
+  this->metricIds[values->name] = this->metricValues.size();
+  this->metricValues.push_back(std::move(values));
+
+  return *this->metricValues.back();
+}
+
 void MeasurementWorker::insertCallback(const char *metricName,
                                        int64_t timeSinceEpoch, double value) {
-  this->values_mutex.lock();
+  // metricIds does not change after initialization
+  if (!this->initialized.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  auto id = this->metricIds.find(std::string_view(metricName));
+  if (id == this->metricIds.end()) {
+    return;
+  }
 
   using Duration = std::chrono::duration<int64_t, std::nano>;
   auto time =
       std::chrono::time_point<std::chrono::high_resolution_clock, Duration>(
           Duration(timeSinceEpoch));
-  auto name_equal = [metricName](auto const &pair) {
-    return std::string(metricName).compare(pair.first) == 0;
-  };
-  auto pair =
-      std::find_if(this->values.begin(), this->values.end(), name_equal);
 
-  if (pair != this->values.end()) {
-    pair->second.push_back(TimeValue(time, value));
-  }
+  this->metricValues[id->second]->buffer->push(time, value);
+}
 
-  this->values_mutex.unlock();
+static metric_type_t metricType(const metric_interface_t *metric) {
+  metric_type_t type;
+  std::memset(&type, 0, sizeof(type));
+  if (metric == nullptr) {
+    type.absolute = 1;
+  } else {
+    std::memcpy(&type, &metric->type, sizeof(type));
+  }
+  return type;
 }
 
-void MeasurementWorker::startMeasurement() {
+void MeasurementWorker::startMeasurement(std::chrono::milliseconds startDelta,
+                                         std::chrono::milliseconds stopDelta) {
+  std::lock_guard<std::mutex> lk(this->metricValuesMutex);
+
   this->startTime = std::chrono::high_resolution_clock::now();
+  this->startDelta = startDelta;
+  this->stopDelta = stopDelta;
+  this->measurementStarted = true;
+
+  for (auto &metricValues : this->metricValues) {
+    auto metric = metricValues->metric;
+
+    metricValues->summary =
+        StreamingSummary(metricType(metric), this->numThreads);
+    metricValues->nextSummaryTime = this->startTime;
+    if (metric == nullptr || metric->type.ignore_start_stop_delta == 0) {
+      metricValues->nextSummaryTime += startDelta;
+    }
+  }
 }
 
-std::map<std::string, Summary>
-MeasurementWorker::getValues(std::chrono::milliseconds startDelta,
-                             std::chrono::milliseconds stopDelta) {
+void MeasurementWorker::updateSummary(
+    MetricValues &metricValues,
+    std::chrono::high_resolution_clock::time_point now) {
+  auto metric = metricValues.metric;
+
+  auto until = now;
+  if (metric == nullptr || metric->type.ignore_start_stop_delta == 0) {
+    until -= this->stopDelta;
+  }
+
+  if (until < metricValues.nextSummaryTime) {
+    return;
+  }
+
+  auto values =
+      metricValues.buffer->values(metricValues.nextSummaryTime, until);
+
+  for (auto const &tv : values) {
+    metricValues.summary.push(tv);
+  }
+
+  if (!values.empty()) {
+    metricValues.nextSummaryTime =
+        values.back().time + std::chrono::high_resolution_clock::duration(1);
+  }
+}
+
+std::map<std::string, Summary> MeasurementWorker::getValues() {
   std::map<std::string, Summary> measurment = {};
 
-  this->values_mutex.lock();
+  std::lock_guard<std::mutex> lk(this->metricValuesMutex);
+
+  auto now = std::chrono::high_resolution_clock::now();
+
+  for (auto &metricValues : this->metricValues) {
+    auto lost = metricValues->buffer->lost();
+    if (lost > 0 && !metricValues->lostWarning) {
+      log::warn() << "Metric " << metricValues->name << ": " << lost
+                  << " values were overwritten or dropped. Increase "
+                     "--measurement-buffer or use --measurement-spill.";
+      metricValues->lostWarning = true;
+    }
+
+    if (this->measurementStarted) {
+      this->updateSummary(*metricValues, now);
+    }
+
+    measurment[metricValues->name] = metricValues->summary.summary();
+  }
+
+  return measurment;
+}
+
+std::map<std::string, std::vector<TimeValue>>
+MeasurementWorker::getRawValues() {
+  std::map<std::string, std::vector<TimeValue>> values = {};
 
-  for (auto &[key, values] : this->values) {
-    auto startTime = this->startTime;
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto metric = this->findMetricByName(key);
+  std::lock_guard<std::mutex> lk(this->metricValuesMutex);
+
+  if (!this->measurementStarted) {
+    return values;
+  }
 
-    metric_type_t type;
-    std::memset(&type, 0, sizeof(type));
-    if (metric == nullptr) {
-      type.absolute = 1;
+  auto now = std::chrono::high_resolution_clock::now();
 
-      startTime += startDelta;
-      endTime -= stopDelta;
-    } else {
-      std::memcpy(&type, &metric->type, sizeof(type));
+  for (auto const &metricValues : this->metricValues) {
+    auto metric = metricValues->metric;
 
-      if (metric->type.ignore_start_stop_delta == 0) {
-        startTime += startDelta;
-        endTime -= stopDelta;
+    auto since = this->startTime;
+    auto until = now;
+    if (metric == nullptr || metric->type.ignore_start_stop_delta == 0) {
+      since += this->startDelta;
+      until -= this->stopDelta;
+    }
+
+    values[metricValues->name] = metricValues->buffer->values(since, until);
+  }
+
+  return values;
+}
+
+int MeasurementWorker::getRecentValue(std::string const &metricName,
+                                      std::chrono::milliseconds window,
+                                      Summary &summary) {
+  std::lock_guard<std::mutex> lk(this->metricValuesMutex);
+
+  auto id = this->metricIds.find(metricName);
+
+  if (id == this->metricIds.end()) {
+    return EXIT_FAILURE;
+  }
+
+  auto &metricValues = *this->metricValues[id->second];
+  auto type = metricType(metricValues.metric);
+
+  auto startTime = std::chrono::high_resolution_clock::now() - window;
+  auto values = metricValues.buffer->values(startTime);
+
+  summary = Summary::calculate(values.begin(), values.end(), type,
+                               this->numThreads);
+
+  return EXIT_SUCCESS;
+}
+
+int MeasurementWorker::startStream(std::string const &destination,
+                                   MetricStream::Format format) {
+  _stream = std::make_unique<MetricStream>(destination, format);
+
+  // a named pipe is opened by the stream worker once it has a reader
+  if (!_stream->isPipe() && EXIT_SUCCESS != _stream->open()) {
+    log::error() << _stream->error();
+    return EXIT_FAILURE;
+  }
+
+  _streamActive = true;
+  _streamThread = std::thread(&MeasurementWorker::streamWorker, this);
+
+  return EXIT_SUCCESS;
+}
+
+void MeasurementWorker::insertEvent(std::string const &name,
+                                    std::string const &value) {
+  if (!_streamActive.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::high_resolution_clock::now()
+                         .time_since_epoch())
+                     .count();
+
+  std::lock_guard<std::mutex> lk(_eventsMutex);
+  _events.push_back({time, name, value});
+}
+
+void MeasurementWorker::collectStreamRecords() {
+  // metricValues does not change after initialization
+  if (this->initialized.load(std::memory_order_acquire)) {
+    for (auto id = _streamTimes.size(); id < this->metricValues.size(); id++) {
+      _stream->addMetric(id, this->metricValues[id]->name);
+      _streamTimes.push_back(
+          std::chrono::high_resolution_clock::time_point::min());
+    }
+
+    for (std::size_t id = 0; id < _streamTimes.size(); id++) {
+      auto values = this->metricValues[id]->buffer->values(_streamTimes[id]);
+
+      for (auto const &tv : values) {
+        _stream->addValue(id, tv);
+      }
+
+      if (!values.empty()) {
+        _streamTimes[id] =
+            values.back().time + std::chrono::high_resolution_clock::duration(1);
       }
     }
+  }
 
-    decltype(values) croppedValues(values.size());
+  std::vector<Event> events;
+  {
+    std::lock_guard<std::mutex> lk(_eventsMutex);
+    events.swap(_events);
+  }
 
-    auto findAll = [startTime, endTime](auto const &tv) {
-      return startTime <= tv.time && tv.time <= endTime;
-    };
-    auto it = std::copy_if(values.begin(), values.end(), croppedValues.begin(),
-                           findAll);
-    croppedValues.resize(std::distance(croppedValues.begin(), it));
+  for (auto const &event : events) {
+    _stream->addEvent(event.time, event.name, event.value);
+  }
+}
 
-    Summary sum = Summary::calculate(croppedValues.begin(), croppedValues.end(),
-                                     type, this->numThreads);
+void MeasurementWorker::streamWorker() {
+#ifndef __APPLE__
+  pthread_setname_np(pthread_self(), "MetricStream");
+#endif
 
-    measurment[key] = sum;
+  // a closed pipe or socket fails the write with EPIPE instead of raising
+  // SIGPIPE
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  for (bool stop = false; !stop;) {
+    {
+      std::unique_lock<std::mutex> lk(_streamMutex);
+      _streamStopAlert.wait_for(lk, this->updateInterval,
+                                [this]() { return _streamStop; });
+      stop = _streamStop;
+    }
+
+    if (!_stream->isOpen() && EXIT_SUCCESS != _stream->open()) {
+      // the named pipe is not opened for reading yet. the events are dropped
+      // until there is a reader, the values are kept in their buffers.
+      if (errno == ENXIO) {
+        std::lock_guard<std::mutex> lk(_eventsMutex);
+        _events.clear();
+        continue;
+      }
+      log::warn() << _stream->error() << ". Stopped streaming.";
+      break;
+    }
+
+    this->collectStreamRecords();
+
+    if (EXIT_SUCCESS != _stream->flush()) {
+      log::warn() << _stream->error() << ". Stopped streaming.";
+      break;
+    }
   }
 
-  this->values_mutex.unlock();
+  _streamActive = false;
+}
+
+void MeasurementWorker::publishSnapshot() {
+  auto snapshot = std::make_shared<std::vector<MetricSnapshot>>();
+  snapshot->reserve(this->metricValues.size());
 
-  return measurment;
+  for (auto const &values : this->metricValues) {
+    auto metric = values->metric;
+    auto type = metricType(metric);
+
+    TimeValue latest;
+    if (values->buffer->latest(&latest, 1) == 0) {
+      continue;
+    }
+
+    MetricSnapshot entry;
+    entry.name = values->name;
+    entry.unit = metric != nullptr && metric->unit != nullptr ? metric->unit
+                                                              : "";
+    entry.value = latest.value;
+    entry.time = latest.time;
+
+    if (type.accumalative) {
+      // the rate over the last measurement interval is less noisy than the
+      // one of the last two values of a metric with a high sampling rate
+      auto const &previous = values->snapshotValue;
+      if (values->hasSnapshotValue && latest.time > previous.time) {
+        values->snapshotRate =
+            (latest.value - previous.value) /
+            std::chrono::duration<double>(latest.time - previous.time).count();
+        values->hasSnapshotRate = true;
+      }
+      if (!values->hasSnapshotValue || latest.time > previous.time) {
+        values->snapshotValue = latest;
+        values->hasSnapshotValue = true;
+      }
+
+      if (!values->hasSnapshotRate) {
+        continue;
+      }
+      entry.value = values->snapshotRate;
+      entry.unit += "/s";
+    }
+
+    if (type.divide_by_thread_count) {
+      entry.value /= this->numThreads;
+    }
+
+    snapshot->push_back(std::move(entry));
+  }
+
+  std::atomic_store(
+      &_snapshot,
+      std::shared_ptr<const std::vector<MetricSnapshot>>(std::move(snapshot)));
 }
 
 int *MeasurementWorker::dataAcquisitionWorker(void *measurementWorker) {
@@ -332,41 +659,49 @@ int *MeasurementWorker::dataAcquisitionWorker(void *measurementWorker) {
                       decltype(callbackTupleComparator)>
       callbackQueue(callbackTupleComparator);
 
-  _this->values_mutex.lock();
+  // the callbacks are added once the metrics are initialized
+  bool callbacksAdded = false;
 
-  for (auto const &[key, value] : _this->values) {
-    auto metric_interface = _this->findMetricByName(key);
+  auto nextFetch = clock::now() + _this->updateInterval;
 
-    if (metric_interface == nullptr) {
-      continue;
-    }
+  std::vector<double> submetricValues;
 
-    auto callbackTime =
-        std::chrono::microseconds(metric_interface->callback_time);
-    if (callbackTime.count() == 0) {
-      continue;
-    }
+  for (;;) {
+    auto now = clock::now();
 
-    auto currentTime = clock::now();
+    if (!callbacksAdded && _this->initialized) {
+      std::lock_guard<std::mutex> lk(_this->metricValuesMutex);
 
-    callbackQueue.push(
-        std::make_tuple(metric_interface->callback, callbackTime, currentTime));
-  }
+      for (auto const &values : _this->metricValues) {
+        auto metric_interface = values->metric;
 
-  _this->values_mutex.unlock();
+        if (metric_interface == nullptr ||
+            values->name.compare(metric_interface->name) != 0) {
+          continue;
+        }
 
-  auto nextFetch = clock::now() + _this->updateInterval;
+        auto callbackTime =
+            std::chrono::microseconds(metric_interface->callback_time);
+        if (callbackTime.count() == 0) {
+          continue;
+        }
 
-  for (;;) {
-    auto now = clock::now();
+        callbackQueue.push(
+            std::make_tuple(metric_interface->callback, callbackTime, now));
+      }
+
+      callbacksAdded = true;
+    }
 
     if (nextFetch <= now) {
-      _this->values_mutex.lock();
+      std::lock_guard<std::mutex> lk(_this->metricValuesMutex);
 
-      for (auto &[metricName, values] : _this->values) {
-        auto metric_interface = _this->findMetricByName(metricName);
+      for (auto const &values : _this->metricValues) {
+        auto metric_interface = values->metric;
 
-        if (metric_interface == nullptr) {
+        // submetrics are read with their metric
+        if (metric_interface == nullptr ||
+            values->name.compare(metric_interface->name) != 0) {
           continue;
         }
 
@@ -375,14 +710,37 @@ int *MeasurementWorker::dataAcquisitionWorker(void *measurementWorker) {
         if (!metric_interface->type.insert_callback &&
             metric_interface->get_reading != nullptr) {
           if (EXIT_SUCCESS == metric_interface->get_reading(&value)) {
-            auto tv =
-                TimeValue(std::chrono::high_resolution_clock::now(), value);
-            values.push_back(tv);
+            auto time = std::chrono::high_resolution_clock::now();
+            values->buffer->push(time, value);
+
+            if (metric_interface->type.submetrics) {
+              auto const &submetrics = values->submetrics;
+              submetricValues.resize(submetrics.size());
+
+              if (EXIT_SUCCESS == metric_interface->get_submetric_readings(
+                                      submetricValues.data())) {
+                for (std::size_t i = 0; i < submetrics.size(); i++) {
+                  _this->metricValues[submetrics[i]]->buffer->push(
+                      time, submetricValues[i]);
+                }
+              }
+            }
           }
         }
       }
 
-      _this->values_mutex.unlock();
+      // summarize the new values and move old values of all metrics to the
+      // spill files
+      for (auto const &values : _this->metricValues) {
+        if (_this->measurementStarted) {
+          _this->updateSummary(*values, now);
+        }
+        values->buffer->spill();
+      }
+
+      if (_this->_publishSnapshots.load(std::memory_order_relaxed)) {
+        _this->publishSnapshot();
+      }
 
       nextFetch = now + _this->updateInterval;
     }
@@ -78,6 +78,7 @@ metric_interface_t ipc_estimate_metric = {
              .divide_by_thread_count = 0,
              .insert_callback = 1,
              .ignore_start_stop_delta = 1,
+             .submetrics = 0,
              .__reserved = 0},
     .unit = "IPC",
     .callback_time = 0,
@@ -87,4 +88,6 @@ metric_interface_t ipc_estimate_metric = {
     .get_reading = nullptr,
     .get_error = get_error,
     .register_insert_callback = register_insert_callback,
+    .get_submetric_names = nullptr,
+    .get_submetric_readings = nullptr,
 };
@@ -0,0 +1,468 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <firestarter/Measurement/Metric/MSR.h>
+#include <firestarter/Measurement/MetricInterface.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+// the paths can be changed at build time to use a mock directory
+#ifndef MSR_PATH
+#define MSR_PATH "/dev/cpu"
+#endif
+#ifndef CPU_PATH
+#define CPU_PATH "/sys/devices/system/cpu"
+#endif
+
+#define MSR_RAPL_POWER_UNIT 0x606
+#define MSR_PKG_ENERGY_STATUS 0x611
+#define MSR_DRAM_ENERGY_STATUS 0x619
+#define MSR_PP0_ENERGY_STATUS 0x639
+
+#define MSR_AMD_RAPL_POWER_UNIT 0xC0010299
+#define MSR_AMD_CORE_ENERGY_STATUS 0xC001029A
+#define MSR_AMD_PKG_ENERGY_STATUS 0xC001029B
+
+// intel servers count the dram energy in a fixed unit of 2^-16 J, independent
+// of MSR_RAPL_POWER_UNIT
+#define DRAM_ENERGY_UNIT (1.0 / 65536.0)
+
+// the minimal interval of the counters of other cpus. every read of such a
+// counter interrupts the other cpu.
+#define REMOTE_SAMPLE_INTERVAL std::chrono::milliseconds(10)
+
+static std::string errorString = "";
+
+// the interval in which the energy counters are read and inserted
+static std::chrono::microseconds sampleInterval(100);
+
+static void (*callback)(void *, const char *, int64_t, double) = nullptr;
+static void *callback_arg = nullptr;
+
+struct counter_def {
+  // the name of the submetric, e.g. package-0 or core-12
+  std::string name;
+  int fd;
+  uint32_t msr;
+  // energy per increment in J
+  double unit;
+  // the energy status is a 32 bit counter
+  uint32_t last_reading;
+  // the accumulated energy in J
+  double value;
+  // set if the counter is part of the value of the metric
+  bool total;
+  // set if the counter is read from another cpu than the sampling thread
+  bool remote;
+};
+
+struct package_def {
+  // the cpu the sampling thread is pinned to
+  unsigned cpu;
+  std::vector<struct counter_def> counters;
+  // the sum of all counters with total set
+  std::atomic<double> total{0.0};
+  std::thread thread;
+};
+
+static std::vector<std::unique_ptr<struct package_def>> packages = {};
+
+// the cpus of the load threads, which the sampling threads avoid
+static std::vector<int> loadCpus = {};
+
+// file descriptors of the msr device of every used cpu
+static std::map<unsigned, int> msrFds = {};
+
+static std::atomic<bool> stop{false};
+
+static std::vector<std::string> submetricNames = {};
+static std::vector<const char *> submetricCNames = {};
+
+static bool readMsr(int fd, uint32_t msr, uint64_t &value) {
+  return sizeof(value) == pread(fd, &value, sizeof(value), msr);
+}
+
+static int openMsr(unsigned cpu) {
+  auto it = msrFds.find(cpu);
+  if (it != msrFds.end()) {
+    return it->second;
+  }
+
+  std::stringstream path;
+  path << MSR_PATH << "/" << cpu << "/msr";
+
+  int fd = open(path.str().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    msrFds[cpu] = fd;
+  }
+
+  return fd;
+}
+
+static bool readTopologyValue(unsigned cpu, const char *name,
+                              unsigned &value) {
+  std::stringstream path;
+  path << CPU_PATH << "/cpu" << cpu << "/topology/" << name;
+
+  std::ifstream stream(path.str());
+  return static_cast<bool>(stream >> value);
+}
+
+// decode the energy status unit in J from bits 12:8 of the power unit msr
+static double energyUnit(uint64_t powerUnit) {
+  return 1.0 / (double)(1ULL << ((powerUnit >> 8) & 0x1f));
+}
+
+static int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::high_resolution_clock::now().time_since_epoch())
+      .count();
+}
+
+static void sample(struct package_def &package, bool remote) {
+  double total = 0.0;
+
+  for (auto &counter : package.counters) {
+    uint64_t reading;
+    if ((counter.remote && !remote) ||
+        !readMsr(counter.fd, counter.msr, reading)) {
+      if (counter.total) {
+        total += counter.value;
+      }
+      continue;
+    }
+
+    // the difference of the lower 32 bits handles one overflow
+    uint32_t current = reading & 0xffffffff;
+    counter.value += counter.unit * (uint32_t)(current - counter.last_reading);
+    counter.last_reading = current;
+
+    if (counter.total) {
+      total += counter.value;
+    }
+  }
+
+  package.total.store(total, std::memory_order_relaxed);
+}
+
+static void samplingWorker(struct package_def *package, bool insertTotal) {
+  pthread_setname_np(pthread_self(), "MSRSampling");
+
+  // the counters of other cpus are only read in every remoteDivider-th sample
+  auto const remoteDivider = std::max<long long>(
+      1, std::chrono::duration_cast<std::chrono::microseconds>(
+             REMOTE_SAMPLE_INTERVAL)
+                 .count() /
+             sampleInterval.count());
+  unsigned long long iteration = 0;
+
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  while (!stop.load(std::memory_order_relaxed)) {
+    bool remote = iteration++ % remoteDivider == 0;
+    sample(*package, remote);
+
+    auto t = now();
+    for (auto const &counter : package->counters) {
+      if (!counter.remote || remote) {
+        callback(callback_arg, counter.name.c_str(), t, counter.value);
+      }
+    }
+
+    if (insertTotal) {
+      double total = 0.0;
+      for (auto const &p : packages) {
+        total += p->total.load(std::memory_order_relaxed);
+      }
+      callback(callback_arg, msr_rapl_metric.name, t, total);
+    }
+
+    next.tv_nsec +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(sampleInterval)
+            .count();
+    next.tv_sec += next.tv_nsec / 1000000000;
+    next.tv_nsec %= 1000000000;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+}
+
+// the sampling threads have to be joined before the static packages are
+// destroyed, also if FIRESTARTER exits without calling fini.
+static void stopSampling(void) {
+  stop = true;
+
+  for (auto &package : packages) {
+    if (package->thread.joinable()) {
+      package->thread.join();
+    }
+  }
+}
+
+static int32_t fini(void) {
+  stopSampling();
+
+  for (auto const &[cpu, fd] : msrFds) {
+    close(fd);
+  }
+
+  packages.clear();
+  msrFds.clear();
+  submetricNames.clear();
+  submetricCNames.clear();
+
+  callback = nullptr;
+  callback_arg = nullptr;
+
+  return EXIT_SUCCESS;
+}
+
+static bool addCounter(struct package_def &package, unsigned cpu, uint32_t msr,
+                       double unit, std::string const &name, bool total) {
+  int fd = openMsr(cpu);
+  uint64_t reading;
+
+  if (fd < 0 || !readMsr(fd, msr, reading)) {
+    return false;
+  }
+
+  package.counters.push_back({std::string(msr_rapl_metric.name) + "/" + name,
+                              fd, msr, unit,
+                              (uint32_t)(reading & 0xffffffff), 0.0, total,
+                              cpu != package.cpu});
+  submetricNames.push_back(name);
+
+  return true;
+}
+
+static int32_t init(void) {
+  errorString = "";
+  stop = false;
+
+  // find the package and core of every online cpu
+  std::map<unsigned, std::vector<std::pair<unsigned, unsigned>>>
+      cpusOfPackage = {};
+
+  DIR *cpuDir = opendir(CPU_PATH);
+  if (cpuDir == NULL) {
+    errorString = "Could not open " CPU_PATH;
+    return EXIT_FAILURE;
+  }
+
+  struct dirent *dir;
+  while ((dir = readdir(cpuDir)) != NULL) {
+    unsigned cpu;
+    char rest;
+    if (1 != std::sscanf(dir->d_name, "cpu%u%c", &cpu, &rest)) {
+      continue;
+    }
+
+    unsigned package, core;
+    if (!readTopologyValue(cpu, "physical_package_id", package) ||
+        !readTopologyValue(cpu, "core_id", core)) {
+      // the cpu is offline
+      continue;
+    }
+
+    cpusOfPackage[package].push_back(std::make_pair(cpu, core));
+  }
+  closedir(cpuDir);
+
+  if (cpusOfPackage.size() == 0) {
+    errorString = "No cpu topology found in " CPU_PATH;
+    return EXIT_FAILURE;
+  }
+
+  for (auto &[package, cpus] : cpusOfPackage) {
+    std::sort(cpus.begin(), cpus.end());
+  }
+
+  auto firstCpu = cpusOfPackage.begin()->second.front().first;
+  int fd = openMsr(firstCpu);
+  if (fd < 0) {
+    std::stringstream ss;
+    ss << "Could not open " << MSR_PATH << "/" << firstCpu
+       << "/msr. Is the msr module loaded?";
+    errorString = ss.str();
+    fini();
+    return EXIT_FAILURE;
+  }
+
+  // amd provides the energy of every core, intel of dram and pp0
+  uint64_t powerUnit;
+  bool amd = readMsr(fd, MSR_AMD_RAPL_POWER_UNIT, powerUnit);
+  if (!amd && !readMsr(fd, MSR_RAPL_POWER_UNIT, powerUnit)) {
+    errorString = "Could not read MSR_RAPL_POWER_UNIT";
+    fini();
+    return EXIT_FAILURE;
+  }
+
+  auto unit = energyUnit(powerUnit);
+
+  for (auto const &[package, cpus] : cpusOfPackage) {
+    std::unique_ptr<struct package_def> def(new package_def());
+    // sample on a cpu without a load thread, so the sampling thread neither
+    // preempts a load thread nor is counted by the perf groups of the load
+    // cpus. the package counters can be read on every cpu of the package.
+    def->cpu = cpus.front().first;
+    for (auto const &[cpu, core] : cpus) {
+      if (std::find(loadCpus.begin(), loadCpus.end(), (int)cpu) ==
+          loadCpus.end()) {
+        def->cpu = cpu;
+        break;
+      }
+    }
+
+    auto suffix = std::to_string(package);
+
+    if (amd) {
+      addCounter(*def, def->cpu, MSR_AMD_PKG_ENERGY_STATUS, unit,
+                 "package-" + suffix, true);
+
+      // read one cpu of every core
+      std::vector<unsigned> cores = {};
+      for (auto const &[cpu, core] : cpus) {
+        if (std::find(cores.begin(), cores.end(), core) != cores.end()) {
+          continue;
+        }
+        cores.push_back(core);
+        addCounter(*def, cpu, MSR_AMD_CORE_ENERGY_STATUS, unit,
+                   "core-" + std::to_string(cpu), false);
+      }
+    } else {
+      addCounter(*def, def->cpu, MSR_PKG_ENERGY_STATUS, unit,
+                 "package-" + suffix, true);
+      addCounter(*def, def->cpu, MSR_DRAM_ENERGY_STATUS, DRAM_ENERGY_UNIT,
+                 "dram-" + suffix, true);
+      addCounter(*def, def->cpu, MSR_PP0_ENERGY_STATUS, unit,
+                 "pp0-" + suffix, false);
+    }
+
+    if (def->counters.size() == 0) {
+      std::stringstream ss;
+      ss << "Could not read the energy status of package " << package;
+      errorString = ss.str();
+      break;
+    }
+
+    packages.push_back(std::move(def));
+  }
+
+  if (errorString.size() != 0) {
+    fini();
+    return EXIT_FAILURE;
+  }
+
+  for (auto const &name : submetricNames) {
+    submetricCNames.push_back(name.c_str());
+  }
+  submetricCNames.push_back(nullptr);
+
+  return EXIT_SUCCESS;
+}
+
+void msr_rapl_metric_set_interval(uint32_t usec) {
+  sampleInterval = std::chrono::microseconds(usec);
+}
+
+void msr_rapl_metric_set_load_cpus(const int *cpus, uint32_t count) {
+  loadCpus.assign(cpus, cpus + count);
+}
+
+static const char *get_error(void) {
+  const char *errorCString = errorString.c_str();
+  return errorCString;
+}
+
+static const char **get_submetric_names(void) {
+  return submetricCNames.data();
+}
+
+// start one sampling thread per package which is pinned to a cpu of this
+// package
+static int32_t register_insert_callback(void (*c)(void *, const char *, int64_t,
+                                                  double),
+                                        void *arg) {
+  static bool stopAtExit = false;
+
+  callback = c;
+  callback_arg = arg;
+
+  if (!stopAtExit) {
+    std::atexit(stopSampling);
+    stopAtExit = true;
+  }
+
+  for (std::size_t i = 0; i < packages.size(); i++) {
+    auto &package = packages[i];
+
+    package->thread = std::thread(samplingWorker, package.get(), i == 0);
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(package->cpu, &cpuset);
+    pthread_setaffinity_np(package->thread.native_handle(), sizeof(cpu_set_t),
+                           &cpuset);
+  }
+
+  return EXIT_SUCCESS;
+}
+}
+
+metric_interface_t msr_rapl_metric = {
+    .name = "msr-rapl",
+    .type = {.absolute = 0,
+             .accumalative = 1,
+             .divide_by_thread_count = 0,
+             .insert_callback = 1,
+             .ignore_start_stop_delta = 0,
+             .submetrics = 1,
+             .__reserved = 0},
+    .unit = "J",
+    .callback_time = 0,
+    .callback = nullptr,
+    .init = init,
+    .fini = fini,
+    .get_reading = nullptr,
+    .get_error = get_error,
+    .register_insert_callback = register_insert_callback,
+    .get_submetric_names = get_submetric_names,
+    .get_submetric_readings = nullptr,
+};
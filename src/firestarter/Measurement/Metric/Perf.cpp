@@ -19,14 +19,19 @@
  * Contact: daniel.hackenberg@tu-dresden.de
  *****************************************************************************/
 
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <sstream>
 #include <string>
+#include <vector>
 
 extern "C" {
 #include <firestarter/Measurement/Metric/Perf.h>
 #include <firestarter/Measurement/MetricInterface.h>
 
 #include <linux/perf_event.h>
+#include <sched.h>
 #include <sys/ioctl.h>
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -35,65 +40,98 @@ extern "C" {
 
 struct read_format {
   uint64_t nr;
+  uint64_t time_enabled;
+  uint64_t time_running;
   struct {
     uint64_t value;
     uint64_t id;
   } values[2];
 };
 
+// the cycles and instructions of the process on one cpu
+struct cpu_group {
+  int cpu;
+  int cpu_cycles_fd;
+  int instructions_fd;
+  uint64_t cpu_cycles_id;
+  uint64_t instructions_id;
+};
+
+struct group_reading {
+  uint64_t cycles;
+  uint64_t instructions;
+  // the time in ns the process was running on this cpu
+  uint64_t running;
+};
+
+// the state of one metric derived from the groups
+struct metric_state {
+  std::vector<struct group_reading> last;
+  // min, max and mean across all cpus of the last reading
+  double submetrics[3];
+};
+
 static std::string errorString = "";
 
-static int cpu_cycles_fd = -1;
-static int instructions_fd = -1;
-static uint64_t cpu_cycles_id;
-static uint64_t instructions_id;
+static std::vector<struct cpu_group> groups = {};
+// the cpus of the load threads. all cpus the process may run on if empty.
+static std::vector<int> groupCpus = {};
 static bool init_done = false;
 static int32_t init_value;
 
-static struct read_format last;
+static struct metric_state ipc_state;
+static struct metric_state freq_state;
+
+static const char *submetricNames[] = {"min", "max", "mean", nullptr};
+
+// the events of the perf-events metric, measured for the whole process
+struct event_def {
+  std::string name;
+  struct perf_event_attr attr;
+  int fd;
+  // the scaled count of the last reading
+  double last;
+  // the events per second of the last reading
+  double value;
+};
+
+struct event_read_format {
+  uint64_t value;
+  uint64_t time_enabled;
+  uint64_t time_running;
+};
+
+static std::string eventsErrorString = "";
+
+static std::vector<struct event_def> events = {};
+static std::vector<const char *> eventNames = {};
+static std::chrono::steady_clock::time_point eventsLastTime;
+
+static const struct {
+  const char *name;
+  uint64_t config;
+} genericEvents[] = {
+    {"cache-references", PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-instructions", PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_COUNT_HW_BRANCH_MISSES},
+    {"bus-cycles", PERF_COUNT_HW_BUS_CYCLES},
+    {"stalled-cycles-frontend", PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {"stalled-cycles-backend", PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {"ref-cycles", PERF_COUNT_HW_REF_CPU_CYCLES},
+};
 
 static long perf_event_open(struct perf_event_attr *hw_event, pid_t pid,
                             int cpu, int group_fd, unsigned long flags) {
   return syscall(__NR_perf_event_open, hw_event, pid, cpu, group_fd, flags);
 }
 
-static int32_t fini(void) {
-  if (!(cpu_cycles_fd < 0)) {
-    close(cpu_cycles_fd);
-    cpu_cycles_fd = -1;
-  }
-  if (!(instructions_fd < 0)) {
-    close(instructions_fd);
-    instructions_fd = -1;
-  }
-  init_done = false;
-  return EXIT_SUCCESS;
-}
-
-static int32_t init(void) {
-  if (init_done) {
-    return init_value;
-  }
-
-  if (access(PERF_EVENT_PARANOID, F_OK) == -1) {
-    // https://man7.org/linux/man-pages/man2/perf_event_open.2.html
-    // The official way of knowing if perf_event_open() support is enabled
-    // is checking for the existence of the file
-    // /proc/sys/kernel/perf_event_paranoid.
-    errorString =
-        "syscall perf_event_open not supported or file " PERF_EVENT_PARANOID
-        " does not exist";
-    init_value = EXIT_FAILURE;
-    init_done = true;
-    return EXIT_FAILURE;
-  }
-
-  struct perf_event_attr cpu_cycles_attr;
-  std::memset(&cpu_cycles_attr, 0, sizeof(struct perf_event_attr));
-  cpu_cycles_attr.type = PERF_TYPE_HARDWARE;
-  cpu_cycles_attr.size = sizeof(struct perf_event_attr);
-  cpu_cycles_attr.config = PERF_COUNT_HW_CPU_CYCLES;
-  cpu_cycles_attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+static void init_attr(struct perf_event_attr &attr, uint32_t type,
+                      uint64_t config) {
+  std::memset(&attr, 0, sizeof(struct perf_event_attr));
+  attr.type = type;
+  attr.size = sizeof(struct perf_event_attr);
+  attr.config = config;
   // https://man7.org/linux/man-pages/man2/perf_event_open.2.html
   //     inherit
   // The inherit bit specifies that this counter should count
@@ -113,130 +151,423 @@ static int32_t init(void) {
   // changed the check
   // - if (attr->inherit && (attr->read_format & PERF_FORMAT_GROUP))
   // + if (attr->inherit && (attr->sample_type & PERF_SAMPLE_READ))
-  cpu_cycles_attr.inherit = 1;
-  cpu_cycles_attr.exclude_kernel = 1;
-  cpu_cycles_attr.exclude_hv = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+}
+
+static int32_t fini(void) {
+  for (auto const &group : groups) {
+    if (!(group.cpu_cycles_fd < 0)) {
+      close(group.cpu_cycles_fd);
+    }
+    if (!(group.instructions_fd < 0)) {
+      close(group.instructions_fd);
+    }
+  }
+  groups.clear();
+  init_done = false;
+  return EXIT_SUCCESS;
+}
+
+static bool read_group(struct cpu_group const &group,
+                       struct group_reading &reading) {
+  struct read_format values;
 
-  if ((cpu_cycles_fd = perf_event_open(
+  if (0 >= read(group.cpu_cycles_fd, &values, sizeof(values))) {
+    return false;
+  }
+
+  reading.cycles = 0;
+  reading.instructions = 0;
+  reading.running = values.time_running;
+
+  for (decltype(values.nr) i = 0; i < values.nr && i < 2; ++i) {
+    if (values.values[i].id == group.cpu_cycles_id) {
+      reading.cycles = values.values[i].value;
+    } else if (values.values[i].id == group.instructions_id) {
+      reading.instructions = values.values[i].value;
+    }
+  }
+
+  return true;
+}
+
+static int32_t open_group(struct cpu_group &group) {
+  struct perf_event_attr cpu_cycles_attr;
+  init_attr(cpu_cycles_attr, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  cpu_cycles_attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                                PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  if ((group.cpu_cycles_fd = perf_event_open(
            &cpu_cycles_attr,
-           // pid == 0 and cpu == -1
-           // This measures the calling process/thread on any CPU.
-           0, -1,
+           // pid == 0 and cpu >= 0
+           // This measures the calling process/thread only when running on
+           // the specified CPU.
+           0, group.cpu,
            // The group_fd argument allows event groups to be created.  An event
            // group has one event which is the group leader.  The leader is
            // created first, with group_fd = -1.  The rest of the group members
            // are created with subsequent perf_event_open() calls with group_fd
            // being set to the file descriptor of the group leader.
            -1, 0)) < 0) {
-    fini();
     errorString = "perf_event_open failed for PERF_COUNT_HW_CPU_CYCLES";
-    init_value = EXIT_FAILURE;
-    init_done = true;
     return EXIT_FAILURE;
   }
 
-  ioctl(cpu_cycles_fd, PERF_EVENT_IOC_ID, &cpu_cycles_id);
+  ioctl(group.cpu_cycles_fd, PERF_EVENT_IOC_ID, &group.cpu_cycles_id);
 
   struct perf_event_attr instructions_attr;
-  std::memset(&instructions_attr, 0, sizeof(struct perf_event_attr));
-  instructions_attr.type = PERF_TYPE_HARDWARE;
-  instructions_attr.size = sizeof(struct perf_event_attr);
-  instructions_attr.config = PERF_COUNT_HW_INSTRUCTIONS;
-  instructions_attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
-  instructions_attr.inherit = 1;
-  instructions_attr.exclude_kernel = 1;
-  instructions_attr.exclude_hv = 1;
-
-  if ((instructions_fd = perf_event_open(
-           &instructions_attr,
-           // pid == 0 and cpu == -1
-           // This measures the calling process/thread on any CPU.
-           0, -1,
-           // The group_fd argument allows event groups to be created.  An event
-           // group has one event which is the group leader.  The leader is
-           // created first, with group_fd = -1.  The rest of the group members
-           // are created with subsequent perf_event_open() calls with group_fd
-           // being set to the file descriptor of the group leader.
-           cpu_cycles_fd, 0)) < 0) {
-    fini();
+  init_attr(instructions_attr, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  instructions_attr.read_format = cpu_cycles_attr.read_format;
+
+  if ((group.instructions_fd = perf_event_open(&instructions_attr, 0, group.cpu,
+                                               group.cpu_cycles_fd, 0)) < 0) {
     errorString = "perf_event_open failed for PERF_COUNT_HW_INSTRUCTIONS";
-    init_value = EXIT_FAILURE;
-    init_done = true;
     return EXIT_FAILURE;
   }
 
-  ioctl(instructions_fd, PERF_EVENT_IOC_ID, &instructions_id);
+  ioctl(group.instructions_fd, PERF_EVENT_IOC_ID, &group.instructions_id);
+
+  ioctl(group.cpu_cycles_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(group.cpu_cycles_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+  return EXIT_SUCCESS;
+}
+
+static int32_t init(void) {
+  if (init_done) {
+    return init_value;
+  }
 
-  ioctl(cpu_cycles_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
-  ioctl(cpu_cycles_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  init_done = true;
+  init_value = EXIT_FAILURE;
 
-  if (0 == read(cpu_cycles_fd, &last, sizeof(last))) {
-    fini();
-    errorString = "group read failed in init";
-    init_value = EXIT_FAILURE;
-    init_done = true;
+  if (access(PERF_EVENT_PARANOID, F_OK) == -1) {
+    // https://man7.org/linux/man-pages/man2/perf_event_open.2.html
+    // The official way of knowing if perf_event_open() support is enabled
+    // is checking for the existence of the file
+    // /proc/sys/kernel/perf_event_paranoid.
+    errorString =
+        "syscall perf_event_open not supported or file " PERF_EVENT_PARANOID
+        " does not exist";
     return EXIT_FAILURE;
   }
 
+  // open one group on every cpu of a load thread, so every group measures
+  // the load threads of one cpu. without a binding of the load threads use
+  // every cpu the process may run on.
+  auto cpus = groupCpus;
+  if (cpus.empty()) {
+    cpu_set_t cpuset;
+    if (0 != sched_getaffinity(0, sizeof(cpu_set_t), &cpuset)) {
+      errorString = "sched_getaffinity failed";
+      return EXIT_FAILURE;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &cpuset)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+
+  for (auto cpu : cpus) {
+    groups.push_back({cpu, -1, -1, 0, 0});
+
+    if (EXIT_SUCCESS != open_group(groups.back())) {
+      fini();
+      init_done = true;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<struct group_reading> readings(groups.size());
+  for (std::size_t i = 0; i < groups.size(); i++) {
+    if (!read_group(groups[i], readings[i])) {
+      fini();
+      init_done = true;
+      errorString = "group read failed in init";
+      return EXIT_FAILURE;
+    }
+  }
+
+  ipc_state.last = readings;
+  freq_state.last = readings;
+
   init_value = EXIT_SUCCESS;
-  init_done = true;
   return EXIT_SUCCESS;
 }
 
-static uint64_t value_from_id(struct read_format *values, uint64_t id) {
-  for (decltype(values->nr) i = 0; i < values->nr; ++i) {
-    if (id == values->values[i].id) {
-      return values->values[i].value;
+// read all groups and calculate the value of every cpu with fn from the
+// difference to the last reading. cpus on which the process was not running
+// are ignored. the value of the metric is calculated by total from the sum of
+// the differences.
+static int32_t get_reading(struct metric_state &state,
+                           double (*fn)(struct group_reading const &),
+                           double (*total)(struct group_reading const &,
+                                           double),
+                           double *value) {
+  if (groups.size() == 0) {
+    return EXIT_FAILURE;
+  }
+
+  struct group_reading sum = {0, 0, 0};
+  double min = 0.0, max = 0.0, mean = 0.0;
+  unsigned count = 0;
+
+  for (std::size_t i = 0; i < groups.size(); i++) {
+    struct group_reading reading;
+
+    if (!read_group(groups[i], reading)) {
+      errorString = "group read failed";
+      return EXIT_FAILURE;
+    }
+
+    struct group_reading diff = {
+        reading.cycles - state.last[i].cycles,
+        reading.instructions - state.last[i].instructions,
+        reading.running - state.last[i].running};
+
+    state.last[i] = reading;
+
+    if (diff.cycles == 0 || diff.running == 0) {
+      continue;
     }
+
+    sum.cycles += diff.cycles;
+    sum.instructions += diff.instructions;
+    sum.running += diff.running;
+
+    double v = fn(diff);
+    min = (count == 0 || v < min) ? v : min;
+    max = (count == 0 || v > max) ? v : max;
+    mean += v;
+    count++;
+  }
+
+  if (count == 0) {
+    return EXIT_FAILURE;
+  }
+
+  state.submetrics[0] = min;
+  state.submetrics[1] = max;
+  state.submetrics[2] = mean / count;
+
+  if (value != nullptr) {
+    *value = total(sum, state.submetrics[2]);
   }
 
-  return 0;
+  return EXIT_SUCCESS;
+}
+
+static double ipc(struct group_reading const &diff) {
+  return (double)diff.instructions / (double)diff.cycles;
 }
 
-static int32_t get_reading(double *ipc_value, double *freq_value) {
+// the frequency while the process was running on a cpu in GHz
+static double freq(struct group_reading const &diff) {
+  return (double)diff.cycles / (double)diff.running;
+}
 
-  if (cpu_cycles_fd < 0 || instructions_fd < 0) {
-    fini();
+static int32_t get_reading_ipc(double *value) {
+  return get_reading(
+      ipc_state, ipc,
+      [](struct group_reading const &sum, double) { return ipc(sum); }, value);
+}
+
+static int32_t get_reading_freq(double *value) {
+  return get_reading(
+      freq_state, freq, [](struct group_reading const &, double mean) {
+        return mean;
+      },
+      value);
+}
+
+static const char **get_submetric_names(void) { return submetricNames; }
+
+static int32_t get_submetric_readings_ipc(double *values) {
+  std::memcpy(values, ipc_state.submetrics, sizeof(ipc_state.submetrics));
+  return EXIT_SUCCESS;
+}
+
+static int32_t get_submetric_readings_freq(double *values) {
+  std::memcpy(values, freq_state.submetrics, sizeof(freq_state.submetrics));
+  return EXIT_SUCCESS;
+}
+
+static const char *get_error(void) {
+  const char *errorCString = errorString.c_str();
+  return errorCString;
+}
+
+void perf_metric_set_cpus(const int *cpus, uint32_t count) {
+  groupCpus.assign(cpus, cpus + count);
+}
+
+int32_t perf_events_metric_set_events(const char *eventList) {
+  events.clear();
+  eventsErrorString = "";
+
+  std::stringstream ss(eventList);
+  std::string token;
+
+  while (std::getline(ss, token, ',')) {
+    struct event_def def;
+    def.name = token;
+    def.fd = -1;
+    def.last = 0.0;
+    def.value = 0.0;
+
+    auto pos = token.find('=');
+    if (pos != std::string::npos) {
+      // NAME=rCODE with a raw event code in hex
+      def.name = token.substr(0, pos);
+      auto code = token.substr(pos + 1);
+      char *end;
+      uint64_t config = 0;
+
+      if (code.size() > 1 && code[0] == 'r') {
+        config = std::strtoull(code.c_str() + 1, &end, 16);
+      }
+
+      if (def.name.empty() || code.size() < 2 || code[0] != 'r' ||
+          *end != '\0') {
+        eventsErrorString = "Invalid raw event \"" + token +
+                            "\", expected NAME=rCODE with CODE in hex";
+        events.clear();
+        return EXIT_FAILURE;
+      }
+
+      init_attr(def.attr, PERF_TYPE_RAW, config);
+    } else {
+      bool found = false;
+      for (auto const &event : genericEvents) {
+        if (token == event.name) {
+          init_attr(def.attr, PERF_TYPE_HARDWARE, event.config);
+          found = true;
+          break;
+        }
+      }
+
+      if (!found) {
+        eventsErrorString = "Unknown event \"" + token + "\"";
+        events.clear();
+        return EXIT_FAILURE;
+      }
+    }
+
+    def.attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    events.push_back(def);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// read the count of an event scaled by the time it was scheduled on the pmu
+static bool read_event(struct event_def const &def, double &value) {
+  struct event_read_format values;
+
+  if (0 >= read(def.fd, &values, sizeof(values))) {
+    return false;
+  }
+
+  value = values.time_running == 0
+              ? 0.0
+              : (double)values.value * (double)values.time_enabled /
+                    (double)values.time_running;
+
+  return true;
+}
+
+static int32_t events_fini(void) {
+  for (auto &def : events) {
+    if (!(def.fd < 0)) {
+      close(def.fd);
+      def.fd = -1;
+    }
+  }
+  eventNames.clear();
+  return EXIT_SUCCESS;
+}
+
+static int32_t events_init(void) {
+  eventsErrorString = "";
+
+  if (events.size() == 0) {
+    eventsErrorString = "No events selected with --perf-events";
     return EXIT_FAILURE;
   }
 
-  struct read_format read_values;
+  for (auto &def : events) {
+    // measure the calling process/thread and its children on any cpu
+    if ((def.fd = perf_event_open(&def.attr, 0, -1, -1, 0)) < 0 ||
+        !read_event(def, def.last)) {
+      eventsErrorString = "perf_event_open failed for event " + def.name;
+      events_fini();
+      return EXIT_FAILURE;
+    }
+
+    eventNames.push_back(def.name.c_str());
+  }
+  eventNames.push_back(nullptr);
+
+  eventsLastTime = std::chrono::steady_clock::now();
+
+  return EXIT_SUCCESS;
+}
+
+// the value of the metric is the sum of all events per second
+static int32_t events_get_reading(double *value) {
+  auto now = std::chrono::steady_clock::now();
+  double seconds =
+      std::chrono::duration_cast<std::chrono::duration<double>>(
+          now - eventsLastTime)
+          .count();
+  double sum = 0.0;
 
-  if (0 == read(cpu_cycles_fd, &read_values, sizeof(read_values))) {
-    fini();
-    errorString = "group read failed";
+  if (events.size() == 0 || seconds <= 0.0) {
     return EXIT_FAILURE;
   }
 
-  if (ipc_value != nullptr) {
-    uint64_t diff[2];
-    diff[0] = value_from_id(&read_values, instructions_id) -
-              value_from_id(&last, instructions_id);
-    diff[1] = value_from_id(&read_values, cpu_cycles_id) -
-              value_from_id(&last, cpu_cycles_id);
+  for (auto &def : events) {
+    double reading;
 
-    std::memcpy(&last, &read_values, sizeof(last));
+    if (!read_event(def, reading)) {
+      eventsErrorString = "read failed for event " + def.name;
+      return EXIT_FAILURE;
+    }
 
-    *ipc_value = (double)diff[0] / (double)diff[1];
+    def.value = (reading - def.last) / seconds;
+    def.last = reading;
+    sum += def.value;
   }
 
-  if (freq_value != nullptr) {
-    *freq_value = (double)value_from_id(&read_values, cpu_cycles_id) / 1e9;
+  eventsLastTime = now;
+
+  if (value != nullptr) {
+    *value = sum;
   }
 
   return EXIT_SUCCESS;
 }
 
-static int32_t get_reading_ipc(double *value) {
-  return get_reading(value, nullptr);
+static const char **events_get_submetric_names(void) {
+  return eventNames.data();
 }
 
-static int32_t get_reading_freq(double *value) {
-  return get_reading(nullptr, value);
+static int32_t events_get_submetric_readings(double *values) {
+  for (std::size_t i = 0; i < events.size(); i++) {
+    values[i] = events[i].value;
+  }
+  return EXIT_SUCCESS;
 }
 
-static const char *get_error(void) {
-  const char *errorCString = errorString.c_str();
+static const char *events_get_error(void) {
+  const char *errorCString = eventsErrorString.c_str();
   return errorCString;
 }
 }
@@ -248,6 +579,7 @@ metric_interface_t perf_ipc_metric = {
              .divide_by_thread_count = 0,
              .insert_callback = 0,
              .ignore_start_stop_delta = 0,
+             .submetrics = 1,
              .__reserved = 0},
     .unit = "IPC",
     .callback_time = 0,
@@ -257,15 +589,18 @@ metric_interface_t perf_ipc_metric = {
     .get_reading = get_reading_ipc,
     .get_error = get_error,
     .register_insert_callback = nullptr,
+    .get_submetric_names = get_submetric_names,
+    .get_submetric_readings = get_submetric_readings_ipc,
 };
 
 metric_interface_t perf_freq_metric = {
     .name = "perf-freq",
-    .type = {.absolute = 0,
-             .accumalative = 1,
-             .divide_by_thread_count = 1,
+    .type = {.absolute = 1,
+             .accumalative = 0,
+             .divide_by_thread_count = 0,
              .insert_callback = 0,
              .ignore_start_stop_delta = 0,
+             .submetrics = 1,
              .__reserved = 0},
     .unit = "GHz",
     .callback_time = 0,
@@ -275,4 +610,27 @@ metric_interface_t perf_freq_metric = {
     .get_reading = get_reading_freq,
     .get_error = get_error,
     .register_insert_callback = nullptr,
+    .get_submetric_names = get_submetric_names,
+    .get_submetric_readings = get_submetric_readings_freq,
+};
+
+metric_interface_t perf_events_metric = {
+    .name = "perf-events",
+    .type = {.absolute = 1,
+             .accumalative = 0,
+             .divide_by_thread_count = 0,
+             .insert_callback = 0,
+             .ignore_start_stop_delta = 0,
+             .submetrics = 1,
+             .__reserved = 0},
+    .unit = "1/s",
+    .callback_time = 0,
+    .callback = nullptr,
+    .init = events_init,
+    .fini = events_fini,
+    .get_reading = events_get_reading,
+    .get_error = events_get_error,
+    .register_insert_callback = nullptr,
+    .get_submetric_names = events_get_submetric_names,
+    .get_submetric_readings = events_get_submetric_readings,
 };
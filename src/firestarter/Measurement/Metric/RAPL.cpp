@@ -19,11 +19,12 @@
  * Contact: daniel.hackenberg@tu-dresden.de
  *****************************************************************************/
 
+#include <charconv>
 #include <cstdio>
-#include <cstring>
 #include <fstream>
-#include <memory>
+#include <map>
 #include <sstream>
+#include <string>
 #include <vector>
 
 extern "C" {
@@ -31,33 +32,55 @@ extern "C" {
 #include <firestarter/Measurement/MetricInterface.h>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define RAPL_PATH "/sys/class/powercap"
 
 static std::string errorString = "";
 
 struct reader_def {
-  char *path;
-  long long int last_reading;
-  long long int overflow;
-  long long int max;
+  // the name of the submetric
+  std::string name;
+  // energy_uj stays open for the lifetime of the metric
+  int fd;
+  unsigned long long last_reading;
+  unsigned long long overflow;
+  unsigned long long max;
+  // the accumulated energy in J of the last reading
+  double value;
 };
 
-struct reader_def_free {
-  void operator()(struct reader_def *def) {
-    if (def != nullptr) {
-      if (((void *)def->path) != nullptr) {
-        free((void *)def->path);
-      }
-      free((void *)def);
-    }
+static std::vector<struct reader_def> readers = {};
+
+// the index of the psys reader. psys replaces the sum of package and dram
+// if it is available.
+static int psysIndex = -1;
+
+static std::vector<const char *> submetricNames = {};
+
+// read a counter from the start of the file without reopening it
+static bool readCounter(int fd, unsigned long long &value) {
+  char buffer[32];
+
+  auto size = pread(fd, buffer, sizeof(buffer), 0);
+  if (size <= 0) {
+    return false;
   }
-};
 
-static std::vector<std::shared_ptr<struct reader_def>> readers = {};
+  auto result = std::from_chars(buffer, buffer + size, value);
+
+  return result.ec == std::errc();
+}
 
 static int32_t fini(void) {
+  for (auto const &def : readers) {
+    close(def.fd);
+  }
+
   readers.clear();
+  submetricNames.clear();
+  psysIndex = -1;
 
   return EXIT_SUCCESS;
 }
@@ -74,12 +97,11 @@ static int32_t init(void) {
   // we try to find psys first
   // then package + dram
   // and finally package only.
+  // all of them are reported as submetrics.
 
-  // contains an empty path if it is not found
-  std::string psysPath = "";
-
-  // a vector of all paths to package and dram
-  std::vector<std::string> paths = {};
+  // pairs of domain name and path of all psys, package and dram domains
+  std::vector<std::pair<std::string, std::string>> domains = {};
+  std::map<std::string, unsigned> nameCount = {};
 
   struct dirent *dir;
   while ((dir = readdir(raplDir)) != NULL) {
@@ -97,87 +119,68 @@ static int32_t init(void) {
     std::string name;
     std::getline(nameStream, name);
 
-    if (name == "psys") {
-      // found psys
-      psysPath = path.str();
-    } else if (0 == name.rfind("package", 0) || name == "dram") {
-      // find all package and dram
-      paths.push_back(path.str());
+    if (name == "psys" || 0 == name.rfind("package", 0) || name == "dram") {
+      domains.push_back(std::make_pair(name, path.str()));
+      nameCount[name]++;
     }
   }
   closedir(raplDir);
 
-  // make psys the only value if available
-  if (!psysPath.empty()) {
-    paths.clear();
-    paths.push_back(psysPath);
-  }
-
-  // paths now contains all interesting nodes
-
-  if (paths.size() == 0) {
+  if (domains.size() == 0) {
     errorString = "No valid entries in " RAPL_PATH;
     return EXIT_FAILURE;
   }
 
-  for (auto const &path : paths) {
-    std::stringstream energyUjPath;
-    energyUjPath << path << "/energy_uj";
-    std::ifstream energyReadingStream(energyUjPath.str());
-    if (!energyReadingStream.good()) {
-      errorString = "Could not read energy_uj";
-      break;
-    }
+  for (auto const &[name, path] : domains) {
+    std::string energyUjPath = path + "/energy_uj";
+    std::string maxEnergyUjRangePath = path + "/max_energy_range_uj";
 
-    std::stringstream maxEnergyUjRangePath;
-    maxEnergyUjRangePath << path << "/max_energy_range_uj";
-    std::ifstream maxEnergyReadingStream(maxEnergyUjRangePath.str());
-    if (!maxEnergyReadingStream.good()) {
+    int maxFd = open(maxEnergyUjRangePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (maxFd < 0) {
       errorString = "Could not read max_energy_range_uj";
       break;
     }
 
-    unsigned long long reading;
     unsigned long long max;
-    std::string buffer;
-    int read;
+    bool valid = readCounter(maxFd, max);
+    close(maxFd);
 
-    std::getline(energyReadingStream, buffer);
-    read = std::sscanf(buffer.c_str(), "%llu", &reading);
-
-    if (read == 0) {
+    if (!valid) {
       std::stringstream ss;
-      ss << "Contents in file " << energyUjPath.str()
+      ss << "Contents in file " << maxEnergyUjRangePath
          << " do not conform to mask (unsigned long long)";
       errorString = ss.str();
       break;
     }
 
-    std::getline(maxEnergyReadingStream, buffer);
-    read = std::sscanf(buffer.c_str(), "%llu", &max);
+    int fd = open(energyUjPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      errorString = "Could not read energy_uj";
+      break;
+    }
 
-    if (read == 0) {
+    unsigned long long reading;
+    if (!readCounter(fd, reading)) {
+      close(fd);
       std::stringstream ss;
-      ss << "Contents in file " << maxEnergyUjRangePath.str()
+      ss << "Contents in file " << energyUjPath
          << " do not conform to mask (unsigned long long)";
       errorString = ss.str();
       break;
     }
 
-    std::shared_ptr<struct reader_def> def(
-        reinterpret_cast<struct reader_def *>(
-            malloc(sizeof(struct reader_def))),
-        reader_def_free());
-    auto pathName = path.c_str();
-    size_t size = (strlen(pathName) + 1) * sizeof(char);
-    void *name = malloc(size);
-    memcpy(name, pathName, size);
-    def->path = (char *)name;
-    def->max = max;
-    def->last_reading = reading;
-    def->overflow = 0;
-
-    readers.push_back(def);
+    // dram exists once per package. add the name of the directory to make it
+    // unique.
+    std::string submetricName = name;
+    if (nameCount[name] > 1) {
+      submetricName += "@" + path.substr(path.rfind('/') + 1);
+    }
+
+    if (name == "psys") {
+      psysIndex = readers.size();
+    }
+
+    readers.push_back({submetricName, fd, reading, 0, max, 1.0E-6 * reading});
   }
 
   if (errorString.size() != 0) {
@@ -185,6 +188,11 @@ static int32_t init(void) {
     return EXIT_FAILURE;
   }
 
+  for (auto const &def : readers) {
+    submetricNames.push_back(def.name.c_str());
+  }
+  submetricNames.push_back(nullptr);
+
   return EXIT_SUCCESS;
 }
 
@@ -192,23 +200,24 @@ static int32_t get_reading(double *value) {
   double finalReading = 0.0;
 
   for (auto &def : readers) {
-    long long int reading;
-    std::string buffer;
+    unsigned long long reading;
 
-    std::stringstream energyUjPath;
-    energyUjPath << def->path << "/energy_uj";
-    std::ifstream energyReadingStream(energyUjPath.str());
-    std::getline(energyReadingStream, buffer);
-    std::sscanf(buffer.c_str(), "%llu", &reading);
+    if (!readCounter(def.fd, reading)) {
+      return EXIT_FAILURE;
+    }
 
-    if (reading < def->last_reading) {
-      def->overflow += 1;
+    if (reading < def.last_reading) {
+      def.overflow += 1;
     }
 
-    def->last_reading = reading;
+    def.last_reading = reading;
+    def.value = 1.0E-6 * (double)(def.overflow * def.max + def.last_reading);
 
-    finalReading +=
-        1.0E-6 * (double)(def->overflow * def->max + def->last_reading);
+    finalReading += def.value;
+  }
+
+  if (psysIndex != -1) {
+    finalReading = readers[psysIndex].value;
   }
 
   if (value != nullptr) {
@@ -218,6 +227,16 @@ static int32_t get_reading(double *value) {
   return EXIT_SUCCESS;
 }
 
+static const char **get_submetric_names(void) { return submetricNames.data(); }
+
+static int32_t get_submetric_readings(double *values) {
+  for (std::size_t i = 0; i < readers.size(); i++) {
+    values[i] = readers[i].value;
+  }
+
+  return EXIT_SUCCESS;
+}
+
 static const char *get_error(void) {
   const char *errorCString = errorString.c_str();
   return errorCString;
@@ -235,6 +254,7 @@ metric_interface_t rapl_metric = {
              .divide_by_thread_count = 0,
              .insert_callback = 0,
              .ignore_start_stop_delta = 0,
+             .submetrics = 1,
              .__reserved = 0},
     .unit = "J",
     .callback_time = 30000000,
@@ -244,4 +264,6 @@ metric_interface_t rapl_metric = {
     .get_reading = get_reading,
     .get_error = get_error,
     .register_insert_callback = nullptr,
+    .get_submetric_names = get_submetric_names,
+    .get_submetric_readings = get_submetric_readings,
 };
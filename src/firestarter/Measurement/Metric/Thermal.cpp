@@ -0,0 +1,236 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <firestarter/Measurement/Metric/Thermal.h>
+#include <firestarter/Measurement/MetricInterface.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define HWMON_PATH "/sys/class/hwmon"
+#define THERMAL_PATH "/sys/class/thermal"
+
+static std::string errorString = "";
+
+// the open files with temperatures in millidegree Celsius
+static std::vector<int> sensors = {};
+
+// names of hwmon devices and types of thermal zones that measure the cpu
+static const std::vector<std::string> cpuSensorNames = {
+    "coretemp", "k10temp", "zenpower", "cpu_thermal", "x86_pkg_temp"};
+
+static bool isCpuSensor(std::string const &name) {
+  for (auto const &cpuSensorName : cpuSensorNames) {
+    if (name == cpuSensorName) {
+      return true;
+    }
+  }
+  return 0 == name.rfind("cpu", 0);
+}
+
+static std::string readFirstLine(std::string const &path) {
+  std::ifstream stream(path);
+  std::string line;
+
+  if (stream.good()) {
+    std::getline(stream, line);
+  }
+
+  return line;
+}
+
+// read a temperature from the start of the file without reopening it
+static bool readTemperature(int fd, double &value) {
+  char buffer[32];
+  long long reading;
+
+  auto size = pread(fd, buffer, sizeof(buffer), 0);
+  if (size <= 0) {
+    return false;
+  }
+
+  auto result = std::from_chars(buffer, buffer + size, reading);
+  if (result.ec != std::errc()) {
+    return false;
+  }
+
+  value = 1.0E-3 * (double)reading;
+  return true;
+}
+
+// add the sensors found in the subdirectories of path. the name of each
+// subdirectory is read from nameFile. returns the sensors of the cpu in
+// cpuPaths and all others in otherPaths.
+static void findSensors(std::string const &path, std::string const &prefix,
+                        std::string const &nameFile, bool hwmon,
+                        std::vector<std::string> &cpuPaths,
+                        std::vector<std::string> &otherPaths) {
+  DIR *baseDir = opendir(path.c_str());
+  if (baseDir == NULL) {
+    return;
+  }
+
+  struct dirent *dir;
+  while ((dir = readdir(baseDir)) != NULL) {
+    std::string name(dir->d_name);
+
+    if (0 != name.rfind(prefix, 0)) {
+      continue;
+    }
+
+    std::stringstream devicePath;
+    devicePath << path << "/" << name;
+
+    auto deviceName = readFirstLine(devicePath.str() + "/" + nameFile);
+    auto &paths = isCpuSensor(deviceName) ? cpuPaths : otherPaths;
+
+    if (!hwmon) {
+      paths.push_back(devicePath.str() + "/temp");
+      continue;
+    }
+
+    // a hwmon device has temp1_input, temp2_input, ...
+    DIR *deviceDir = opendir(devicePath.str().c_str());
+    if (deviceDir == NULL) {
+      continue;
+    }
+
+    struct dirent *file;
+    while ((file = readdir(deviceDir)) != NULL) {
+      std::string fileName(file->d_name);
+      auto suffix = std::string("_input");
+
+      if (0 == fileName.rfind("temp", 0) && fileName.size() > suffix.size() &&
+          0 == fileName.compare(fileName.size() - suffix.size(),
+                                suffix.size(), suffix)) {
+        paths.push_back(devicePath.str() + "/" + fileName);
+      }
+    }
+    closedir(deviceDir);
+  }
+  closedir(baseDir);
+}
+
+static int32_t fini(void) {
+  for (auto fd : sensors) {
+    close(fd);
+  }
+
+  sensors.clear();
+
+  return EXIT_SUCCESS;
+}
+
+static int32_t init(void) {
+  errorString = "";
+
+  std::vector<std::string> cpuPaths = {};
+  std::vector<std::string> otherPaths = {};
+
+  findSensors(HWMON_PATH, "hwmon", "name", true, cpuPaths, otherPaths);
+  findSensors(THERMAL_PATH, "thermal_zone", "type", false, cpuPaths,
+              otherPaths);
+
+  // only use the sensors of the cpu if there are any
+  auto const &paths = cpuPaths.empty() ? otherPaths : cpuPaths;
+
+  for (auto const &path : paths) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      continue;
+    }
+
+    double value;
+    if (!readTemperature(fd, value)) {
+      close(fd);
+      continue;
+    }
+
+    sensors.push_back(fd);
+  }
+
+  if (sensors.size() == 0) {
+    errorString = "No readable temperature in " HWMON_PATH " or " THERMAL_PATH;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// the hottest sensor determines the value
+static int32_t get_reading(double *value) {
+  bool found = false;
+  double maxReading = 0.0;
+
+  for (auto fd : sensors) {
+    double reading;
+
+    if (readTemperature(fd, reading) && (!found || reading > maxReading)) {
+      maxReading = reading;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    return EXIT_FAILURE;
+  }
+
+  if (value != nullptr) {
+    *value = maxReading;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static const char *get_error(void) {
+  const char *errorCString = errorString.c_str();
+  return errorCString;
+}
+}
+
+metric_interface_t thermal_metric = {
+    .name = "sysfs-thermal",
+    .type = {.absolute = 1,
+             .accumalative = 0,
+             .divide_by_thread_count = 0,
+             .insert_callback = 0,
+             .ignore_start_stop_delta = 0,
+             .submetrics = 0,
+             .__reserved = 0},
+    .unit = "C",
+    .callback_time = 0,
+    .callback = nullptr,
+    .init = init,
+    .fini = fini,
+    .get_reading = get_reading,
+    .get_error = get_error,
+    .register_insert_callback = nullptr,
+    .get_submetric_names = nullptr,
+    .get_submetric_readings = nullptr,
+};
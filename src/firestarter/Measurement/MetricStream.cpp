@@ -0,0 +1,258 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/Measurement/MetricStream.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+using namespace firestarter::measurement;
+
+namespace {
+const std::string UNIX_PREFIX = "unix:";
+const char BINARY_MAGIC[8] = {'F', 'S', 'S', 'T', 'R', 'E', 'A', 'M'};
+const uint32_t BINARY_VERSION = 1;
+
+enum RecordType : uint8_t { METRIC = 0, VALUE = 1, EVENT = 2 };
+} // namespace
+
+int MetricStream::parseFormat(std::string const &name, Format &format) {
+  if (name == "csv") {
+    format = Format::CSV;
+  } else if (name == "jsonl") {
+    format = Format::JSONL;
+  } else if (name == "binary") {
+    format = Format::Binary;
+  } else {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+MetricStream::MetricStream(std::string const &destination, Format format)
+    : _destination(destination), _format(format) {}
+
+MetricStream::~MetricStream() {
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+bool MetricStream::isPipe() const {
+  struct stat st;
+  return _destination.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) != 0 &&
+         stat(_destination.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+int MetricStream::open() {
+  if (_destination.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0) {
+    auto path = _destination.substr(UNIX_PREFIX.size());
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      _error = "Invalid socket path " + path;
+      return EXIT_FAILURE;
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_fd >= 0 && connect(_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                            sizeof(addr)) != 0) {
+      close(_fd);
+      _fd = -1;
+    }
+  } else if (isPipe()) {
+    // do not block without a reader, so the caller can stop waiting
+    _fd = ::open(_destination.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (_fd < 0 && errno == ENXIO) {
+      return EXIT_FAILURE;
+    }
+    if (_fd >= 0) {
+      fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_NONBLOCK);
+    }
+  } else {
+    _fd = ::open(_destination.c_str(),
+                 O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  }
+
+  if (_fd < 0) {
+    _error = "Could not open " + _destination + ": " + std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  switch (_format) {
+  case Format::CSV:
+    _buffer.append("time,type,name,value\n");
+    break;
+  case Format::JSONL:
+    break;
+  case Format::Binary:
+    _buffer.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    append(BINARY_VERSION);
+    break;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+void MetricStream::appendString(std::string const &value) {
+  auto length = static_cast<uint16_t>(std::min<std::size_t>(value.size(),
+                                                            UINT16_MAX));
+  append(length);
+  _buffer.append(value.data(), length);
+}
+
+void MetricStream::appendJsonString(std::string const &value) {
+  _buffer.push_back('"');
+  for (auto c : value) {
+    if (c == '"' || c == '\\') {
+      _buffer.push_back('\\');
+      _buffer.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      _buffer.append(escaped);
+    } else {
+      _buffer.push_back(c);
+    }
+  }
+  _buffer.push_back('"');
+}
+
+void MetricStream::addMetric(std::size_t id, std::string const &name) {
+  if (_names.size() <= id) {
+    _names.resize(id + 1);
+  }
+  _names[id] = name;
+
+  if (_format == Format::Binary) {
+    append(static_cast<uint8_t>(METRIC));
+    append(static_cast<uint32_t>(id));
+    appendString(name);
+  }
+}
+
+void MetricStream::addValue(std::size_t id, TimeValue const &value) {
+  int64_t time = value.time.time_since_epoch().count();
+  char line[64];
+
+  switch (_format) {
+  case Format::CSV:
+    std::snprintf(line, sizeof(line), "%ld,metric,", time);
+    _buffer.append(line);
+    _buffer.append(_names[id]);
+    std::snprintf(line, sizeof(line), ",%.15g\n", value.value);
+    _buffer.append(line);
+    break;
+  case Format::JSONL:
+    std::snprintf(line, sizeof(line), "{\"time\":%ld,\"metric\":", time);
+    _buffer.append(line);
+    appendJsonString(_names[id]);
+    // json has no representation of nan and inf
+    if (std::isfinite(value.value)) {
+      std::snprintf(line, sizeof(line), ",\"value\":%.15g}\n", value.value);
+      _buffer.append(line);
+    } else {
+      _buffer.append(",\"value\":null}\n");
+    }
+    break;
+  case Format::Binary:
+    append(static_cast<uint8_t>(VALUE));
+    append(static_cast<uint32_t>(id));
+    append(time);
+    append(value.value);
+    break;
+  }
+}
+
+void MetricStream::addEvent(int64_t time, std::string const &name,
+                            std::string const &value) {
+  char line[64];
+
+  switch (_format) {
+  case Format::CSV:
+    std::snprintf(line, sizeof(line), "%ld,event,", time);
+    _buffer.append(line);
+    _buffer.append(name);
+    _buffer.push_back(',');
+    // the value may contain commas and quotes
+    _buffer.push_back('"');
+    for (auto c : value) {
+      if (c == '"') {
+        _buffer.push_back('"');
+      }
+      _buffer.push_back(c);
+    }
+    _buffer.append("\"\n");
+    break;
+  case Format::JSONL:
+    std::snprintf(line, sizeof(line), "{\"time\":%ld,\"event\":", time);
+    _buffer.append(line);
+    appendJsonString(name);
+    _buffer.append(",\"value\":");
+    appendJsonString(value);
+    _buffer.append("}\n");
+    break;
+  case Format::Binary:
+    append(static_cast<uint8_t>(EVENT));
+    append(time);
+    appendString(name);
+    appendString(value);
+    break;
+  }
+}
+
+int MetricStream::flush() {
+  const char *data = _buffer.data();
+  std::size_t size = _buffer.size();
+
+  while (size > 0) {
+    auto count = write(_fd, data, size);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      _error = "Could not write to " + _destination + ": " +
+               std::strerror(errno);
+      _buffer.clear();
+      return EXIT_FAILURE;
+    }
+    data += count;
+    size -= count;
+  }
+
+  _buffer.clear();
+
+  return EXIT_SUCCESS;
+}
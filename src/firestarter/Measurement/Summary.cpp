@@ -32,74 +32,83 @@ Summary Summary::calculate(std::vector<TimeValue>::iterator begin,
                            std::vector<TimeValue>::iterator end,
                            metric_type_t metricType,
                            unsigned long long numThreads) {
-  std::vector<TimeValue> values = {};
-
-  // TODO: i would really like to make this code a bit more readable, but i
-  // could not find a way yet.
-  if (metricType.accumalative) {
-    TimeValue prev;
-
-    if (begin != end) {
-      prev = *begin++;
-      for (auto it = begin; it != end; ++it) {
-        auto time_diff =
-            1e-6 *
-            (double)std::chrono::duration_cast<std::chrono::microseconds>(
-                it->time - prev.time)
-                .count();
-        auto value_diff = it->value - prev.value;
-
-        double value = value_diff / time_diff;
-
-        if (metricType.divide_by_thread_count) {
-          value /= numThreads;
-        }
-
-        values.push_back(TimeValue(prev.time, value));
-        prev = *it;
-      }
-    }
-  } else if (metricType.absolute) {
-    for (auto it = begin; it != end; ++it) {
-      double value = it->value;
+  assert(metricType.accumalative || metricType.absolute);
+
+  StreamingSummary summary(metricType, numThreads);
+
+  for (auto it = begin; it != end; ++it) {
+    summary.push(*it);
+  }
+
+  return summary.summary();
+}
 
-      if (metricType.divide_by_thread_count) {
-        value /= numThreads;
-      }
+void StreamingSummary::push(TimeValue const &tv) {
+  if (_metricType.accumalative) {
+    if (_hasPrevious) {
+      auto time_diff =
+          1e-6 * (double)std::chrono::duration_cast<std::chrono::microseconds>(
+                     tv.time - _previous.time)
+                     .count();
+      auto value_diff = tv.value - _previous.value;
 
-      values.push_back(TimeValue(it->time, value));
+      add(_previous.time, value_diff / time_diff);
     }
+
+    _previous = tv;
+    _hasPrevious = true;
+  } else if (_metricType.absolute) {
+    add(tv.time, tv.value);
   } else {
     assert(false);
   }
+}
 
-  begin = values.begin();
-  end = values.end();
+void StreamingSummary::add(std::chrono::high_resolution_clock::time_point time,
+                           double value) {
+  if (_metricType.divide_by_thread_count) {
+    value /= _numThreads;
+  }
 
+  // a single NaN or infinite value would make every statistic non-finite
+  if (!std::isfinite(value)) {
+    return;
+  }
+
+  if (_count == 0) {
+    _first = time;
+    _min = value;
+    _max = value;
+  }
+
+  _last = time;
+  _count++;
+
+  double delta = value - _mean;
+  _mean += delta / _count;
+  _m2 += delta * (value - _mean);
+
+  _min = value < _min ? value : _min;
+  _max = value > _max ? value : _max;
+
+  _sketch.add(value);
+}
+
+Summary StreamingSummary::summary() const {
   Summary summary{};
 
-  summary.num_timepoints = std::distance(begin, end);
+  summary.num_timepoints = _count;
 
   if (summary.num_timepoints > 0) {
-
-    auto last = begin;
-    std::advance(last, summary.num_timepoints - 1);
-    summary.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-        last->time - begin->time);
-
-    auto sum_over_nths = [&begin, end, summary](auto fn) {
-      double acc = 0.0;
-      for (auto it = begin; it != end; ++it) {
-        acc += fn(it->value);
-      }
-      return acc / summary.num_timepoints;
-    };
-
-    summary.average = sum_over_nths([](double v) { return v; });
-    summary.stddev = std::sqrt(sum_over_nths([&summary](double v) {
-      double centered = v - summary.average;
-      return centered * centered;
-    }));
+    summary.duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>(_last - _first);
+    summary.average = _mean;
+    summary.stddev = std::sqrt(_m2 / _count);
+    summary.min = _min;
+    summary.max = _max;
+    summary.p50 = _sketch.quantile(0.5);
+    summary.p95 = _sketch.quantile(0.95);
+    summary.p99 = _sketch.quantile(0.99);
   }
 
   return summary;
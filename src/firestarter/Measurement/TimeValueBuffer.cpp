@@ -0,0 +1,243 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/Logging/Log.hpp>
+#include <firestarter/Measurement/TimeValueBuffer.hpp>
+
+#include <algorithm>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+using namespace firestarter::measurement;
+
+TimeValueBuffer::TimeValueBuffer(std::size_t capacity,
+                                 std::string const &spillPath)
+    : _capacity(capacity), _entries(new Entry[capacity]),
+      _spillPath(spillPath) {
+  if (!_spillPath.empty()) {
+    _spillFd = open(_spillPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (_spillFd < 0) {
+      log::warn() << "Could not open " << _spillPath
+                  << ". Old values will be overwritten.";
+    }
+  }
+}
+
+TimeValueBuffer::~TimeValueBuffer() {
+  if (_spillFd >= 0) {
+    close(_spillFd);
+    unlink(_spillPath.c_str());
+  }
+}
+
+std::vector<TimeValue> TimeValueBuffer::values(
+    std::chrono::high_resolution_clock::time_point since,
+    std::chrono::high_resolution_clock::time_point until) const {
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto begin = _begin.load(std::memory_order_acquire);
+  auto sinceCount = since.time_since_epoch().count();
+  auto untilCount = until.time_since_epoch().count();
+  auto timeOf = [this](uint64_t index) { return time(index); };
+
+  std::vector<TimeValue> values;
+
+  for (;;) {
+    values.clear();
+
+    uint64_t spilled =
+        _spillFd >= 0 ? _spilled.load(std::memory_order_acquire) : 0;
+    uint64_t head = _head.load(std::memory_order_acquire);
+    uint64_t first =
+        std::max({begin, spilled, head > _capacity ? head - _capacity : 0});
+
+    uint64_t start = search(first, head, sinceCount, false, timeOf);
+    uint64_t stop = search(start, head, untilCount, true, timeOf);
+
+    values.reserve(stop - start);
+    for (uint64_t i = start; i < stop; i++) {
+      auto const &entry = _entries[i % _capacity];
+      values.push_back(TimeValue(
+          Clock::time_point(
+              Clock::duration(entry.time.load(std::memory_order_relaxed))),
+          entry.value.load(std::memory_order_relaxed)));
+    }
+
+    // check if the producer overwrote entries while we searched and copied
+    // them
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newHead = _head.load(std::memory_order_relaxed);
+    uint64_t valid = newHead >= _capacity ? newHead - _capacity + 1 : 0;
+
+    if (first < valid) {
+      if (_spillFd >= 0) {
+        // the entries were moved to the spill file in the meantime
+        continue;
+      }
+      if (start < valid) {
+        values.erase(values.begin(),
+                     values.begin() +
+                         std::min<uint64_t>(valid - start, values.size()));
+      }
+    }
+
+    // the older values are in the spill file
+    if (start == first && begin < first && _spillFd >= 0) {
+      auto spilledTimeOf = [this](uint64_t index) {
+        return spilledTime(index);
+      };
+      auto spilledStart =
+          search(begin, first, sinceCount, false, spilledTimeOf);
+      auto spilledStop =
+          search(spilledStart, first, untilCount, true, spilledTimeOf);
+
+      std::vector<TimeValue> spilledValues;
+      readSpilled(spilledStart, spilledStop, spilledValues);
+      values.insert(values.begin(), spilledValues.begin(), spilledValues.end());
+    }
+
+    return values;
+  }
+}
+
+std::size_t TimeValueBuffer::latest(TimeValue *values,
+                                    std::size_t count) const {
+  using Clock = std::chrono::high_resolution_clock;
+
+  auto begin = _begin.load(std::memory_order_acquire);
+
+  for (;;) {
+    uint64_t head = _head.load(std::memory_order_acquire);
+    uint64_t first = std::max({begin, head > count ? head - count : 0,
+                               head > _capacity ? head - _capacity : 0});
+
+    for (uint64_t i = first; i < head; i++) {
+      auto const &entry = _entries[i % _capacity];
+      values[i - first] = TimeValue(
+          Clock::time_point(
+              Clock::duration(entry.time.load(std::memory_order_relaxed))),
+          entry.value.load(std::memory_order_relaxed));
+    }
+
+    // retry if the producer overwrote entries while we copied them
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newHead = _head.load(std::memory_order_relaxed);
+    uint64_t valid = newHead >= _capacity ? newHead - _capacity + 1 : 0;
+
+    if (first >= valid) {
+      return head - first;
+    }
+  }
+}
+
+int64_t TimeValueBuffer::spilledTime(uint64_t index) const {
+  SpilledEntry entry{0, 0.0};
+  pread(_spillFd, &entry, sizeof(entry), index * sizeof(SpilledEntry));
+  return entry.time;
+}
+
+void TimeValueBuffer::readSpilled(uint64_t begin, uint64_t end,
+                                  std::vector<TimeValue> &values) const {
+  using Clock = std::chrono::high_resolution_clock;
+
+  std::vector<SpilledEntry> entries(end - begin);
+  auto data = reinterpret_cast<char *>(entries.data());
+  std::size_t size = entries.size() * sizeof(SpilledEntry);
+  off_t offset = begin * sizeof(SpilledEntry);
+
+  while (size > 0) {
+    auto count = pread(_spillFd, data, size, offset);
+    if (count <= 0) {
+      entries.resize(entries.size() - size / sizeof(SpilledEntry));
+      break;
+    }
+    data += count;
+    size -= count;
+    offset += count;
+  }
+
+  values.reserve(entries.size());
+  for (auto const &entry : entries) {
+    values.push_back(TimeValue(
+        Clock::time_point(Clock::duration(entry.time)), entry.value));
+  }
+}
+
+void TimeValueBuffer::spill() {
+  if (_spillFd < 0) {
+    return;
+  }
+
+  auto head = _head.load(std::memory_order_acquire);
+  auto spilled = _spilled.load(std::memory_order_relaxed);
+
+  if (head - spilled < _capacity / 2) {
+    return;
+  }
+
+  std::vector<SpilledEntry> entries;
+  entries.reserve(head - spilled);
+  for (uint64_t i = spilled; i < head; i++) {
+    auto const &entry = _entries[i % _capacity];
+    entries.push_back({entry.time.load(std::memory_order_relaxed),
+                       entry.value.load(std::memory_order_relaxed)});
+  }
+
+  auto data = reinterpret_cast<const char *>(entries.data());
+  std::size_t size = entries.size() * sizeof(SpilledEntry);
+  off_t offset = spilled * sizeof(SpilledEntry);
+
+  while (size > 0) {
+    auto count = pwrite(_spillFd, data, size, offset);
+    if (count <= 0) {
+      if (!_spillFailed) {
+        log::warn() << "Could not write to " << _spillPath
+                    << ". New values will be dropped.";
+        _spillFailed = true;
+      }
+      return;
+    }
+    data += count;
+    size -= count;
+    offset += count;
+  }
+
+  // the entries may be overwritten now
+  _spilled.store(head, std::memory_order_release);
+}
+
+uint64_t TimeValueBuffer::lost() const {
+  auto head = _head.load(std::memory_order_acquire);
+  auto begin = _begin.load(std::memory_order_acquire);
+  auto dropped = _dropped.load(std::memory_order_relaxed);
+
+  if (_spillFd >= 0) {
+    return dropped;
+  }
+
+  auto oldest = head > _capacity ? head - _capacity : 0;
+
+  return dropped + (oldest > begin ? oldest - begin : 0);
+}
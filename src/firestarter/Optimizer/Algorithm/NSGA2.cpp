@@ -26,6 +26,7 @@
 #include <firestarter/Optimizer/Util/MultiObjective.hpp>
 
 #include <algorithm>
+#include <sstream>
 #include <stdexcept>
 
 using namespace firestarter::optimizer::algorithm;
@@ -67,6 +68,23 @@ firestarter::optimizer::Population
 NSGA2::evolve(firestarter::optimizer::Population &pop) {
   const auto &prob = pop.problem();
   const auto bounds = prob.getBounds();
+
+  // the state of the last completed generation if we resume from a checkpoint
+  nlohmann::json state = _checkpoint ? _checkpoint->state() : nullptr;
+
+  if (!state.is_null()) {
+    try {
+      // individuals of the population are found in the restored history
+      for (auto const &ind : state["x"]) {
+        pop.append(ind.get<Individual>());
+      }
+    } catch (std::exception const &e) {
+      firestarter::log::error()
+          << "Invalid NSGA2 population in the checkpoint: " << e.what();
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
   auto NP = pop.size();
   auto fevals0 = prob.getFevals();
 
@@ -83,6 +101,47 @@ NSGA2::evolve(firestarter::optimizer::Population &pop) {
   std::iota(shuffle1.begin(), shuffle1.end(), Individual::size_type(0));
   std::iota(shuffle2.begin(), shuffle2.end(), Individual::size_type(0));
 
+  // everything needed to repeat the following generations, so individuals
+  // that were evaluated before an interruption are found in the history
+  auto saveCheckpoint = [&](unsigned generation) {
+    std::stringstream ss;
+    ss << rng;
+
+    nlohmann::json j = nlohmann::json::object();
+    j["generation"] = generation;
+    j["rng"] = ss.str();
+    j["shuffle1"] = shuffle1;
+    j["shuffle2"] = shuffle2;
+    j["x"] = pop.x();
+
+    _checkpoint->save(j);
+  };
+
+  decltype(_gen) firstGen = 1u;
+
+  if (!state.is_null()) {
+    try {
+      std::stringstream ss(state["rng"].get<std::string>());
+      ss >> rng;
+      shuffle1 = state["shuffle1"].get<std::vector<Individual::size_type>>();
+      shuffle2 = state["shuffle2"].get<std::vector<Individual::size_type>>();
+      firstGen = state["generation"].get<unsigned>() + 1u;
+
+      if (ss.fail() || shuffle1.size() != NP || shuffle2.size() != NP) {
+        throw std::invalid_argument("size of the population differs");
+      }
+    } catch (std::exception const &e) {
+      firestarter::log::error()
+          << "Invalid NSGA2 state in the checkpoint: " << e.what();
+      std::exit(EXIT_FAILURE);
+    }
+
+    firestarter::log::info() << "Resuming NSGA2 after generation "
+                             << firstGen - 1u;
+  } else if (_checkpoint) {
+    saveCheckpoint(0);
+  }
+
   {
     std::stringstream ss;
 
@@ -93,7 +152,7 @@ NSGA2::evolve(firestarter::optimizer::Population &pop) {
     firestarter::log::info() << ss.str();
   }
 
-  for (decltype(_gen) gen = 1u; gen <= _gen; ++gen) {
+  for (decltype(_gen) gen = firstGen; gen <= _gen; ++gen) {
     {
       // Print the logs
       std::vector<double> idealPoint = util::ideal(pop.f());
@@ -110,10 +169,6 @@ NSGA2::evolve(firestarter::optimizer::Population &pop) {
     // At each generation we make a copy of the population into popnew
     firestarter::optimizer::Population popnew(pop);
 
-    // We create some pseudo-random permutation of the poulation indexes
-    std::random_shuffle(shuffle1.begin(), shuffle1.end());
-    std::random_shuffle(shuffle2.begin(), shuffle2.end());
-
     // We compute crowding distance and non dominated rank for the current
     // population
     auto fnds_res = util::fast_non_dominated_sorting(pop.f());
@@ -143,35 +198,47 @@ NSGA2::evolve(firestarter::optimizer::Population &pop) {
       }
     }
 
-    // We then loop thorugh all individuals with increment 4 to select two pairs
-    // of parents that will each create 2 new offspring
-    for (decltype(NP) i = 0u; i < NP; i += 4) {
-      // We create two offsprings using the shuffled list 1
-      parent1_idx = util::mo_tournament_selection(shuffle1[i], shuffle1[i + 1],
-                                                  ndr, pop_cd, rng);
-      parent2_idx = util::mo_tournament_selection(
-          shuffle1[i + 2], shuffle1[i + 3], ndr, pop_cd, rng);
-      children = util::sbx_crossover(pop.x()[parent1_idx], pop.x()[parent2_idx],
-                                     _cr, rng);
-      util::polynomial_mutation(children.first, bounds, _m, rng);
-      util::polynomial_mutation(children.second, bounds, _m, rng);
-
-      popnew.append(children.first);
-      popnew.append(children.second);
-
-      // We repeat with the shuffled list 2
-      parent1_idx = util::mo_tournament_selection(shuffle2[i], shuffle2[i + 1],
-                                                  ndr, pop_cd, rng);
-      parent2_idx = util::mo_tournament_selection(
-          shuffle2[i + 2], shuffle2[i + 3], ndr, pop_cd, rng);
-      children = util::sbx_crossover(pop.x()[parent1_idx], pop.x()[parent2_idx],
-                                     _cr, rng);
-      util::polynomial_mutation(children.first, bounds, _m, rng);
-      util::polynomial_mutation(children.second, bounds, _m, rng);
-
-      popnew.append(children.first);
-      popnew.append(children.second);
-    } // popnew now contains 2NP individuals
+    auto createOffspring = [&]() {
+      std::vector<Individual> offspring;
+
+      // We create some pseudo-random permutation of the poulation indexes
+      std::shuffle(shuffle1.begin(), shuffle1.end(), rng);
+      std::shuffle(shuffle2.begin(), shuffle2.end(), rng);
+
+      // We then loop thorugh all individuals with increment 4 to select two
+      // pairs of parents that will each create 2 new offspring
+      for (decltype(NP) i = 0u; i < NP; i += 4) {
+        // We create two offsprings using the shuffled list 1
+        parent1_idx = util::mo_tournament_selection(
+            shuffle1[i], shuffle1[i + 1], ndr, pop_cd, rng);
+        parent2_idx = util::mo_tournament_selection(
+            shuffle1[i + 2], shuffle1[i + 3], ndr, pop_cd, rng);
+        children = util::sbx_crossover(pop.x()[parent1_idx],
+                                       pop.x()[parent2_idx], _cr, rng);
+        util::polynomial_mutation(children.first, bounds, _m, rng);
+        util::polynomial_mutation(children.second, bounds, _m, rng);
+
+        offspring.push_back(children.first);
+        offspring.push_back(children.second);
+
+        // We repeat with the shuffled list 2
+        parent1_idx = util::mo_tournament_selection(
+            shuffle2[i], shuffle2[i + 1], ndr, pop_cd, rng);
+        parent2_idx = util::mo_tournament_selection(
+            shuffle2[i + 2], shuffle2[i + 3], ndr, pop_cd, rng);
+        children = util::sbx_crossover(pop.x()[parent1_idx],
+                                       pop.x()[parent2_idx], _cr, rng);
+        util::polynomial_mutation(children.first, bounds, _m, rng);
+        util::polynomial_mutation(children.second, bounds, _m, rng);
+
+        offspring.push_back(children.first);
+        offspring.push_back(children.second);
+      }
+
+      return offspring;
+    };
+
+    this->addOffspring(popnew, createOffspring);
     // This method returns the sorted N best individuals in the population
     // according to the crowded comparison operator
     best_idx = util::select_best_N_mo(popnew.f(), NP);
@@ -179,7 +246,19 @@ NSGA2::evolve(firestarter::optimizer::Population &pop) {
     for (decltype(NP) i = 0; i < NP; ++i) {
       pop.insert(i, popnew.x()[best_idx[i]], popnew.f()[best_idx[i]]);
     }
+
+    if (_checkpoint) {
+      saveCheckpoint(gen);
+    }
   }
 
   return pop;
 }
+
+void NSGA2::addOffspring(
+    firestarter::optimizer::Population &popnew,
+    std::function<std::vector<Individual>()> const &createOffspring) {
+  for (auto const &child : createOffspring()) {
+    popnew.append(child);
+  } // popnew now contains 2NP individuals
+}
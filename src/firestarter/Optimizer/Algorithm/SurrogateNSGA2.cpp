@@ -0,0 +1,160 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+
+#include <firestarter/Logging/Log.hpp>
+#include <firestarter/Optimizer/Algorithm/SurrogateNSGA2.hpp>
+#include <firestarter/Optimizer/History.hpp>
+#include <firestarter/Optimizer/Util/GaussianProcess.hpp>
+#include <firestarter/Optimizer/Util/MultiObjective.hpp>
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+using namespace firestarter::optimizer::algorithm;
+
+namespace {
+// number of times the offspring of NSGA2 are created per generation
+const unsigned CANDIDATE_ROUNDS = 4;
+// the surrogate is fitted to the latest evaluations only, as fitting is cubic
+// in their number
+const std::size_t MAX_TRAINING_POINTS = 500;
+
+// the proportions of the instruction groups of an individual
+std::vector<double> features(firestarter::optimizer::Individual const &ind) {
+  double sum = 0.0;
+  for (auto const &v : ind) {
+    sum += v;
+  }
+
+  std::vector<double> out(ind.size(), 0.0);
+  if (sum > 0.0) {
+    for (std::size_t i = 0; i < ind.size(); ++i) {
+      out[i] = ind[i] / sum;
+    }
+  }
+
+  return out;
+}
+} // namespace
+
+SurrogateNSGA2::SurrogateNSGA2(unsigned gen, double cr, double m,
+                               unsigned evaluations)
+    : NSGA2(gen, cr, m), _evaluations(evaluations) {
+  if (evaluations == 0) {
+    throw std::invalid_argument("The number of evaluations per generation "
+                                "must be at least 1");
+  }
+}
+
+void SurrogateNSGA2::addOffspring(
+    firestarter::optimizer::Population &popnew,
+    std::function<std::vector<Individual>()> const &createOffspring) {
+  auto const &prob = popnew.problem();
+  auto nobjs = prob.getNobjs();
+
+  std::set<Individual> seen(popnew.x().begin(), popnew.x().end());
+  std::vector<Individual> candidates;
+  unsigned known = 0;
+
+  for (unsigned round = 0; round < CANDIDATE_ROUNDS; ++round) {
+    for (auto const &child : createOffspring()) {
+      if (!seen.insert(child).second) {
+        continue;
+      }
+
+      // offspring evaluated in this or a previous optimization do not cost a
+      // measurement
+      if (History::find(child).has_value() ||
+          History::findPrevious(child).has_value()) {
+        popnew.append(child);
+        ++known;
+      } else {
+        candidates.push_back(child);
+      }
+    }
+  }
+
+  // fit one surrogate per objective to the history
+  auto const &x = History::x();
+  auto const &f = History::f();
+  auto first = x.size() > MAX_TRAINING_POINTS ? x.size() - MAX_TRAINING_POINTS
+                                              : std::size_t(0);
+
+  std::vector<std::vector<double>> points;
+  std::vector<std::vector<double>> values(nobjs);
+  auto addPoint = [&](Individual const &ind, auto const &metrics) {
+    auto fitness = prob.fitness(metrics);
+    if (fitness.size() != nobjs) {
+      return;
+    }
+
+    points.push_back(features(ind));
+    for (std::size_t k = 0; k < nobjs; ++k) {
+      values[k].push_back(fitness[k]);
+    }
+  };
+
+  for (auto i = first; i < x.size(); ++i) {
+    addPoint(x[i], f[i]);
+  }
+
+  // fill the remaining training points with the evaluations of previous
+  // optimizations that were not repeated
+  for (auto const &[ind, metrics] : History::previous()) {
+    if (points.size() >= MAX_TRAINING_POINTS) {
+      break;
+    }
+    if (!History::find(ind).has_value()) {
+      addPoint(ind, metrics);
+    }
+  }
+
+  std::vector<util::GaussianProcess> surrogates(nobjs);
+  for (std::size_t k = 0; k < nobjs; ++k) {
+    surrogates[k].fit(points, values[k]);
+  }
+
+  // the optimistic prediction of the fitness of every candidate
+  std::vector<std::vector<double>> predictions;
+  for (auto const &candidate : candidates) {
+    auto point = features(candidate);
+
+    std::vector<double> prediction;
+    for (auto const &surrogate : surrogates) {
+      auto [mean, stddev] = surrogate.predict(point);
+      prediction.push_back(mean + stddev);
+    }
+
+    predictions.push_back(prediction);
+  }
+
+  auto selected = util::select_best_N_mo(predictions, _evaluations);
+
+  firestarter::log::debug()
+      << "Surrogate: " << candidates.size() + known << " offspring, " << known
+      << " already evaluated, measuring " << selected.size();
+
+  for (auto const &idx : selected) {
+    popnew.append(candidates[idx]);
+  }
+}
@@ -0,0 +1,177 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+
+#include <firestarter/Json/Summary.hpp>
+#include <firestarter/Logging/Log.hpp>
+#include <firestarter/Optimizer/Checkpoint.hpp>
+#include <firestarter/Optimizer/History.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace firestarter::optimizer;
+
+Checkpoint::Checkpoint(std::string const &path, std::string const &algorithm,
+                       std::vector<std::string> const &payloadItems)
+    : _path(path), _algorithm(algorithm), _payloadItems(payloadItems),
+      _seed(std::random_device()()), _state(nullptr) {}
+
+int Checkpoint::load() {
+  using json = nlohmann::json;
+
+  std::ifstream fp(_path);
+
+  if (!fp.is_open()) {
+    if (errno == ENOENT) {
+      firestarter::log::warn() << "Checkpoint " << _path
+                               << " does not exist. Starting a new "
+                                  "optimization.";
+      return EXIT_SUCCESS;
+    }
+    firestarter::log::error()
+        << "Could not open checkpoint " << _path << ": " << strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  json j;
+
+  try {
+    fp >> j;
+
+    if (j["algorithm"].get<std::string>() != _algorithm ||
+        j["payloadItems"].get<std::vector<std::string>>() != _payloadItems) {
+      firestarter::log::error()
+          << "Checkpoint " << _path
+          << " belongs to an optimization with a different algorithm or "
+             "different payload items.";
+      return EXIT_FAILURE;
+    }
+
+    auto const &individuals = j["individuals"];
+    auto const &metrics = j["metrics"];
+
+    if (individuals.size() != metrics.size()) {
+      throw std::invalid_argument("number of individuals and metrics differ");
+    }
+
+    for (std::size_t i = 0; i < individuals.size(); ++i) {
+      History::append(
+          individuals[i].get<Individual>(),
+          metrics[i]
+              .get<std::map<std::string, firestarter::measurement::Summary>>());
+    }
+
+    _seed = j["seed"].get<unsigned>();
+    _state = j["state"];
+  } catch (std::exception const &e) {
+    firestarter::log::error()
+        << "Could not read checkpoint " << _path << ": " << e.what();
+    return EXIT_FAILURE;
+  }
+
+  firestarter::log::info() << "Resuming the optimization from " << _path
+                           << " with " << History::x().size()
+                           << " evaluated individuals.";
+
+  return EXIT_SUCCESS;
+}
+
+void Checkpoint::save(nlohmann::json const &state) {
+  _state = state;
+
+  this->save();
+}
+
+void Checkpoint::save() {
+  using json = nlohmann::json;
+
+  json j = json::object();
+
+  j["algorithm"] = _algorithm;
+  j["payloadItems"] = _payloadItems;
+  j["seed"] = _seed;
+  j["individuals"] = History::x();
+  j["metrics"] = History::f();
+  j["state"] = _state;
+
+  History::syncTrace();
+
+  // write to a temporary file and replace the checkpoint with it, so a
+  // complete checkpoint exists even if we are killed while writing or the
+  // system crashes
+  auto tmpPath = _path + ".tmp";
+  auto data = j.dump();
+
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    firestarter::log::warn() << "Could not write checkpoint " << tmpPath
+                             << ": " << strerror(errno);
+    return;
+  }
+
+  const char *ptr = data.data();
+  std::size_t size = data.size();
+
+  while (size > 0) {
+    auto count = write(fd, ptr, size);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    ptr += count;
+    size -= count;
+  }
+
+  if (size > 0 || 0 != fsync(fd)) {
+    firestarter::log::warn() << "Could not write checkpoint " << tmpPath
+                             << ": " << strerror(errno);
+    close(fd);
+    return;
+  }
+  close(fd);
+
+  if (0 != std::rename(tmpPath.c_str(), _path.c_str())) {
+    firestarter::log::warn() << "Could not replace checkpoint " << _path
+                             << ": " << strerror(errno);
+    return;
+  }
+
+  // sync the directory, so the rename is persistent
+  auto slash = _path.find_last_of('/');
+  auto dir = slash == std::string::npos ? std::string(".")
+                                        : _path.substr(0, slash + 1);
+
+  int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd >= 0) {
+    fsync(dirFd);
+    close(dirFd);
+  }
+}
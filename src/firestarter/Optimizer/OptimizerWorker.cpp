@@ -61,8 +61,19 @@ void *OptimizerWorker::optimizerThread(void *optimizerWorker) {
   // heat the cpu before attempting to optimize
   std::this_thread::sleep_for(_this->_preheat);
 
-  // For NSGA2 we start with a initial population
-  if (_this->_optimizationAlgorithm == "NSGA2") {
+  auto const &checkpoint = _this->_population.checkpoint();
+
+  // the random individuals of the initial population are the same as before
+  // an interruption, so they are found in the restored history
+  if (checkpoint) {
+    _this->_population.seed(checkpoint->seed());
+  }
+
+  // For NSGA2 we start with a initial population, unless the algorithm
+  // resumes with the population restored from the checkpoint
+  if ((_this->_optimizationAlgorithm == "NSGA2" ||
+       _this->_optimizationAlgorithm == "NSGA2-GP") &&
+      !(checkpoint && !checkpoint->state().is_null())) {
     _this->_population.generateInitialPopulation(_this->_individuals);
   }
 
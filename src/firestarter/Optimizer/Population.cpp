@@ -64,6 +64,13 @@ void Population::append(Individual const &ind) {
 
   // check if we already evaluated this individual
   auto optional_metric = History::find(ind);
+  auto known = optional_metric.has_value();
+
+  // or a previous optimization did
+  if (!known) {
+    optional_metric = History::findPrevious(ind);
+  }
+
   if (optional_metric.has_value()) {
     metrics = optional_metric.value();
   } else {
@@ -74,8 +81,12 @@ void Population::append(Individual const &ind) {
 
   this->append(ind, fitness);
 
-  if (!optional_metric.has_value()) {
+  if (!known) {
     History::append(ind, metrics);
+
+    if (_checkpoint) {
+      _checkpoint->save();
+    }
   }
 }
 
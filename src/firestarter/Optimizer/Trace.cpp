@@ -0,0 +1,405 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+#include <firestarter/Logging/Log.hpp>
+#include <firestarter/Optimizer/Trace.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+using namespace firestarter::optimizer;
+
+namespace {
+template <class T> void append(std::string &data, T const &value) {
+  data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void pad(std::string &data) {
+  data.resize((data.size() + 7) / 8 * 8, '\0');
+}
+
+std::size_t padded(std::size_t size) { return (size + 7) / 8 * 8; }
+} // namespace
+
+TraceWriter::~TraceWriter() {
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+int TraceWriter::open(std::string const &path) {
+  _path = path;
+  _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (_fd < 0) {
+    firestarter::log::error()
+        << "Could not open " << path << ": " << std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  std::string header(trace::MAGIC, sizeof(trace::MAGIC));
+  append(header, trace::VERSION);
+  append(header, uint32_t(0));
+
+  if (write(_fd, header.data(), header.size()) !=
+      static_cast<ssize_t>(header.size())) {
+    firestarter::log::error()
+        << "Could not write to " << path << ": " << std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int TraceWriter::resume(std::string const &path, uint64_t individuals) {
+  _path = path;
+  _fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+
+  if (_fd < 0) {
+    firestarter::log::error()
+        << "Could not open " << path << ": " << std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  char header[16];
+  uint32_t version = 0;
+  struct stat st;
+
+  if (pread(_fd, header, sizeof(header), 0) == sizeof(header)) {
+    std::memcpy(&version, header + sizeof(trace::MAGIC), sizeof(version));
+  }
+
+  if (fstat(_fd, &st) != 0 ||
+      std::memcmp(header, trace::MAGIC, sizeof(trace::MAGIC)) != 0 ||
+      version != trace::VERSION) {
+    firestarter::log::error() << path << " is not a trace of version "
+                              << trace::VERSION << ".";
+    return EXIT_FAILURE;
+  }
+
+  // find the end of the individual and the ids of the metrics before it
+  std::map<std::string, uint32_t> metricIds;
+  uint64_t size = st.st_size;
+  uint64_t offset = sizeof(header);
+  uint64_t end = 0;
+  trace::BlockHeader block;
+
+  while (end == 0 &&
+         pread(_fd, &block, sizeof(block), offset) == sizeof(block) &&
+         block.size <= size - offset - sizeof(block)) {
+    auto data = offset + sizeof(block);
+
+    if (block.type == trace::METRIC && block.size >= 8) {
+      uint32_t metric[2];
+      (void)!pread(_fd, metric, sizeof(metric), data);
+      std::string name(std::min<uint64_t>(metric[1], block.size - 8), '\0');
+      (void)!pread(_fd, name.data(), name.size(), data + 8);
+      metricIds[name] = metric[0];
+    } else if (block.type == trace::INDIVIDUAL && block.size >= 8) {
+      uint64_t index;
+      (void)!pread(_fd, &index, sizeof(index), data);
+      if (index + 1 == individuals) {
+        end = data + padded(block.size);
+      }
+    }
+
+    offset = data + padded(block.size);
+  }
+
+  if (end == 0 || ftruncate(_fd, end) != 0 ||
+      lseek(_fd, 0, SEEK_END) < 0) {
+    firestarter::log::error()
+        << path << " does not contain the " << individuals
+        << " individuals of the checkpoint.";
+    return EXIT_FAILURE;
+  }
+
+  _metricIds = metricIds;
+
+  return EXIT_SUCCESS;
+}
+
+void TraceWriter::writeBlock(uint32_t type, std::string const &data) {
+  if (_fd < 0 || _failed) {
+    return;
+  }
+
+  std::string block;
+  block.reserve(sizeof(trace::BlockHeader) + padded(data.size()));
+  append(block, trace::BlockHeader{type, 0, data.size()});
+  block.append(data);
+  pad(block);
+
+  const char *ptr = block.data();
+  std::size_t size = block.size();
+
+  while (size > 0) {
+    auto count = write(_fd, ptr, size);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      firestarter::log::warn() << "Could not write to " << _path << ": "
+                               << std::strerror(errno)
+                               << ". The trace is incomplete.";
+      _failed = true;
+      return;
+    }
+    ptr += count;
+    size -= count;
+  }
+}
+
+void TraceWriter::sync() {
+  if (_fd < 0 || _failed) {
+    return;
+  }
+
+  if (0 != fsync(_fd)) {
+    firestarter::log::warn() << "Could not sync " << _path << ": "
+                             << std::strerror(errno);
+  }
+}
+
+void TraceWriter::writeInfo(std::string const &json) {
+  this->writeBlock(trace::INFO, json);
+}
+
+uint32_t TraceWriter::metricId(std::string const &name) {
+  auto it = _metricIds.find(name);
+  if (it != _metricIds.end()) {
+    return it->second;
+  }
+
+  uint32_t id = _metricIds.size();
+  _metricIds[name] = id;
+
+  std::string data;
+  append(data, id);
+  append(data, static_cast<uint32_t>(name.size()));
+  data.append(name);
+  this->writeBlock(trace::METRIC, data);
+
+  return id;
+}
+
+void TraceWriter::writeIndividual(
+    uint64_t index, std::vector<unsigned> const &individual,
+    std::map<std::string, firestarter::measurement::Summary> const &metrics) {
+  // the ids have to be defined before the block using them
+  std::vector<uint32_t> ids;
+  for (auto const &metric : metrics) {
+    ids.push_back(this->metricId(metric.first));
+  }
+
+  std::string data;
+  append(data, index);
+  append(data, static_cast<uint32_t>(individual.size()));
+  append(data, static_cast<uint32_t>(metrics.size()));
+  for (auto const &item : individual) {
+    append(data, static_cast<uint32_t>(item));
+  }
+  pad(data);
+
+  std::size_t i = 0;
+  for (auto const &[name, summary] : metrics) {
+    (void)name;
+    append(data, trace::Summary{ids[i++], 0, summary.num_timepoints,
+                                summary.duration.count(), summary.average,
+                                summary.stddev, summary.min, summary.max,
+                                summary.p50, summary.p95, summary.p99});
+  }
+
+  this->writeBlock(trace::INDIVIDUAL, data);
+}
+
+void TraceWriter::writeSeries(
+    uint64_t index, std::string const &metric,
+    std::vector<firestarter::measurement::TimeValue> const &values) {
+  auto id = this->metricId(metric);
+
+  std::string data;
+  data.reserve(24 + values.size() * 16);
+  append(data, index);
+  append(data, id);
+  append(data, uint32_t(0));
+  append(data, static_cast<uint64_t>(values.size()));
+  for (auto const &tv : values) {
+    append(data, static_cast<int64_t>(tv.time.time_since_epoch().count()));
+  }
+  for (auto const &tv : values) {
+    append(data, tv.value);
+  }
+
+  this->writeBlock(trace::SERIES, data);
+}
+
+int TraceReader::read(std::string const &path, InfoCallback const &info,
+                      IndividualCallback const &individual,
+                      SeriesCallback const &series) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    _error = "Could not open " + path + ": " + std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 16) {
+    close(fd);
+    _error = path + " is not a trace.";
+    return EXIT_FAILURE;
+  }
+
+  std::size_t size = st.st_size;
+  auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    _error = "Could not map " + path + ": " + std::strerror(errno);
+    return EXIT_FAILURE;
+  }
+
+  auto base = static_cast<const char *>(mapping);
+  uint32_t version;
+  std::memcpy(&version, base + sizeof(trace::MAGIC), sizeof(version));
+
+  if (std::memcmp(base, trace::MAGIC, sizeof(trace::MAGIC)) != 0 ||
+      version != trace::VERSION) {
+    munmap(mapping, size);
+    _error = path + " is not a trace of version " +
+             std::to_string(trace::VERSION) + ".";
+    return EXIT_FAILURE;
+  }
+
+  std::map<uint32_t, std::string> names;
+  std::size_t offset = 16;
+
+  while (offset + sizeof(trace::BlockHeader) <= size) {
+    auto header = reinterpret_cast<const trace::BlockHeader *>(base + offset);
+    auto data = base + offset + sizeof(trace::BlockHeader);
+
+    if (header->size > size - offset - sizeof(trace::BlockHeader)) {
+      break;
+    }
+
+    // the counts in a block must not point past its end
+    auto words = reinterpret_cast<const uint32_t *>(data);
+    bool valid = true;
+    switch (header->type) {
+    case trace::METRIC:
+      valid = header->size >= 8 && words[1] <= header->size - 8;
+      break;
+    case trace::INDIVIDUAL:
+      valid = header->size >= 16 &&
+              padded((uint64_t)words[2] * sizeof(uint32_t)) +
+                      (uint64_t)words[3] * sizeof(trace::Summary) <=
+                  header->size - 16;
+      break;
+    case trace::SERIES:
+      valid = header->size >= 24 &&
+              *reinterpret_cast<const uint64_t *>(data + 16) <=
+                  (header->size - 24) / (sizeof(int64_t) + sizeof(double));
+      break;
+    default:
+      break;
+    }
+
+    if (!valid) {
+      munmap(mapping, size);
+      _error = path + " has a corrupt block at offset " +
+               std::to_string(offset) + ".";
+      return EXIT_FAILURE;
+    }
+
+    switch (header->type) {
+    case trace::INFO:
+      if (info) {
+        info(std::string(data, header->size));
+      }
+      break;
+    case trace::METRIC: {
+      auto id = reinterpret_cast<const uint32_t *>(data)[0];
+      auto length = reinterpret_cast<const uint32_t *>(data)[1];
+      names[id] = std::string(data + 8, length);
+      break;
+    }
+    case trace::INDIVIDUAL: {
+      if (!individual) {
+        break;
+      }
+      auto index = *reinterpret_cast<const uint64_t *>(data);
+      auto items = reinterpret_cast<const uint32_t *>(data + 8)[0];
+      auto count = reinterpret_cast<const uint32_t *>(data + 8)[1];
+      auto item = reinterpret_cast<const uint32_t *>(data + 16);
+      auto summary = reinterpret_cast<const trace::Summary *>(
+          data + 16 + padded(items * sizeof(uint32_t)));
+
+      std::map<std::string, firestarter::measurement::Summary> metrics;
+      for (uint32_t i = 0; i < count; i++) {
+        auto const &s = summary[i];
+        metrics[names[s.metric]] = firestarter::measurement::Summary{
+            s.numTimepoints,
+            std::chrono::milliseconds(s.durationMs),
+            s.average,
+            s.stddev,
+            s.min,
+            s.max,
+            s.p50,
+            s.p95,
+            s.p99};
+      }
+
+      individual(index, std::vector<unsigned>(item, item + items), metrics);
+      break;
+    }
+    case trace::SERIES: {
+      if (!series) {
+        break;
+      }
+      auto index = *reinterpret_cast<const uint64_t *>(data);
+      auto id = reinterpret_cast<const uint32_t *>(data + 8)[0];
+      auto count = *reinterpret_cast<const uint64_t *>(data + 16);
+      auto times = reinterpret_cast<const int64_t *>(data + 24);
+      auto values = reinterpret_cast<const double *>(data + 24 + count * 8);
+
+      series(index, names[id], count, times, values);
+      break;
+    }
+    default:
+      // skip unknown blocks
+      break;
+    }
+
+    offset += sizeof(trace::BlockHeader) + padded(header->size);
+  }
+
+  munmap(mapping, size);
+
+  return EXIT_SUCCESS;
+}
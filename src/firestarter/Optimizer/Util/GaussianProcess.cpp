@@ -0,0 +1,186 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+
+#include <firestarter/Optimizer/Util/GaussianProcess.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace firestarter::optimizer::util;
+
+namespace {
+double squaredDistance(std::vector<double> const &a,
+                       std::vector<double> const &b) {
+  assert(a.size() == b.size());
+
+  double sum = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    sum += (a[i] - b[i]) * (a[i] - b[i]);
+  }
+  return sum;
+}
+} // namespace
+
+void GaussianProcess::fit(std::vector<std::vector<double>> const &x,
+                          std::vector<double> const &y) {
+  assert(x.size() == y.size());
+
+  auto n = x.size();
+
+  _x = x;
+  _l.clear();
+  _alpha.clear();
+
+  if (n == 0) {
+    return;
+  }
+
+  // normalize the values
+  _mean = 0.0;
+  for (auto const &v : y) {
+    _mean += v;
+  }
+  _mean /= n;
+
+  double variance = 0.0;
+  for (auto const &v : y) {
+    variance += (v - _mean) * (v - _mean);
+  }
+  variance /= n;
+  _scale = variance > 0.0 ? std::sqrt(variance) : 1.0;
+
+  // the median distance between the points is the length scale
+  std::vector<double> distances;
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = i + 1; j < n; ++j) {
+      auto d = squaredDistance(x[i], x[j]);
+      if (d > 0.0) {
+        distances.push_back(d);
+      }
+    }
+  }
+  if (!distances.empty()) {
+    auto median = distances.begin() + distances.size() / 2;
+    std::nth_element(distances.begin(), median, distances.end());
+    _lengthScale = std::sqrt(*median);
+  } else {
+    _lengthScale = 1.0;
+  }
+
+  // cholesky decomposition of the kernel matrix. increase the noise if it is
+  // not positive definite, e.g. because of duplicate points.
+  for (double noise = 1e-2; noise <= 1.0; noise *= 10.0) {
+    _noise = noise;
+    _l.assign(n, std::vector<double>(n, 0.0));
+
+    bool positiveDefinite = true;
+
+    for (std::size_t i = 0; i < n && positiveDefinite; ++i) {
+      for (std::size_t j = 0; j <= i; ++j) {
+        double sum = kernel(x[i], x[j]) + (i == j ? _noise : 0.0);
+        for (std::size_t k = 0; k < j; ++k) {
+          sum -= _l[i][k] * _l[j][k];
+        }
+
+        if (i == j) {
+          if (sum <= 0.0) {
+            positiveDefinite = false;
+            break;
+          }
+          _l[i][i] = std::sqrt(sum);
+        } else {
+          _l[i][j] = sum / _l[j][j];
+        }
+      }
+    }
+
+    if (positiveDefinite) {
+      break;
+    }
+  }
+
+  // alpha = L^T \ (L \ y)
+  std::vector<double> normalized(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    normalized[i] = (y[i] - _mean) / _scale;
+  }
+
+  auto z = solveLower(normalized);
+
+  _alpha.assign(n, 0.0);
+  for (std::size_t i = n; i-- > 0;) {
+    double sum = z[i];
+    for (std::size_t k = i + 1; k < n; ++k) {
+      sum -= _l[k][i] * _alpha[k];
+    }
+    _alpha[i] = sum / _l[i][i];
+  }
+}
+
+std::pair<double, double>
+GaussianProcess::predict(std::vector<double> const &x) const {
+  if (_x.empty()) {
+    return {_mean, _scale};
+  }
+
+  std::vector<double> k(_x.size());
+  for (std::size_t i = 0; i < _x.size(); ++i) {
+    k[i] = kernel(_x[i], x);
+  }
+
+  double mean = 0.0;
+  for (std::size_t i = 0; i < _x.size(); ++i) {
+    mean += k[i] * _alpha[i];
+  }
+
+  auto v = solveLower(k);
+
+  double variance = 1.0;
+  for (auto const &value : v) {
+    variance -= value * value;
+  }
+
+  return {_mean + mean * _scale,
+          std::sqrt((std::max)(variance, 0.0)) * _scale};
+}
+
+double GaussianProcess::kernel(std::vector<double> const &a,
+                               std::vector<double> const &b) const {
+  return std::exp(-squaredDistance(a, b) /
+                  (2.0 * _lengthScale * _lengthScale));
+}
+
+std::vector<double>
+GaussianProcess::solveLower(std::vector<double> const &b) const {
+  std::vector<double> out(b.size());
+
+  for (std::size_t i = 0; i < b.size(); ++i) {
+    double sum = b[i];
+    for (std::size_t k = 0; k < i; ++k) {
+      sum -= _l[i][k] * out[k];
+    }
+    out[i] = sum / _l[i][i];
+  }
+
+  return out;
+}
@@ -20,9 +20,33 @@
  *****************************************************************************/
 
 #include <firestarter/Firestarter.hpp>
+#include <firestarter/Logging/Log.hpp>
+#if defined(linux) || defined(__linux__)
+extern "C" {
+#include <firestarter/Measurement/Metric/LoadLevel.h>
+}
+#endif
 
+#include <algorithm>
 #include <cerrno>
 #include <csignal>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <immintrin.h>
+
+#if defined(linux) || defined(__linux__)
+extern "C" {
+#include <pthread.h>
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+}
+#endif
 
 #ifdef ENABLE_SCOREP
 #include <SCOREP_User.h>
@@ -39,6 +63,15 @@ int Firestarter::watchdogWorker(std::chrono::microseconds period,
   using usec = std::chrono::microseconds;
   using sec = std::chrono::seconds;
 
+  if (!_stagger.empty() && period > usec::zero()) {
+    return this->staggeredWatchdogWorker(period, load, timeout);
+  }
+
+  if (_precisePeriod && period > usec::zero() &&
+      this->environment().topology().hasInvariantRdtsc()) {
+    return this->preciseWatchdogWorker(period, load, timeout);
+  }
+
   // calculate idle time to be the rest of the period
   auto idle = period - load;
 
@@ -56,6 +89,13 @@ int Firestarter::watchdogWorker(std::chrono::microseconds period,
     for (;;) {
       std::chrono::time_point<clock> currentTime = clock::now();
 
+      // take the load level of this period from the profile
+      if (_loadProfile) {
+        load = std::chrono::duration_cast<usec>(
+            period * _loadProfile->level(currentTime - startTime));
+        idle = period - load;
+      }
+
       // get the time already advanced in the current timeslice
       // this can happen if a load function does not terminates just on time
       nsec advance = std::chrono::duration_cast<nsec>(currentTime - startTime) %
@@ -68,8 +108,13 @@ int Firestarter::watchdogWorker(std::chrono::microseconds period,
           std::chrono::duration_cast<nsec>(period).count();
       nsec idle_reduction = advance - load_reduction;
 
-      // signal high load level
-      this->setLoad(LOAD_HIGH);
+      // signal high load level. a load profile may request no high load at
+      // all in this period.
+      auto highStart = clock::now();
+      if (load > usec::zero()) {
+        this->setLoad(LOAD_HIGH);
+        this->insertEvent("load", "high");
+      }
 
       // calculate values for nanosleep
       nsec load_nsec = load - load_reduction;
@@ -100,7 +145,11 @@ int Firestarter::watchdogWorker(std::chrono::microseconds period,
 #endif
 
       // signal low load
-      this->setLoad(LOAD_LOW);
+      auto lowStart = clock::now();
+      if (idle > usec::zero()) {
+        this->setLoad(LOAD_LOW);
+        this->insertEvent("load", "low");
+      }
 
       // calculate values for nanosleep
       nsec idle_nsec = idle - idle_reduction;
@@ -130,6 +179,12 @@ int Firestarter::watchdogWorker(std::chrono::microseconds period,
       SCOREP_USER_REGION_BY_NAME_END("WD_LOW");
 #endif
 
+#if defined(linux) || defined(__linux__)
+      // record the achieved load level of this period
+      load_level_metric_insert(100.0 * (double)(lowStart - highStart).count() /
+                               (double)(clock::now() - highStart).count());
+#endif
+
       // increment elapsed time
       time += period;
 
@@ -163,3 +218,370 @@ int Firestarter::watchdogWorker(std::chrono::microseconds period,
 
   return EXIT_SUCCESS;
 }
+
+namespace {
+// longest time to sleep at once. the termination flag is checked in between.
+constexpr unsigned long long MAX_SLEEP_NSEC = 10000000;
+
+#if defined(linux) || defined(__linux__)
+unsigned long long monotonicNsec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+} // namespace
+
+void Firestarter::initPreciseWaiting() {
+#if defined(linux) || defined(__linux__)
+  if (_realtimeWatchdog) {
+    struct sched_param param = {};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) {
+      log::warn() << "Could not run the watchdog with SCHED_FIFO: "
+                  << std::strerror(error);
+    }
+  }
+
+  _watchdogTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (_watchdogTimerFd == -1) {
+    log::warn() << "Could not create a timerfd for the watchdog: "
+                << std::strerror(errno);
+  }
+
+  _watchdogMonotonicBase = monotonicNsec();
+  _watchdogTimestampBase = this->environment().topology().timestamp();
+#endif
+}
+
+void Firestarter::finiPreciseWaiting() {
+#if defined(linux) || defined(__linux__)
+  if (_watchdogTimerFd != -1) {
+    close(_watchdogTimerFd);
+    _watchdogTimerFd = -1;
+  }
+#endif
+}
+
+// sleep until spinTime before the deadline and busy-wait for the rest of the
+// time. returns true if the watchdog should terminate.
+bool Firestarter::waitForTimestamp(unsigned long long deadline,
+                                   unsigned long long clockrate) {
+  auto const spinTicks = (unsigned long long)((long double)_spinTime.count() *
+                                              clockrate / 1000000.0L);
+
+  for (;;) {
+    auto now = this->environment().topology().timestamp();
+
+    if (now >= deadline) {
+      return false;
+    }
+
+    if (deadline - now <= spinTicks) {
+      break;
+    }
+
+    auto sleepTicks = deadline - now - spinTicks;
+    auto sleepNsec = std::min(
+        MAX_SLEEP_NSEC, (unsigned long long)((long double)sleepTicks *
+                                             1000000000.0L / clockrate));
+
+#if defined(linux) || defined(__linux__)
+    if (_watchdogTimerFd != -1) {
+      // the timer expires at an absolute time, a late wakeup does not shift
+      // the following deadlines.
+      auto wakeup = _watchdogMonotonicBase +
+                    (unsigned long long)((long double)(deadline - spinTicks -
+                                                       _watchdogTimestampBase) *
+                                         1000000000.0L / clockrate);
+      wakeup = std::min(wakeup, monotonicNsec() + MAX_SLEEP_NSEC);
+
+      struct itimerspec spec = {};
+      spec.it_value.tv_sec = wakeup / 1000000000ULL;
+      spec.it_value.tv_nsec = wakeup % 1000000000ULL;
+
+      uint64_t expirations;
+      if (timerfd_settime(_watchdogTimerFd, TFD_TIMER_ABSTIME, &spec,
+                          nullptr) == 0) {
+        // a failed read (EINTR) simply ends the sleep early
+        (void)!read(_watchdogTimerFd, &expirations, sizeof(expirations));
+      }
+    } else {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(sleepNsec));
+    }
+#else
+    std::this_thread::sleep_for(std::chrono::nanoseconds(sleepNsec));
+#endif
+
+    if (this->watchdogTerminated()) {
+      return true;
+    }
+  }
+
+  while (this->environment().topology().timestamp() < deadline) {
+    // a spin time longer than the period never sleeps, the termination
+    // request has to be seen here as well.
+    if (this->watchdogTerminated()) {
+      return true;
+    }
+    _mm_pause();
+  }
+
+  return false;
+}
+
+bool Firestarter::watchdogTerminated() {
+  std::lock_guard<std::mutex> lk(Firestarter::_watchdogTerminateMutex);
+  return Firestarter::_watchdog_terminate;
+}
+
+int Firestarter::preciseWatchdogWorker(std::chrono::microseconds period,
+                                       std::chrono::microseconds load,
+                                       std::chrono::seconds timeout) {
+  auto const clockrate = this->environment().topology().clockrate();
+  auto toTicks = [clockrate](unsigned long long usecs) {
+    return (unsigned long long)((long double)usecs * clockrate / 1000000.0L);
+  };
+
+  auto const periodTicks = toTicks(period.count());
+  auto loadTicks = toTicks(load.count());
+  auto const timeoutTicks = toTicks(
+      std::chrono::duration_cast<std::chrono::microseconds>(timeout).count());
+
+  this->initPreciseWaiting();
+
+  // statistics of the achieved load changes
+  unsigned long long periods = 0;
+  unsigned long long missedPeriods = 0;
+  double requestedSum = 0;
+  double dutyCycleSum = 0;
+  double dutyCycleMin = std::numeric_limits<double>::max();
+  double dutyCycleMax = 0;
+  unsigned long long periodMin = std::numeric_limits<unsigned long long>::max();
+  unsigned long long periodMax = 0;
+  unsigned long long maxLateness = 0;
+
+  auto const startTimestamp = this->environment().topology().timestamp();
+
+  // the deadlines are multiples of the period after the start. they never
+  // accumulate the latency of previous load changes.
+  unsigned long long deadline = startTimestamp;
+  unsigned long long lastHigh = 0;
+  unsigned long long lastLow = 0;
+  double lastRequested = 0;
+  for (;;) {
+    // take the load level of this period from the profile
+    if (_loadProfile) {
+      auto elapsed = std::chrono::nanoseconds(
+          (long long)((long double)(deadline - startTimestamp) *
+                      1000000000.0L / clockrate));
+      loadTicks = (unsigned long long)(periodTicks *
+                                       _loadProfile->level(elapsed));
+    }
+
+    // signal high load. a load profile may request no high load at all in
+    // this period.
+    if (loadTicks > 0) {
+      if (this->watchdogTerminated()) {
+        break;
+      }
+      this->setLoad(LOAD_HIGH);
+    }
+    auto high = this->environment().topology().timestamp();
+    maxLateness = std::max(maxLateness, high - deadline);
+    if (loadTicks > 0) {
+      this->insertEvent("load", "high");
+    }
+
+    // record the last complete period
+    if (lastHigh != 0) {
+      auto achieved = high - lastHigh;
+      double dutyCycle = (double)(lastLow - lastHigh) / (double)achieved;
+      periods++;
+      requestedSum += lastRequested;
+      dutyCycleSum += dutyCycle;
+      dutyCycleMin = std::min(dutyCycleMin, dutyCycle);
+      dutyCycleMax = std::max(dutyCycleMax, dutyCycle);
+      periodMin = std::min(periodMin, achieved);
+      periodMax = std::max(periodMax, achieved);
+#if defined(linux) || defined(__linux__)
+      load_level_metric_insert(100.0 * dutyCycle);
+#endif
+    }
+    lastHigh = high;
+    lastRequested = (double)loadTicks / (double)periodTicks;
+
+#ifdef ENABLE_SCOREP
+    SCOREP_USER_REGION_BY_NAME_BEGIN("WD_HIGH", SCOREP_USER_REGION_TYPE_COMMON);
+#endif
+    if (this->waitForTimestamp(deadline + loadTicks, clockrate)) {
+      break;
+    }
+#ifdef ENABLE_SCOREP
+    SCOREP_USER_REGION_BY_NAME_END("WD_HIGH");
+#endif
+
+    // signal low load
+    if (loadTicks < periodTicks) {
+      if (this->watchdogTerminated()) {
+        break;
+      }
+      this->setLoad(LOAD_LOW);
+    }
+    lastLow = this->environment().topology().timestamp();
+    maxLateness = std::max(maxLateness, lastLow - (deadline + loadTicks));
+    if (loadTicks < periodTicks) {
+      this->insertEvent("load", "low");
+    }
+
+    deadline += periodTicks;
+
+    // skip the periods that were missed completely, e.g. if the watchdog was
+    // preempted for a long time.
+    auto now = this->environment().topology().timestamp();
+    if (now > deadline) {
+      auto missed = (now - deadline) / periodTicks + 1;
+      missedPeriods += missed;
+      deadline += missed * periodTicks;
+    }
+
+    // exit when the timeout is reached
+    if (timeout > std::chrono::seconds::zero() &&
+        deadline - startTimestamp > timeoutTicks) {
+      break;
+    }
+
+#ifdef ENABLE_SCOREP
+    SCOREP_USER_REGION_BY_NAME_BEGIN("WD_LOW", SCOREP_USER_REGION_TYPE_COMMON);
+#endif
+    if (this->waitForTimestamp(deadline, clockrate)) {
+      break;
+    }
+#ifdef ENABLE_SCOREP
+    SCOREP_USER_REGION_BY_NAME_END("WD_LOW");
+#endif
+  }
+
+  // a load change racing with the sigterm handler may have overwritten
+  // LOAD_STOP, always stop the threads again.
+  this->setLoad(LOAD_STOP);
+
+  this->finiPreciseWaiting();
+
+  auto toUsecs = [clockrate](unsigned long long ticks) {
+    return (double)ticks * 1000000.0 / (double)clockrate;
+  };
+
+  if (periods > 0) {
+    log::info() << "\n"
+                << "Precise period: " << periods << " periods, "
+                << missedPeriods << " missed\n"
+                << "  requested: period " << period.count()
+                << " usec, mean duty cycle " << 100.0 * requestedSum / periods
+                << " %\n"
+                << "  achieved duty cycle (mean/min/max): "
+                << 100.0 * dutyCycleSum / periods << " / "
+                << 100.0 * dutyCycleMin << " / " << 100.0 * dutyCycleMax
+                << " %\n"
+                << "  achieved period (min/max): " << toUsecs(periodMin)
+                << " / " << toUsecs(periodMax) << " usec\n"
+                << "  max lateness of a load change: " << toUsecs(maxLateness)
+                << " usec";
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int Firestarter::staggeredWatchdogWorker(std::chrono::microseconds period,
+                                         std::chrono::microseconds load,
+                                         std::chrono::seconds timeout) {
+  using clock = std::chrono::steady_clock;
+  using nsec = std::chrono::nanoseconds;
+
+  bool const precise = _precisePeriod &&
+                       this->environment().topology().hasInvariantRdtsc();
+  unsigned long long clockrate = 0;
+
+  if (precise) {
+    clockrate = this->environment().topology().clockrate();
+    this->initPreciseWaiting();
+  }
+
+  auto const startTime = clock::now();
+  auto const startTimestamp = this->environment().topology().timestamp();
+
+  // wait until the time since the start. returns true if the watchdog should
+  // terminate.
+  auto waitUntil = [&](nsec time) {
+    if (precise) {
+      return this->waitForTimestamp(
+          startTimestamp + (unsigned long long)((long double)time.count() *
+                                                clockrate / 1000000000.0L),
+          clockrate);
+    }
+
+    std::unique_lock<std::mutex> lk(this->_watchdogTerminateMutex);
+    this->_watchdogTerminateAlert.wait_until(
+        lk, startTime + time, [this]() { return this->_watchdog_terminate; });
+    return this->_watchdog_terminate;
+  };
+
+  nsec const periodNsec = period;
+  nsec loadNsec = load;
+  nsec periodStart(0);
+
+  // time in the period, index of the load variable and the new load level
+  std::vector<std::tuple<nsec, std::size_t, unsigned long long>> changes;
+
+  for (;;) {
+    if (_loadProfile) {
+      loadNsec = std::chrono::duration_cast<nsec>(
+          periodNsec * _loadProfile->level(periodStart));
+    }
+
+    // every load variable has high load for loadNsec starting at its phase,
+    // which may wrap around the end of the period.
+    changes.clear();
+    for (std::size_t i = 0; i < _loadVariables.size(); i++) {
+      auto high = std::chrono::duration_cast<nsec>(periodNsec *
+                                                   _loadVariables[i].phase);
+      auto low = (high + loadNsec) % periodNsec;
+
+      if (loadNsec > nsec::zero()) {
+        changes.emplace_back(high, i, LOAD_HIGH);
+      }
+      if (loadNsec < periodNsec) {
+        changes.emplace_back(low, i, LOAD_LOW);
+      }
+    }
+    std::sort(changes.begin(), changes.end());
+
+    for (auto const &change : changes) {
+      if (waitUntil(periodStart + std::get<0>(change))) {
+        this->setLoad(LOAD_STOP);
+        this->finiPreciseWaiting();
+        return EXIT_SUCCESS;
+      }
+      this->setLoadVariable(std::get<1>(change), std::get<2>(change));
+      // do not format the event between the load changes without a stream
+      if (this->eventsActive()) {
+        auto level = std::get<2>(change) == LOAD_HIGH ? "high" : "low";
+        this->insertEvent("load", std::string(level) + ":" +
+                                      std::to_string(std::get<1>(change)));
+      }
+    }
+
+    periodStart += periodNsec;
+
+    // exit when the timeout is reached
+    if (timeout > std::chrono::seconds::zero() && periodStart > timeout) {
+      break;
+    }
+  }
+
+  this->setLoad(LOAD_STOP);
+  this->finiPreciseWaiting();
+
+  return EXIT_SUCCESS;
+}
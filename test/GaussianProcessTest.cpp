@@ -0,0 +1,127 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+// test the gaussian process of the surrogate optimization on known functions
+
+#include <firestarter/Optimizer/Util/GaussianProcess.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using firestarter::optimizer::util::GaussianProcess;
+
+namespace {
+
+bool expectNear(std::string const &name, double value, double expected,
+                double tolerance) {
+  if (!std::isfinite(value) || std::abs(value - expected) > tolerance) {
+    std::cerr << name << ": " << value << " instead of " << expected << " +- "
+              << tolerance << "\n";
+    return false;
+  }
+  return true;
+}
+
+// the mean interpolates sin between the points it was fitted to. the standard
+// deviation is small close to the points and the prior far away from them.
+bool testSin() {
+  std::vector<std::vector<double>> x;
+  std::vector<double> y;
+  for (int i = 0; i <= 20; i++) {
+    double v = 2.0 * M_PI * i / 20;
+    x.push_back({v});
+    y.push_back(std::sin(v));
+  }
+
+  GaussianProcess gp;
+  gp.fit(x, y);
+
+  bool ok = true;
+  for (int i = 0; i < 20; i++) {
+    double v = 2.0 * M_PI * (i + 0.5) / 20;
+    auto [mean, stddev] = gp.predict({v});
+    ok &= expectNear("sin(" + std::to_string(v) + ")", mean, std::sin(v),
+                     0.05);
+    ok &= expectNear("stddev at " + std::to_string(v), stddev, 0.0,
+                     0.1);
+  }
+
+  // far away the prediction is the mean and standard deviation of the values
+  auto [mean, stddev] = gp.predict({100.0});
+  ok &= expectNear("mean far away", mean, 0.0, 1e-6);
+  ok &= expectNear("stddev far away", stddev, std::sqrt(0.5), 0.05);
+
+  return ok;
+}
+
+// a function of two variables with an offset and scale that differ from the
+// normalized values
+bool testPlane() {
+  std::vector<std::vector<double>> x;
+  std::vector<double> y;
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 5; j++) {
+      x.push_back({(double)i, (double)j});
+      y.push_back(300.0 + 20.0 * i - 10.0 * j);
+    }
+  }
+
+  GaussianProcess gp;
+  gp.fit(x, y);
+
+  bool ok = true;
+  ok &= expectNear("plane(1.5, 2.5)", gp.predict({1.5, 2.5}).first, 305.0,
+                   2.5);
+  ok &= expectNear("plane(3.5, 0.5)", gp.predict({3.5, 0.5}).first, 365.0,
+                   2.5);
+  return ok;
+}
+
+// duplicate points make the kernel matrix singular without the noise. a
+// constant function has no variance to normalize with.
+bool testDegenerate() {
+  GaussianProcess gp;
+  gp.fit({{1.0}, {1.0}, {2.0}, {2.0}}, {5.0, 5.0, 5.0, 5.0});
+
+  bool ok = true;
+  auto [mean, stddev] = gp.predict({1.5});
+  ok &= expectNear("constant", mean, 5.0, 1e-6);
+  ok &= expectNear("constant stddev", stddev, 0.0, 1.0);
+
+  GaussianProcess empty;
+  empty.fit({}, {});
+  ok &= expectNear("empty", empty.predict({1.0}).first, 0.0, 0.0);
+
+  return ok;
+}
+
+} // namespace
+
+int main() {
+  bool ok = testSin();
+  ok &= testPlane();
+  ok &= testDegenerate();
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,260 @@
+/******************************************************************************
+ * FIRESTARTER - A Processor Stress Test Utility
+ * Copyright (C) 2020 TU Dresden, Center for Information Services and High
+ * Performance Computing
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/\>.
+ *
+ * Contact: daniel.hackenberg@tu-dresden.de
+ *****************************************************************************/
+
+// test the msr-rapl metric with a mock of /dev/cpu/*/msr and the cpu topology
+// in sysfs. MSR_PATH and CPU_PATH are set to the mock directory at build time.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <firestarter/Measurement/Metric/MSR.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+namespace {
+
+std::mutex valuesMutex;
+std::map<std::string, double> values;
+
+void insertCallback(void *arg, const char *name, int64_t time, double value) {
+  (void)arg;
+  (void)time;
+
+  std::lock_guard<std::mutex> lk(valuesMutex);
+  values[name] = value;
+}
+
+void addCpu(unsigned cpu, unsigned package, unsigned core) {
+  auto topology = std::filesystem::path(CPU_PATH) /
+                  ("cpu" + std::to_string(cpu)) / "topology";
+  std::filesystem::create_directories(topology);
+  std::ofstream(topology / "physical_package_id") << package << "\n";
+  std::ofstream(topology / "core_id") << core << "\n";
+
+  auto msr = std::filesystem::path(MSR_PATH) / std::to_string(cpu);
+  std::filesystem::create_directories(msr);
+  std::ofstream(msr / "msr");
+}
+
+// write size bytes of the value at the offset of the msr. the file is sparse,
+// reads after its end fail like reads of an unsupported msr.
+void writeMsr(unsigned cpu, uint64_t msr, uint64_t value,
+              std::size_t size = sizeof(uint64_t)) {
+  auto path = std::string(MSR_PATH) + "/" + std::to_string(cpu) + "/msr";
+  int fd = open(path.c_str(), O_WRONLY);
+  (void)!pwrite(fd, &value, size, msr);
+  close(fd);
+}
+
+void reset() {
+  std::filesystem::remove_all(MSR_PATH);
+  std::filesystem::remove_all(CPU_PATH);
+
+  std::lock_guard<std::mutex> lk(valuesMutex);
+  values.clear();
+}
+
+bool expect(std::string const &name, double expected) {
+  std::lock_guard<std::mutex> lk(valuesMutex);
+
+  auto it = values.find(name);
+  if (it == values.end()) {
+    std::cerr << name << ": no value inserted\n";
+    return false;
+  }
+  if (std::abs(it->second - expected) > 1e-9) {
+    std::cerr << name << ": " << it->second << " instead of " << expected
+              << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool expectSubmetrics(std::vector<std::string> const &expected) {
+  std::vector<std::string> names;
+  for (auto name = msr_rapl_metric.get_submetric_names(); *name != nullptr;
+       name++) {
+    names.push_back(*name);
+  }
+
+  if (names != expected) {
+    std::cerr << "unexpected submetrics:";
+    for (auto const &name : names) {
+      std::cerr << " " << name;
+    }
+    std::cerr << "\n";
+    return false;
+  }
+  return true;
+}
+
+// two intel packages with two cpus each. the package counter of package 0
+// overflows, dram is counted in the fixed unit of 2^-16 J.
+bool testIntel() {
+  reset();
+  for (unsigned cpu = 0; cpu < 4; cpu++) {
+    addCpu(cpu, cpu / 2, cpu % 2);
+  }
+  for (unsigned cpu : {0, 2}) {
+    // energy status unit of 2^-14 J
+    writeMsr(cpu, 0x606, 14 << 8);
+    writeMsr(cpu, 0x611, 0xfffffff0);
+    writeMsr(cpu, 0x619, 0x1000);
+    writeMsr(cpu, 0x639, 0x2000);
+  }
+
+  if (EXIT_SUCCESS != msr_rapl_metric.init()) {
+    std::cerr << "init: " << msr_rapl_metric.get_error() << "\n";
+    return false;
+  }
+
+  bool ok = expectSubmetrics({"package-0", "dram-0", "pp0-0", "package-1",
+                              "dram-1", "pp0-1"});
+
+  msr_rapl_metric.register_insert_callback(insertCallback, nullptr);
+
+  writeMsr(0, 0x611, 0x10);
+  writeMsr(0, 0x619, 0x1000 + 65536);
+  writeMsr(0, 0x639, 0x2000 + 16384);
+  writeMsr(2, 0x611, 0xfffffff0 + 8192);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  ok &= expect("msr-rapl/package-0", 0x20 / 16384.0);
+  ok &= expect("msr-rapl/dram-0", 1.0);
+  ok &= expect("msr-rapl/pp0-0", 1.0);
+  ok &= expect("msr-rapl/package-1", 0.5);
+  ok &= expect("msr-rapl/dram-1", 0.0);
+  ok &= expect("msr-rapl", 0x20 / 16384.0 + 1.0 + 0.5);
+
+  msr_rapl_metric.fini();
+
+  return ok;
+}
+
+// one amd package with two cores of two cpus each. the counter of core 1 is
+// read from another cpu than the sampling thread. the amd msrs are adjacent
+// and overlap in the mock file of cpu 0, only the highest byte of the package
+// counter is changed there.
+bool testAMD() {
+  reset();
+  for (unsigned cpu = 0; cpu < 4; cpu++) {
+    addCpu(cpu, 0, cpu % 2);
+  }
+  // energy status unit of 2^-16 J
+  writeMsr(0, 0xC0010299, 16 << 8);
+  writeMsr(0, 0xC001029B + 8, 0);
+  writeMsr(1, 0xC001029A, 0);
+
+  if (EXIT_SUCCESS != msr_rapl_metric.init()) {
+    std::cerr << "init: " << msr_rapl_metric.get_error() << "\n";
+    return false;
+  }
+
+  bool ok = expectSubmetrics({"package-0", "core-0", "core-1"});
+
+  msr_rapl_metric.register_insert_callback(insertCallback, nullptr);
+
+  writeMsr(0, 0xC001029B + 3, 1, 1);
+  writeMsr(1, 0xC001029A, 65536);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  ok &= expect("msr-rapl/package-0", 256.0);
+  ok &= expect("msr-rapl/core-0", 0.0);
+  ok &= expect("msr-rapl/core-1", 1.0);
+  ok &= expect("msr-rapl", 256.0);
+
+  msr_rapl_metric.fini();
+
+  return ok;
+}
+
+// the intel packages of testIntel with load threads on cpus 0 and 2. the
+// energy counters are only written on cpus 1 and 3, which run the sampling
+// threads. the unit is read once from the first cpu.
+bool testLoadCpus() {
+  reset();
+  for (unsigned cpu = 0; cpu < 4; cpu++) {
+    addCpu(cpu, cpu / 2, cpu % 2);
+  }
+  writeMsr(0, 0x606, 14 << 8);
+  for (unsigned cpu : {1, 3}) {
+    writeMsr(cpu, 0x611, 0);
+    writeMsr(cpu, 0x619, 0);
+    writeMsr(cpu, 0x639, 0);
+  }
+
+  int loadCpus[] = {0, 2};
+  msr_rapl_metric_set_load_cpus(loadCpus, 2);
+
+  if (EXIT_SUCCESS != msr_rapl_metric.init()) {
+    std::cerr << "init: " << msr_rapl_metric.get_error() << "\n";
+    msr_rapl_metric_set_load_cpus(nullptr, 0);
+    return false;
+  }
+
+  msr_rapl_metric.register_insert_callback(insertCallback, nullptr);
+
+  writeMsr(1, 0x611, 16384);
+  writeMsr(3, 0x611, 8192);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  bool ok = expect("msr-rapl/package-0", 1.0);
+  ok &= expect("msr-rapl/package-1", 0.5);
+
+  msr_rapl_metric.fini();
+  msr_rapl_metric_set_load_cpus(nullptr, 0);
+
+  return ok;
+}
+
+} // namespace
+
+int main() {
+  msr_rapl_metric_set_interval(100);
+
+  bool ok = testIntel();
+  ok &= testAMD();
+  ok &= testLoadCpus();
+
+  // exit with running sampling threads, like FIRESTARTER does on errors after
+  // the metrics are initialized. this must not call std::terminate.
+  msr_rapl_metric.init();
+  msr_rapl_metric.register_insert_callback(insertCallback, nullptr);
+  reset();
+
+  std::exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}